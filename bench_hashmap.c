@@ -0,0 +1,641 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE  // syscall() for perf_event_open
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include "hashmap.h"
+#include "hashmap_flat.h"
+#include "hashmap_typed.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Standalone benchmark harness
+//
+// Times insert, lookup and counting-update workloads on every storage engine
+// under one configuration. Each workload runs a number of repetitions on a
+// freshly built table; the report gives ns/op percentiles across repetitions
+// and, where the kernel allows it, hardware cache misses per operation.
+// Operation streams are generated before timing starts, so the random number
+// generator and the key distribution never show up in the numbers.
+
+#define BENCH_MAX_KEY_SIZE 256
+#define BENCH_MAX_REPS 1000
+
+HASHMAP_DECLARE(bench_u64_map, uint64_t, uint64_t, hashmap_typed_hash_u64, HASHMAP_TYPED_EQ)
+
+typedef enum {
+    BENCH_UNIFORM,
+    BENCH_ZIPF
+} bench_dist_t;
+
+// Benchmark configuration (command line)
+typedef struct {
+    size_t keys;                    // Distinct keys in the table
+    size_t ops;                     // Operations per timed repetition
+    size_t key_size;                // Bytes per key (8 enables the typed engine)
+    bench_dist_t dist;
+    double zipf_s;                  // Zipf exponent
+    double load_factor;             // Max load factor the tables are sized for
+    double hit_ratio;               // Fraction of lookups that hit
+    int reps;
+    const char *engine;             // Engine name or "all"
+    const char *workload;           // Workload name or "all"
+    bool csv;
+    bool huge_pages;                // Back tables with transparent huge pages
+    uint64_t seed;
+} bench_config_t;
+
+// Generated input shared by every engine
+typedef struct {
+    unsigned char *keys;            // keys * key_size bytes, all distinct
+    unsigned char *miss_keys;       // keys * key_size bytes, none in keys
+    const unsigned char **stream;   // ops key pointers for lookups/updates
+} bench_input_t;
+
+// Per-repetition measurement
+typedef struct {
+    double ns_per_op[BENCH_MAX_REPS];
+    double misses_per_op[BENCH_MAX_REPS];
+    int count;
+    bool have_misses;
+} bench_samples_t;
+
+// Engine under test: a table plus the operations the workloads need
+typedef struct {
+    const char *name;
+    bool (*supported)(const bench_config_t *config);
+    void *(*create)(const bench_config_t *config);
+    void (*destroy)(void *map);
+    void (*put)(void *map, const void *key, size_t key_size, uint64_t value);
+    uint64_t (*get)(void *map, const void *key, size_t key_size);
+    void (*count)(void *map, const void *key, size_t key_size);
+} bench_engine_t;
+
+static uint64_t bench_rng_state;
+
+// splitmix64: a bijection, so distinct inputs give distinct keys
+static uint64_t bench_splitmix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t bench_rand(void) {
+    bench_rng_state = bench_splitmix(bench_rng_state);
+    return bench_rng_state;
+}
+
+// Uniform double in [0, 1)
+static double bench_rand_unit(void) {
+    return (double)(bench_rand() >> 11) / 9007199254740992.0;
+}
+
+static double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Hardware cache-miss counter; -1 when unavailable (not Linux, or perf disabled)
+static int bench_counter_open(void) {
+#if defined(__linux__)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void bench_counter_start(int fd) {
+#if defined(__linux__)
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+// Misses since bench_counter_start, or -1
+static double bench_counter_stop(int fd) {
+#if defined(__linux__)
+    uint64_t value;
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+            return (double)value;
+        }
+    }
+#else
+    (void)fd;
+#endif
+    return -1.0;
+}
+
+// Fill key i (distinct for distinct i) of key_size bytes. Short keys hold i
+// itself, which is unique as long as it fits (checked by bench_parse).
+static void bench_make_key(unsigned char *out, size_t key_size, uint64_t i) {
+    uint64_t word = key_size >= sizeof(word) ? bench_splitmix(i) : i;
+    size_t n = key_size < sizeof(word) ? key_size : sizeof(word);
+    for (size_t pos = 0; pos < n; pos++) {
+        out[pos] = (unsigned char)(word >> (8 * pos));
+    }
+    for (size_t pos = n; pos < key_size; pos++) {
+        out[pos] = (unsigned char)(bench_splitmix(i * 1315423911u + pos) >> 24);
+    }
+}
+
+// Cumulative Zipf(s) distribution over n ranks
+static double *bench_zipf_cdf(size_t n, double s) {
+    double *cdf = malloc(n * sizeof(double));
+    if (!cdf) {
+        return NULL;
+    }
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        total += 1.0 / pow((double)(i + 1), s);
+        cdf[i] = total;
+    }
+    for (size_t i = 0; i < n; i++) {
+        cdf[i] /= total;
+    }
+    return cdf;
+}
+
+// Rank with cdf[rank] >= u
+static size_t bench_zipf_rank(const double *cdf, size_t n, double u) {
+    size_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cdf[mid] < u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool bench_input_init(bench_input_t *input, const bench_config_t *config) {
+    memset(input, 0, sizeof(*input));
+    input->keys = malloc(config->keys * config->key_size);
+    input->miss_keys = malloc(config->keys * config->key_size);
+    input->stream = malloc(config->ops * sizeof(*input->stream));
+    if (!input->keys || !input->miss_keys || !input->stream) {
+        return false;
+    }
+    for (size_t i = 0; i < config->keys; i++) {
+        bench_make_key(input->keys + i * config->key_size, config->key_size, i);
+        bench_make_key(input->miss_keys + i * config->key_size, config->key_size, i + config->keys);
+    }
+
+    // Hot ranks are scattered over the key array so they do not share cache lines
+    double *cdf = config->dist == BENCH_ZIPF ? bench_zipf_cdf(config->keys, config->zipf_s) : NULL;
+    if (config->dist == BENCH_ZIPF && !cdf) {
+        return false;
+    }
+    for (size_t i = 0; i < config->ops; i++) {
+        bool hit = bench_rand_unit() < config->hit_ratio;
+        size_t index;
+        if (!hit) {
+            index = (size_t)(bench_rand() % config->keys);
+        } else if (cdf) {
+            index = (size_t)(bench_splitmix(bench_zipf_rank(cdf, config->keys, bench_rand_unit())) % config->keys);
+        } else {
+            index = (size_t)(bench_rand() % config->keys);
+        }
+        input->stream[i] = (hit ? input->keys : input->miss_keys) + index * config->key_size;
+    }
+    free(cdf);
+    return true;
+}
+
+static void bench_input_free(bench_input_t *input) {
+    free(input->keys);
+    free(input->miss_keys);
+    free(input->stream);
+}
+
+// ============================================================================
+// Engines
+// ============================================================================
+
+static bool bench_always(const bench_config_t *config) {
+    (void)config;
+    return true;
+}
+
+static bool bench_u64_keys(const bench_config_t *config) {
+    return config->key_size == sizeof(uint64_t);
+}
+
+// Chained map with inline 8-byte values, optionally pooled
+static void *bench_chained_create_opts(const bench_config_t *config, bool pool) {
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    options.max_load_factor = config->load_factor;
+    options.entry_pool = pool;
+    options.table_memory.huge_pages = config->huge_pages ? HASHMAP_HUGE_TRANSPARENT : HASHMAP_HUGE_NONE;
+    options.pool_key_size = config->key_size;
+    hashmap_t *map = hashmap_create_ex(&options);
+    if (map && !hashmap_reserve(map, config->keys)) {
+        hashmap_destroy(map);
+        return NULL;
+    }
+    return map;
+}
+
+static void *bench_chained_create(const bench_config_t *config) {
+    return bench_chained_create_opts(config, false);
+}
+
+static void *bench_pooled_create(const bench_config_t *config) {
+    return bench_chained_create_opts(config, true);
+}
+
+static void bench_chained_destroy(void *map) {
+    hashmap_destroy(map);
+}
+
+static void bench_chained_put(void *map, const void *key, size_t key_size, uint64_t value) {
+    hashmap_put(map, key, key_size, &value);
+}
+
+static uint64_t bench_chained_get(void *map, const void *key, size_t key_size) {
+    uint64_t *value = hashmap_get(map, key, key_size);
+    return value ? *value : 0;
+}
+
+static void bench_chained_count(void *map, const void *key, size_t key_size) {
+    uint64_t *value = hashmap_get_or_insert(map, key, key_size, NULL);
+    if (value) {
+        (*value)++;
+    }
+}
+
+// Flat engine with the value stored in the pointer slot
+static void *bench_flat_create(const bench_config_t *config) {
+    hashmap_options_t options = {0};
+    options.max_load_factor = config->load_factor;
+    options.table_memory.huge_pages = config->huge_pages ? HASHMAP_HUGE_TRANSPARENT : HASHMAP_HUGE_NONE;
+    hashmap_flat_t *map = hashmap_flat_create_ex(&options);
+    if (map && !hashmap_flat_reserve(map, config->keys)) {
+        hashmap_flat_destroy(map);
+        return NULL;
+    }
+    return map;
+}
+
+static void bench_flat_destroy(void *map) {
+    hashmap_flat_destroy(map);
+}
+
+static void bench_flat_put(void *map, const void *key, size_t key_size, uint64_t value) {
+    hashmap_flat_put(map, key, key_size, (void *)(uintptr_t)value);
+}
+
+static uint64_t bench_flat_get(void *map, const void *key, size_t key_size) {
+    return (uint64_t)(uintptr_t)hashmap_flat_get(map, key, key_size);
+}
+
+static void bench_flat_count(void *map, const void *key, size_t key_size) {
+    void **value = hashmap_flat_get_or_insert(map, key, key_size, NULL);
+    if (value) {
+        *value = (void *)((uintptr_t)*value + 1);
+    }
+}
+
+// Typed map for 8-byte keys (its load factor is fixed at 0.875)
+static void *bench_typed_create(const bench_config_t *config) {
+    bench_u64_map_t *map = bench_u64_map_create(0);
+    if (map && !bench_u64_map_reserve(map, config->keys)) {
+        bench_u64_map_destroy(map);
+        return NULL;
+    }
+    return map;
+}
+
+static void bench_typed_destroy(void *map) {
+    bench_u64_map_destroy(map);
+}
+
+static uint64_t bench_load_u64(const void *key) {
+    uint64_t k;
+    memcpy(&k, key, sizeof(k));
+    return k;
+}
+
+static void bench_typed_put(void *map, const void *key, size_t key_size, uint64_t value) {
+    (void)key_size;
+    bench_u64_map_put(map, bench_load_u64(key), value);
+}
+
+static uint64_t bench_typed_get(void *map, const void *key, size_t key_size) {
+    (void)key_size;
+    uint64_t *value = bench_u64_map_get(map, bench_load_u64(key));
+    return value ? *value : 0;
+}
+
+static void bench_typed_count(void *map, const void *key, size_t key_size) {
+    (void)key_size;
+    uint64_t *value = bench_u64_map_get_or_insert(map, bench_load_u64(key), NULL);
+    if (value) {
+        (*value)++;
+    }
+}
+
+static const bench_engine_t bench_engines[] = {
+    {"chained", bench_always, bench_chained_create, bench_chained_destroy,
+     bench_chained_put, bench_chained_get, bench_chained_count},
+    {"pooled", bench_always, bench_pooled_create, bench_chained_destroy,
+     bench_chained_put, bench_chained_get, bench_chained_count},
+    {"flat", bench_always, bench_flat_create, bench_flat_destroy,
+     bench_flat_put, bench_flat_get, bench_flat_count},
+    {"typed", bench_u64_keys, bench_typed_create, bench_typed_destroy,
+     bench_typed_put, bench_typed_get, bench_typed_count},
+};
+
+// ============================================================================
+// Workloads
+// ============================================================================
+
+static volatile uint64_t bench_sink;
+
+static void bench_fill(const bench_engine_t *engine, void *map, const bench_config_t *config,
+                       const bench_input_t *input) {
+    for (size_t i = 0; i < config->keys; i++) {
+        engine->put(map, input->keys + i * config->key_size, config->key_size, i);
+    }
+}
+
+// Time one repetition of a workload; returns ns/op and fills *misses
+static double bench_run_once(const bench_engine_t *engine, const char *workload, const bench_config_t *config,
+                             const bench_input_t *input, int counter, double *misses, size_t *ops) {
+    void *map = engine->create(config);
+    if (!map) {
+        fprintf(stderr, "%s: table creation failed\n", engine->name);
+        exit(1);
+    }
+
+    double start, end;
+    uint64_t sum = 0;
+    if (strcmp(workload, "insert") == 0) {
+        *ops = config->keys;
+        bench_counter_start(counter);
+        start = bench_now_ns();
+        bench_fill(engine, map, config, input);
+        end = bench_now_ns();
+    } else {
+        bench_fill(engine, map, config, input);
+        *ops = config->ops;
+        bool lookup = strcmp(workload, "lookup") == 0;
+        bench_counter_start(counter);
+        start = bench_now_ns();
+        for (size_t i = 0; i < config->ops; i++) {
+            if (lookup) {
+                sum += engine->get(map, input->stream[i], config->key_size);
+            } else {
+                engine->count(map, input->stream[i], config->key_size);
+            }
+        }
+        end = bench_now_ns();
+    }
+    *misses = bench_counter_stop(counter);
+    bench_sink += sum;
+
+    engine->destroy(map);
+    return (end - start) / (double)*ops;
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double bench_percentile(const double *sorted, int n, double p) {
+    int rank = (int)ceil(p / 100.0 * n);
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+static void bench_report(const bench_engine_t *engine, const char *workload, const bench_config_t *config,
+                         bench_samples_t *samples) {
+    qsort(samples->ns_per_op, (size_t)samples->count, sizeof(double), bench_compare_double);
+    double misses = NAN;
+    if (samples->have_misses) {
+        qsort(samples->misses_per_op, (size_t)samples->count, sizeof(double), bench_compare_double);
+        misses = bench_percentile(samples->misses_per_op, samples->count, 50);
+    }
+    double p50 = bench_percentile(samples->ns_per_op, samples->count, 50);
+    double p90 = bench_percentile(samples->ns_per_op, samples->count, 90);
+    double p99 = bench_percentile(samples->ns_per_op, samples->count, 99);
+    const char *dist = config->dist == BENCH_ZIPF ? "zipf" : "uniform";
+
+    if (config->csv) {
+        printf("%s,%s,%s,%zu,%zu,%.3f,%.3f,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f\n",
+               engine->name, workload, dist, config->keys, config->key_size, config->load_factor,
+               config->hit_ratio, samples->count, samples->ns_per_op[0], p50, p90, p99,
+               samples->ns_per_op[samples->count - 1], misses);
+        return;
+    }
+    printf("%-8s %-7s %8.2f %8.2f %8.2f %8.2f %8.2f", engine->name, workload, samples->ns_per_op[0],
+           p50, p90, p99, samples->ns_per_op[samples->count - 1]);
+    if (samples->have_misses) {
+        printf(" %10.3f\n", misses);
+    } else {
+        printf(" %10s\n", "n/a");
+    }
+}
+
+static void bench_usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --engine=NAME       chained, pooled, flat, typed or all (default all)\n"
+            "  --workload=NAME     insert, lookup, update or all (default all)\n"
+            "  --keys=N            distinct keys in the table (default 1000000)\n"
+            "  --ops=N             lookups/updates per repetition (default 2000000)\n"
+            "  --key-size=B        bytes per key, 1-%d (default 8; typed needs 8)\n"
+            "  --dist=NAME         uniform or zipf (default uniform)\n"
+            "  --zipf-s=S          Zipf exponent (default 0.99)\n"
+            "  --load-factor=LF    max load factor tables are sized for (default 0.75)\n"
+            "  --hit-ratio=R       fraction of lookups that hit, 0-1 (default 1.0)\n"
+            "  --reps=N            timed repetitions per workload, 1-%d (default 5)\n"
+            "  --seed=N            random seed (default 1)\n"
+            "  --huge-pages        back chained/pooled/flat tables with transparent huge pages\n"
+            "  --csv               machine-readable output\n",
+            prog, BENCH_MAX_KEY_SIZE, BENCH_MAX_REPS);
+}
+
+// Value of --name=value, or NULL when arg is a different option
+static const char *bench_option(const char *arg, const char *name) {
+    size_t len = strlen(name);
+    return strncmp(arg, name, len) == 0 && arg[len] == '=' ? arg + len + 1 : NULL;
+}
+
+static bool bench_parse(bench_config_t *config, int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *v;
+        if ((v = bench_option(arg, "--engine"))) {
+            config->engine = v;
+        } else if ((v = bench_option(arg, "--workload"))) {
+            config->workload = v;
+        } else if ((v = bench_option(arg, "--keys"))) {
+            config->keys = strtoull(v, NULL, 10);
+        } else if ((v = bench_option(arg, "--ops"))) {
+            config->ops = strtoull(v, NULL, 10);
+        } else if ((v = bench_option(arg, "--key-size"))) {
+            config->key_size = strtoull(v, NULL, 10);
+        } else if ((v = bench_option(arg, "--dist"))) {
+            if (strcmp(v, "uniform") == 0) {
+                config->dist = BENCH_UNIFORM;
+            } else if (strcmp(v, "zipf") == 0) {
+                config->dist = BENCH_ZIPF;
+            } else {
+                return false;
+            }
+        } else if ((v = bench_option(arg, "--zipf-s"))) {
+            config->zipf_s = strtod(v, NULL);
+        } else if ((v = bench_option(arg, "--load-factor"))) {
+            config->load_factor = strtod(v, NULL);
+        } else if ((v = bench_option(arg, "--hit-ratio"))) {
+            config->hit_ratio = strtod(v, NULL);
+        } else if ((v = bench_option(arg, "--reps"))) {
+            config->reps = atoi(v);
+        } else if ((v = bench_option(arg, "--seed"))) {
+            config->seed = strtoull(v, NULL, 10);
+        } else if (strcmp(arg, "--csv") == 0) {
+            config->csv = true;
+        } else if (strcmp(arg, "--huge-pages") == 0) {
+            config->huge_pages = true;
+        } else if (strcmp(arg, "--help") == 0) {
+            bench_usage(argv[0]);
+            exit(0);
+        } else {
+            return false;
+        }
+    }
+    // Hit and miss keys together must fit in key_size bytes
+    if (config->key_size > 0 && config->key_size < sizeof(uint64_t) &&
+        config->keys > ((uint64_t)1 << (8 * config->key_size)) / 2) {
+        return false;
+    }
+    return config->keys > 0 && config->ops > 0 && config->key_size > 0 &&
+           config->key_size <= BENCH_MAX_KEY_SIZE && config->load_factor > 0 && config->load_factor <= 1.0 &&
+           config->hit_ratio >= 0 && config->hit_ratio <= 1.0 && config->reps > 0 &&
+           config->reps <= BENCH_MAX_REPS && config->zipf_s > 0;
+}
+
+int main(int argc, char **argv) {
+    bench_config_t config = {
+        .keys = 1000000,
+        .ops = 2000000,
+        .key_size = 8,
+        .dist = BENCH_UNIFORM,
+        .zipf_s = 0.99,
+        .load_factor = 0.75,
+        .hit_ratio = 1.0,
+        .reps = 5,
+        .engine = "all",
+        .workload = "all",
+        .csv = false,
+        .huge_pages = false,
+        .seed = 1,
+    };
+    if (!bench_parse(&config, argc, argv)) {
+        bench_usage(argv[0]);
+        return 2;
+    }
+    bench_rng_state = config.seed;
+
+    bench_input_t input;
+    if (!bench_input_init(&input, &config)) {
+        fprintf(stderr, "out of memory generating input\n");
+        return 1;
+    }
+
+    int counter = bench_counter_open();
+    if (config.csv) {
+        printf("engine,workload,dist,keys,key_size,load_factor,hit_ratio,reps,"
+               "min_ns,p50_ns,p90_ns,p99_ns,max_ns,misses_per_op\n");
+    } else {
+        printf("keys=%zu ops=%zu key_size=%zu dist=%s", config.keys, config.ops, config.key_size,
+               config.dist == BENCH_ZIPF ? "zipf" : "uniform");
+        if (config.dist == BENCH_ZIPF) {
+            printf(" s=%.2f", config.zipf_s);
+        }
+        printf(" load_factor=%.2f hit_ratio=%.2f reps=%d\n\n", config.load_factor, config.hit_ratio, config.reps);
+        printf("%-8s %-7s %8s %8s %8s %8s %8s %10s\n", "engine", "work", "min", "p50", "p90", "p99", "max",
+               "miss/op");
+        printf("%-8s %-7s %8s %8s %8s %8s %8s %10s\n", "", "", "ns/op", "ns/op", "ns/op", "ns/op", "ns/op", "");
+    }
+
+    static const char *workloads[] = {"insert", "lookup", "update"};
+    bool ran = false;
+    for (size_t e = 0; e < sizeof(bench_engines) / sizeof(bench_engines[0]); e++) {
+        const bench_engine_t *engine = &bench_engines[e];
+        if (strcmp(config.engine, "all") != 0 && strcmp(config.engine, engine->name) != 0) {
+            continue;
+        }
+        if (!engine->supported(&config)) {
+            if (strcmp(config.engine, "all") != 0) {
+                fprintf(stderr, "%s: not available for %zu-byte keys\n", engine->name, config.key_size);
+            }
+            continue;
+        }
+        for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+            if (strcmp(config.workload, "all") != 0 && strcmp(config.workload, workloads[w]) != 0) {
+                continue;
+            }
+            bench_samples_t samples;
+            samples.count = 0;
+            samples.have_misses = counter >= 0;
+
+            // One untimed warm-up, then the measured repetitions
+            double misses;
+            size_t ops;
+            bench_run_once(engine, workloads[w], &config, &input, -1, &misses, &ops);
+            for (int r = 0; r < config.reps; r++) {
+                samples.ns_per_op[r] = bench_run_once(engine, workloads[w], &config, &input, counter, &misses, &ops);
+                samples.misses_per_op[r] = misses / (double)ops;
+                samples.have_misses = samples.have_misses && misses >= 0;
+                samples.count++;
+            }
+            bench_report(engine, workloads[w], &config, &samples);
+            ran = true;
+        }
+    }
+
+#if defined(__linux__)
+    if (counter >= 0) {
+        close(counter);
+    }
+#endif
+    bench_input_free(&input);
+    if (!ran) {
+        fprintf(stderr, "no engine/workload matched\n");
+        return 2;
+    }
+    return 0;
+}
@@ -6,273 +6,1887 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+
+// Vector kernels for key comparison here and control-tag matching in
+// hashmap_flat.h are chosen at compile time; HASHMAP_SIMD names the set in use
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HASHMAP_SIMD "sse2"
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HASHMAP_SIMD "neon"
+#else
+#define HASHMAP_SIMD "swar"
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 
 // Function pointer types for cleanup
 typedef void (*key_free_func_t)(void *key);
 typedef void (*value_free_func_t)(void *value);
 
-// Hashmap entry structure
+// Function pointer type for user-supplied hash functions
+typedef size_t (*hash_func_t)(const void *key, size_t key_size);
+
+// Called for each entry a cache-mode map evicts, before value_free; value is
+// what hashmap_get returned for the key
+typedef void (*hashmap_evict_func_t)(const void *key, size_t key_size, void *value, void *ctx);
+
+// Clock for TTL expiry, in milliseconds on any monotonic scale
+typedef uint64_t (*hashmap_clock_func_t)(void *ctx);
+
+// Custom allocator hooks (NULL functions select malloc/free). dealloc
+// receives the size that was requested from alloc.
+typedef struct hashmap_allocator {
+    void *(*alloc)(size_t size, void *ctx);
+    void (*dealloc)(void *ptr, size_t size, void *ctx);
+    void *ctx;
+} hashmap_allocator_t;
+
+// Huge-page modes for hashmap_table_memory_t
+#define HASHMAP_HUGE_NONE 0               // Base pages
+#define HASHMAP_HUGE_TRANSPARENT 1        // Huge-page-aligned mapping advised with MADV_HUGEPAGE
+#define HASHMAP_HUGE_EXPLICIT 2           // MAP_HUGETLB from the reserved pool, else as TRANSPARENT
+
+// NUMA placement for hashmap_table_memory_t (Linux)
+#define HASHMAP_NUMA_DEFAULT 0            // Pages land on the node that first touches them
+#define HASHMAP_NUMA_BIND 1               // Only the nodes in numa_nodes
+#define HASHMAP_NUMA_INTERLEAVE 2         // Pages round-robin over numa_nodes (0 for all nodes)
+
+// Backing for large bucket and slot arrays (zero-initialize to use the
+// allocator hooks). Any non-zero mode maps arrays of at least min_bytes
+// directly from the kernel: their pages are zero-filled on first touch, so
+// a large table costs nothing until it is used, and they bypass the
+// allocator hooks. Placement and huge pages are best effort; the table
+// falls back to base pages and default placement where the kernel refuses.
+typedef struct hashmap_table_memory {
+    bool mapped;                    // Map large arrays even with no huge-page or NUMA mode
+    int huge_pages;                 // HASHMAP_HUGE_*
+    int numa_policy;                // HASHMAP_NUMA_*
+    unsigned long numa_nodes;       // Node mask for numa_policy, bit n selecting node n
+    size_t min_bytes;               // Smaller arrays use the allocator (0 defaults to HASHMAP_HUGE_PAGE_SIZE)
+} hashmap_table_memory_t;
+
+#define HASHMAP_DEFAULT_CAPACITY 16       // Buckets used when 0 is requested
+#define HASHMAP_DEFAULT_MAX_LOAD_FACTOR 0.75  // Entries per bucket that trigger growth
+#define HASHMAP_DEFAULT_GROWTH_FACTOR 2   // Capacity multiplier applied on growth
+#define HASHMAP_POOL_DEFAULT_KEY_SIZE 24  // Largest key served by the entry pool by default
+#define HASHMAP_POOL_SLAB_BYTES 65536     // Bytes requested from the allocator per slab
+#define HASHMAP_MIGRATE_BUCKETS 16        // Old buckets moved per put/remove during an incremental resize
+#define HASHMAP_BATCH_WINDOW 16           // Keys hashed and prefetched together by the batch API
+#define HASHMAP_CACHE_LINE 64             // Padding unit for data shared between threads
+#define HASHMAP_DEFAULT_PARTITIONS 64     // Segments/shards used when options->concurrency is 0
+#define HASHMAP_TTL_NEVER UINT64_MAX      // Deadline of entries stored without a TTL
+#define HASHMAP_HUGE_PAGE_SIZE ((size_t)2 << 20)  // Huge-page size mapped tables are aligned and rounded to
+
+// Direct page mapping needs MAP_ANONYMOUS, which strict -std=c11 hides
+// unless _DEFAULT_SOURCE (or _GNU_SOURCE) is defined before the includes
+#if defined(MAP_ANONYMOUS)
+#define HASHMAP_HAVE_MAP_TABLES 1
+#else
+#define HASHMAP_HAVE_MAP_TABLES 0
+#endif
+
+// Software prefetch hint (no-op on compilers without the builtin)
+#if defined(__GNUC__) || defined(__clang__)
+#define HASHMAP_PREFETCH(addr) __builtin_prefetch((addr), 0, 3)
+#else
+#define HASHMAP_PREFETCH(addr) ((void)(addr))
+#endif
+
+// Keeps rarely taken slow paths out of inlined hot loops
+#if defined(__GNUC__) || defined(__clang__)
+#define HASHMAP_NOINLINE __attribute__((noinline))
+#else
+#define HASHMAP_NOINLINE
+#endif
+
+// Instrumentation (define HASHMAP_ENABLE_STATS before including to enable).
+// Counters are relaxed atomics so readers under a shared lock and parallel
+// workers can bump them; without the define every hook expands to nothing.
+#ifdef HASHMAP_ENABLE_STATS
+#include <stdatomic.h>
+
+// Instrumentation counters (internal structure)
+typedef struct hashmap_counters {
+    atomic_uint_fast64_t resizes;       // Growth or shrink operations started
+    atomic_uint_fast64_t resize_ns;     // Time spent allocating and rehashing tables
+    atomic_uint_fast64_t lookups;       // hashmap_get/hashmap_get_with_hash calls
+    atomic_uint_fast64_t probes;        // Entries compared by those lookups
+    atomic_uint_fast64_t max_probe;     // Longest single lookup
+    atomic_uint_fast64_t alloc_bytes;   // Bytes currently held from the allocator
+    atomic_uint_fast64_t peak_bytes;    // High-water mark of alloc_bytes
+    atomic_uint_fast64_t allocations;   // Allocator calls made
+} hashmap_counters_t;
+
+// Nanoseconds on the C11 wall clock (internal function)
+static inline uint64_t hashmap_counters_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Raise *slot to at least value (internal function)
+static inline void hashmap_counters_max(atomic_uint_fast64_t *slot, uint_fast64_t value) {
+    uint_fast64_t seen = atomic_load_explicit(slot, memory_order_relaxed);
+    while (seen < value &&
+           !atomic_compare_exchange_weak_explicit(slot, &seen, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Counters live in the map; lookups take a const map, hence the cast
+#define HASHMAP_STAT_ADD(map, field, n) \
+    atomic_fetch_add_explicit(&((hashmap_t *)(map))->counters.field, (uint_fast64_t)(n), memory_order_relaxed)
+#define HASHMAP_STAT_LOOKUP(map, n) do { \
+        HASHMAP_STAT_ADD(map, lookups, 1); \
+        HASHMAP_STAT_ADD(map, probes, n); \
+        hashmap_counters_max(&((hashmap_t *)(map))->counters.max_probe, (n)); \
+    } while (0)
+#define HASHMAP_STAT_ALLOC(map, bytes) do { \
+        HASHMAP_STAT_ADD(map, allocations, 1); \
+        hashmap_counters_max(&(map)->counters.peak_bytes, HASHMAP_STAT_ADD(map, alloc_bytes, bytes) + (bytes)); \
+    } while (0)
+// Bytes handed over by another map count toward this one without an allocation
+#define HASHMAP_STAT_ADOPT(map, bytes) \
+    hashmap_counters_max(&(map)->counters.peak_bytes, HASHMAP_STAT_ADD(map, alloc_bytes, bytes) + (bytes))
+#define HASHMAP_STAT_FREE(map, bytes) atomic_fetch_sub_explicit(&(map)->counters.alloc_bytes, \
+                                                                (uint_fast64_t)(bytes), memory_order_relaxed)
+#define HASHMAP_STAT_TIMER_START(name) uint64_t name = hashmap_counters_now()
+#define HASHMAP_STAT_TIMER_STOP(map, name) HASHMAP_STAT_ADD(map, resize_ns, hashmap_counters_now() - (name))
+#else
+#define HASHMAP_STAT_ADD(map, field, n) ((void)0)
+#define HASHMAP_STAT_LOOKUP(map, n) ((void)0)
+#define HASHMAP_STAT_ALLOC(map, bytes) ((void)0)
+#define HASHMAP_STAT_ADOPT(map, bytes) ((void)0)
+#define HASHMAP_STAT_FREE(map, bytes) ((void)0)
+#define HASHMAP_STAT_TIMER_START(name) ((void)0)
+#define HASHMAP_STAT_TIMER_STOP(map, name) ((void)0)
+#endif
+
+// Hashmap entry structure (entry and key share one allocation)
 typedef struct hashmap_entry {
-    void *key;                      // Copied key data
+    struct hashmap_entry *next;     // For chaining
+    size_t hash;                    // Cached hash of the key
     size_t key_size;                // Size of key in bytes
     void *value;                    // Value pointer (not copied)
-    struct hashmap_entry *next;     // For chaining
+    unsigned char key[];            // Copied key data, stored inline
 } hashmap_entry_t;
 
+// Creation options (zero-initialize for defaults)
+typedef struct hashmap_options {
+    size_t initial_capacity;        // Initial number of buckets (0 defaults to 16)
+    key_free_func_t key_free;       // Not used (keys are always copied and freed internally)
+    value_free_func_t value_free;   // NULL for no cleanup
+    hash_func_t hash_func;          // NULL selects the built-in wide-word hash
+    hashmap_allocator_t allocator;  // Zeroed selects malloc/free
+    bool entry_pool;                // Carve entries from map-owned slabs with free-list reuse
+    size_t pool_key_size;           // Largest pooled key (0 defaults to HASHMAP_POOL_DEFAULT_KEY_SIZE)
+    bool incremental_resize;        // Spread growth rehashing across later put/remove calls
+    bool deferred_resize;           // Leave growth rehashing to hashmap_resize_step (or a resizer thread)
+    double max_load_factor;         // Grow once size reaches capacity * this (0 defaults to 0.75)
+    size_t growth_factor;           // Growth multiplier, rounded up to a power of two (0 defaults to 2)
+    size_t concurrency;             // Segments for hashmap_concurrent_*/hashmap_sharded_* (0 defaults to 64)
+    bool resize_thread;             // hashmap_concurrent_*: drain deferred resizes on a background thread
+    size_t value_size;              // Copy values of this size into the entry (0 stores the void * itself)
+    size_t cache_capacity;          // Hold at most this many entries, evicting in CLOCK order (0 for no bound)
+    hashmap_evict_func_t on_evict;  // NULL for no eviction callback
+    void *evict_ctx;                // Passed to on_evict
+    bool expiry;                    // Keep a deadline per entry for hashmap_put_ttl
+    hashmap_clock_func_t clock;     // NULL selects the monotonic clock
+    void *clock_ctx;                // Passed to clock
+    hashmap_table_memory_t table_memory;  // Zeroed allocates tables through the allocator hooks
+} hashmap_options_t;
+
+// Visitor for hashmap_foreach; return false to stop the walk
+typedef bool (*hashmap_visit_func_t)(const void *key, size_t key_size, void *value, void *ctx);
+
+// Resolves a key present in both maps of hashmap_merge and returns the value
+// to keep; values are what hashmap_get returns for each map
+typedef void *(*hashmap_combine_func_t)(const void *key, size_t key_size, void *dst_value,
+                                        void *src_value, void *ctx);
+
+// Slab pool for fixed-size entries (internal structure)
+typedef struct hashmap_pool {
+    void *slabs;                    // Singly linked through each slab's first word
+    unsigned char *bump;            // Next never-used slot in the newest slab
+    unsigned char *bump_end;
+    hashmap_entry_t *free_list;     // Released slots, linked through entry->next
+    size_t slot_size;               // 0 when the pool is disabled
+    size_t slot_align;              // Alignment of slab headers and slots
+    size_t key_limit;               // Entries with key_size <= key_limit are pooled
+} hashmap_pool_t;
+
 // Hashmap structure
 typedef struct hashmap {
     hashmap_entry_t **buckets;
-    size_t capacity;
+    size_t capacity;                // Always a power of two
     size_t size;
     key_free_func_t key_free;       // Not used (keys are always copied and freed internally)
     value_free_func_t value_free;
+    hash_func_t hash_func;          // NULL for the built-in hash
+    size_t value_size;              // Inline value bytes per entry, 0 for pointer values
+    size_t value_align;             // Alignment of inline values
+    double max_load_factor;
+    size_t max_entries;             // Growth threshold for the current capacity
+    unsigned growth_shift;          // log2 of the growth factor
+    hashmap_allocator_t allocator;
+    hashmap_table_memory_t table_memory;
+    hashmap_pool_t pool;
+    bool incremental;               // Grow by migrating buckets a few at a time
+    bool deferred;                  // Migration is driven by hashmap_resize_step
+    hashmap_entry_t **old_buckets;  // Table being drained by an incremental resize, or NULL
+    size_t old_capacity;
+    size_t migrate_index;           // Old buckets below this index have been migrated
+    size_t cache_capacity;          // Entry bound in cache mode, 0 otherwise
+    size_t clock_hand;              // Next bucket the eviction sweep visits
+    hashmap_evict_func_t on_evict;
+    void *evict_ctx;
+    bool expiry;                    // Entries carry a deadline
+    hashmap_clock_func_t clock;
+    void *clock_ctx;
+    size_t expire_cursor;           // Next bucket hashmap_expire_step visits
+#ifdef HASHMAP_ENABLE_STATS
+    hashmap_counters_t counters;    // Read through hashmap_stats (hashmap_stats.h)
+#endif
 } hashmap_t;
 
-// Generic byte-wise hash function (FNV-1a algorithm)
-static inline size_t hashmap_generic_hash(const void *key, size_t key_size) {
+// Byte-wise FNV-1a hash, kept for compatibility (width-appropriate constants)
+static inline size_t hashmap_fnv1a_hash(const void *key, size_t key_size) {
     const uint8_t *data = (const uint8_t *)key;
+#if SIZE_MAX > 0xFFFFFFFFu
+    size_t hash = (size_t)14695981039346656037ULL;  // FNV-64 offset basis
+    const size_t prime = (size_t)1099511628211ULL;  // FNV-64 prime
+#else
     size_t hash = 2166136261UL;  // FNV offset basis
+    const size_t prime = 16777619UL;  // FNV prime
+#endif
     
     for (size_t i = 0; i < key_size; i++) {
         hash ^= data[i];
-        hash *= 16777619UL;  // FNV prime
+        hash *= prime;
     }
     
     return hash;
 }
 
-// Generic byte-wise comparison function
-static inline int hashmap_generic_compare(const void *key1, const void *key2, size_t key_size) {
-    return memcmp(key1, key2, key_size);
+// Unaligned little-endian-agnostic loads (compile to single moves)
+static inline uint64_t hashmap_read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
 }
 
-// Resize the hashmap (internal function)
-static inline bool hashmap_resize(hashmap_t *map, size_t new_capacity) {
-    hashmap_entry_t **new_buckets = (hashmap_entry_t **)calloc(new_capacity, sizeof(hashmap_entry_t *));
-    if (!new_buckets) {
-        return false;
-    }
+static inline uint64_t hashmap_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
 
-    // Rehash all entries
-    for (size_t i = 0; i < map->capacity; i++) {
-        hashmap_entry_t *entry = map->buckets[i];
-        while (entry) {
-            hashmap_entry_t *next = entry->next;
-            
-            // Calculate new bucket index using stored key_size
-            size_t hash = hashmap_generic_hash(entry->key, entry->key_size);
-            size_t new_index = hash % new_capacity;
-            
-            // Insert into new bucket
-            entry->next = new_buckets[new_index];
-            new_buckets[new_index] = entry;
-            
-            entry = next;
+// 64x64 -> 128-bit multiply; *a receives the low half, *b the high half
+static inline void hashmap_mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static inline uint64_t hashmap_mum_mix(uint64_t a, uint64_t b) {
+    hashmap_mum(&a, &b);
+    return a ^ b;
+}
+
+// Wide-word hash (wyhash construction): consumes 16-48 bytes per round with
+// 128-bit multiplies, so long keys hash several times faster than FNV-1a and
+// every output bit depends on every input bit
+static inline size_t hashmap_wyhash(const void *key, size_t key_size) {
+    static const uint64_t s0 = 0xa0761d6478bd642fULL, s1 = 0xe7037ed1a0b428dbULL,
+                          s2 = 0x8ebc6af09c88c6e3ULL, s3 = 0x589965cc75374cc3ULL;
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t seed = hashmap_mum_mix(s0, s1);
+    uint64_t a, b;
+
+    if (key_size <= 16) {
+        if (key_size >= 4) {
+            size_t mid = (key_size >> 3) << 2;
+            a = (hashmap_read32(p) << 32) | hashmap_read32(p + mid);
+            b = (hashmap_read32(p + key_size - 4) << 32) | hashmap_read32(p + key_size - 4 - mid);
+        } else if (key_size > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[key_size >> 1] << 8) | p[key_size - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = key_size;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = hashmap_mum_mix(hashmap_read64(p) ^ s1, hashmap_read64(p + 8) ^ seed);
+                see1 = hashmap_mum_mix(hashmap_read64(p + 16) ^ s2, hashmap_read64(p + 24) ^ see1);
+                see2 = hashmap_mum_mix(hashmap_read64(p + 32) ^ s3, hashmap_read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
         }
+        while (i > 16) {
+            seed = hashmap_mum_mix(hashmap_read64(p) ^ s1, hashmap_read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = hashmap_read64(p + i - 16);
+        b = hashmap_read64(p + i - 8);
     }
 
-    free(map->buckets);
-    map->buckets = new_buckets;
-    map->capacity = new_capacity;
-    
-    return true;
+    a ^= s1;
+    b ^= seed;
+    hashmap_mum(&a, &b);
+    uint64_t hash = hashmap_mum_mix(a ^ s0 ^ (uint64_t)key_size, b ^ s1);
+#if SIZE_MAX > 0xFFFFFFFFu
+    return (size_t)hash;
+#else
+    return (size_t)(hash ^ (hash >> 32));
+#endif
 }
 
-// Create a new hashmap
-static inline hashmap_t *hashmap_create(
-    size_t initial_capacity,
-    key_free_func_t key_free,
-    value_free_func_t value_free
-) {
-    if (initial_capacity == 0) {
-        initial_capacity = 16; // Default capacity
+// Default hash function used when no hash_func is supplied
+static inline size_t hashmap_generic_hash(const void *key, size_t key_size) {
+    return hashmap_wyhash(key, key_size);
+}
+
+// Final avalanche step (murmur3 finalizer) so that masking off the low bits
+// for a power-of-two table still depends on every bit of a weak raw hash
+static inline size_t hashmap_mix_hash(size_t hash) {
+#if SIZE_MAX > 0xFFFFFFFFu
+    uint64_t h = (uint64_t)hash;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (size_t)h;
+#else
+    uint32_t h = (uint32_t)hash;
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return (size_t)h;
+#endif
+}
+
+// Hash a key the way a table with the given hash function stores it. The
+// built-in hash is already well mixed; user-supplied ones (FNV-1a included)
+// get the finalizer so masking never sees clustered low bits
+static inline size_t hashmap_hash_key(hash_func_t hash_func, const void *key, size_t key_size) {
+    if (!hash_func) {
+        return hashmap_generic_hash(key, key_size);
     }
+    return hashmap_mix_hash(hash_func(key, key_size));
+}
 
-    hashmap_t *map = (hashmap_t *)malloc(sizeof(hashmap_t));
-    if (!map) {
-        return NULL;
+// Partition for a hash among 2^bits partitions. Uses the top bits, which stay
+// independent of the low bits a bucket mask consumes.
+static inline size_t hashmap_partition_index(size_t hash, unsigned bits) {
+    return bits ? hash >> (sizeof(size_t) * 8 - bits) : 0;
+}
+
+// Bucket index for a hash; capacity is always a power of two
+static inline size_t hashmap_bucket_index(size_t hash, size_t capacity) {
+    return hash & (capacity - 1);
+}
+
+// Round a requested capacity up to the next power of two
+static inline size_t hashmap_round_capacity(size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < capacity && rounded <= SIZE_MAX / 2) {
+        rounded <<= 1;
     }
+    return rounded;
+}
 
-    map->buckets = (hashmap_entry_t **)calloc(initial_capacity, sizeof(hashmap_entry_t *));
-    if (!map->buckets) {
-        free(map);
-        return NULL;
+// Entries a table of the given capacity may hold before it grows
+static inline size_t hashmap_load_threshold(size_t capacity, double max_load_factor) {
+    double limit = (double)capacity * max_load_factor;
+    return limit >= (double)SIZE_MAX ? SIZE_MAX : (size_t)limit;
+}
+
+// Smallest power-of-two capacity whose threshold holds n_entries, or SIZE_MAX
+static inline size_t hashmap_capacity_for_load(size_t n_entries, double max_load_factor) {
+    double estimate = (double)n_entries / max_load_factor;
+    if (estimate >= (double)(SIZE_MAX / 2)) {
+        return SIZE_MAX;
+    }
+    size_t capacity = hashmap_round_capacity((size_t)estimate);
+    while (hashmap_load_threshold(capacity, max_load_factor) < n_entries) {
+        if (capacity > SIZE_MAX / 2) {
+            return SIZE_MAX;
+        }
+        capacity <<= 1;
     }
+    return capacity;
+}
 
-    map->capacity = initial_capacity;
-    map->size = 0;
-    map->key_free = key_free;  // Not used, but kept for API compatibility
-    map->value_free = value_free;
+// Smallest bucket count that holds n_entries without a resize (default load factor)
+static inline size_t hashmap_capacity_for(size_t n_entries) {
+    return hashmap_capacity_for_load(n_entries, HASHMAP_DEFAULT_MAX_LOAD_FACTOR);
+}
 
-    return map;
+// Validated load factor from options; NaN and non-positive values select the default
+static inline double hashmap_options_load_factor(const hashmap_options_t *options, double fallback) {
+    return options->max_load_factor > 0 ? options->max_load_factor : fallback;
 }
 
-// Clear all entries from the hashmap
-static inline void hashmap_clear(hashmap_t *map) {
-    if (!map) {
-        return;
+// log2 of the growth factor rounded up to a power of two, at least 1
+static inline unsigned hashmap_options_growth_shift(const hashmap_options_t *options) {
+    size_t factor = options->growth_factor ? options->growth_factor : HASHMAP_DEFAULT_GROWTH_FACTOR;
+    unsigned shift = 1;
+    while (shift < sizeof(size_t) * 8 - 1 && ((size_t)1 << shift) < factor) {
+        shift++;
     }
+    return shift;
+}
 
-    for (size_t i = 0; i < map->capacity; i++) {
-        hashmap_entry_t *entry = map->buckets[i];
-        while (entry) {
-            hashmap_entry_t *next = entry->next;
-            
-            // Free the copied key
-            free(entry->key);
-            
-            // Free value if needed
-            if (map->value_free) {
-                map->value_free(entry->value);
-            }
-            
-            free(entry);
-            entry = next;
+// Alignment for an inline value: the largest power of two dividing value_size,
+// capped at max_align_t (internal function)
+static inline size_t hashmap_value_align(size_t value_size) {
+    size_t align = _Alignof(max_align_t);
+    while (align > 1 && value_size % align != 0) {
+        align >>= 1;
+    }
+    return align;
+}
+
+// Generic byte-wise comparison function
+static inline int hashmap_generic_compare(const void *key1, const void *key2, size_t key_size) {
+    return memcmp(key1, key2, key_size);
+}
+
+// Whether two keys of key_size bytes are equal. Keys up to 16 bytes compare
+// as two overlapping words and keys up to 32 as two overlapping vectors, so
+// the common sizes cost a few loads and no library call; longer keys use
+// memcmp (internal function)
+static inline bool hashmap_key_equal(const void *key1, const void *key2, size_t key_size) {
+    const uint8_t *a = (const uint8_t *)key1;
+    const uint8_t *b = (const uint8_t *)key2;
+    if (key_size >= 8) {
+        if (key_size <= 16) {
+            return ((hashmap_read64(a) ^ hashmap_read64(b)) |
+                    (hashmap_read64(a + key_size - 8) ^ hashmap_read64(b + key_size - 8))) == 0;
         }
-        map->buckets[i] = NULL;
+#if defined(__SSE2__)
+        if (key_size <= 32) {
+            __m128i head = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b));
+            __m128i tail = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + key_size - 16)),
+                                          _mm_loadu_si128((const __m128i *)(b + key_size - 16)));
+            return _mm_movemask_epi8(_mm_and_si128(head, tail)) == 0xFFFF;
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        if (key_size <= 32) {
+            uint8x16_t head = vceqq_u8(vld1q_u8(a), vld1q_u8(b));
+            uint8x16_t tail = vceqq_u8(vld1q_u8(a + key_size - 16), vld1q_u8(b + key_size - 16));
+            return vminvq_u8(vandq_u8(head, tail)) == 0xFF;
+        }
+#endif
+        return memcmp(a, b, key_size) == 0;
     }
-    
-    map->size = 0;
+    if (key_size >= 4) {
+        return ((hashmap_read32(a) ^ hashmap_read32(b)) |
+                (hashmap_read32(a + key_size - 4) ^ hashmap_read32(b + key_size - 4))) == 0;
+    }
+    if (key_size == 0) {
+        return true;
+    }
+    // First, middle and last byte cover every byte of a 1-3 byte key
+    return ((a[0] ^ b[0]) | (a[key_size >> 1] ^ b[key_size >> 1]) | (a[key_size - 1] ^ b[key_size - 1])) == 0;
 }
 
-// Destroy the hashmap and free all resources
-static inline void hashmap_destroy(hashmap_t *map) {
-    if (!map) {
+// Allocate through the map's hooks (internal function)
+static inline void *hashmap_mem_alloc(const hashmap_allocator_t *allocator, size_t size) {
+    return allocator->alloc ? allocator->alloc(size, allocator->ctx) : malloc(size);
+}
+
+// Release memory obtained from hashmap_mem_alloc (internal function)
+static inline void hashmap_mem_free(const hashmap_allocator_t *allocator, void *ptr, size_t size) {
+    if (!ptr) {
         return;
     }
-
-    hashmap_clear(map);
-    free(map->buckets);
-    free(map);
+    if (allocator->dealloc) {
+        allocator->dealloc(ptr, size, allocator->ctx);
+    } else {
+        free(ptr);
+    }
 }
 
-// Insert or update a key-value pair
-static inline bool hashmap_put(hashmap_t *map, const void *key, size_t key_size, void *value) {
-    if (!map || !key || key_size == 0) {
+// Whether a table array of this size is mapped directly. Depends only on
+// the policy and the size, so the free path agrees with the allocation
+// (internal function)
+static inline bool hashmap_table_mapped(const hashmap_table_memory_t *memory, size_t bytes) {
+    if (!HASHMAP_HAVE_MAP_TABLES ||
+        (!memory->mapped && memory->huge_pages == HASHMAP_HUGE_NONE && memory->numa_policy == HASHMAP_NUMA_DEFAULT)) {
         return false;
     }
+    return bytes >= (memory->min_bytes ? memory->min_bytes : HASHMAP_HUGE_PAGE_SIZE);
+}
 
-    // Resize if load factor exceeds 0.75
-    if (map->size >= map->capacity * 3 / 4) {
-        if (!hashmap_resize(map, map->capacity * 2)) {
-            return false;
-        }
+// Length of the mapping behind a mapped table array (internal function)
+static inline size_t hashmap_table_map_length(const hashmap_table_memory_t *memory, size_t bytes) {
+    if (memory->huge_pages == HASHMAP_HUGE_NONE || bytes > SIZE_MAX - HASHMAP_HUGE_PAGE_SIZE) {
+        return bytes;
     }
+    return (bytes + HASHMAP_HUGE_PAGE_SIZE - 1) & ~(HASHMAP_HUGE_PAGE_SIZE - 1);
+}
 
-    size_t hash = hashmap_generic_hash(key, key_size);
-    size_t index = hash % map->capacity;
-
-    // Check if key already exists
-    hashmap_entry_t *entry = map->buckets[index];
-    while (entry) {
-        if (entry->key_size == key_size && 
-            hashmap_generic_compare(entry->key, key, key_size) == 0) {
-            // Update existing entry
-            if (map->value_free && entry->value != value) {
-                map->value_free(entry->value);
-            }
-            entry->value = value;
-            return true;
-        }
-        entry = entry->next;
+#if HASHMAP_HAVE_MAP_TABLES
+// Anonymous mapping aligned to a huge page, trimmed from an oversized one (internal function)
+static inline void *hashmap_table_map_aligned(size_t length) {
+    if (length > SIZE_MAX - HASHMAP_HUGE_PAGE_SIZE) {
+        return NULL;
+    }
+    size_t span = length + HASHMAP_HUGE_PAGE_SIZE;
+    void *raw = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    uintptr_t start = ((uintptr_t)raw + HASHMAP_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HASHMAP_HUGE_PAGE_SIZE - 1);
+    size_t head = (size_t)(start - (uintptr_t)raw);
+    if (head) {
+        munmap(raw, head);
+    }
+    if (span - head > length) {
+        munmap((unsigned char *)start + length, span - head - length);
     }
+    return (void *)start;
+}
 
-    // Create new entry and copy the key
-    entry = (hashmap_entry_t *)malloc(sizeof(hashmap_entry_t));
-    if (!entry) {
-        return false;
+// Apply the NUMA policy before any page is touched (internal function)
+static inline void hashmap_table_place(void *ptr, size_t length, const hashmap_table_memory_t *memory) {
+#if defined(__linux__) && defined(SYS_mbind)
+    if (memory->numa_policy == HASHMAP_NUMA_DEFAULT) {
+        return;
     }
+    // Linux MPOL_BIND / MPOL_INTERLEAVE, spelled out to avoid requiring <numaif.h>
+    int mode = memory->numa_policy == HASHMAP_NUMA_BIND ? 2 : 3;
+    unsigned long nodes = memory->numa_nodes ? memory->numa_nodes : ~0UL;
+    syscall(SYS_mbind, ptr, length, mode, &nodes, sizeof(nodes) * 8 + 1, 0UL);  // Refusal keeps default placement
+#else
+    (void)ptr;
+    (void)length;
+    (void)memory;
+#endif
+}
+#endif
 
-    entry->key = malloc(key_size);
-    if (!entry->key) {
-        free(entry);
-        return false;
+// Map a zero-filled table array under the policy, or NULL (internal function)
+static inline void *hashmap_table_map(const hashmap_table_memory_t *memory, size_t bytes) {
+#if HASHMAP_HAVE_MAP_TABLES
+    size_t length = hashmap_table_map_length(memory, bytes);
+    void *ptr = NULL;
+#if defined(MAP_HUGETLB)
+    if (memory->huge_pages == HASHMAP_HUGE_EXPLICIT) {
+        ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        ptr = ptr == MAP_FAILED ? NULL : ptr;  // Pool empty or absent: fall back to transparent pages
     }
-    memcpy(entry->key, key, key_size);
-    entry->key_size = key_size;
-    entry->value = value;
-    entry->next = map->buckets[index];
-    map->buckets[index] = entry;
-    map->size++;
+#endif
+    if (!ptr && memory->huge_pages != HASHMAP_HUGE_NONE) {
+        ptr = hashmap_table_map_aligned(length);
+#if defined(MADV_HUGEPAGE)
+        if (ptr) {
+            madvise(ptr, length, MADV_HUGEPAGE);
+        }
+#endif
+    } else if (!ptr) {
+        ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        ptr = ptr == MAP_FAILED ? NULL : ptr;
+    }
+    if (ptr) {
+        hashmap_table_place(ptr, length, memory);
+    }
+    return ptr;
+#else
+    (void)memory;
+    (void)bytes;
+    return NULL;
+#endif
+}
 
-    return true;
+// Release a table array from hashmap_table_map (internal function)
+static inline void hashmap_table_unmap(const hashmap_table_memory_t *memory, void *ptr, size_t bytes) {
+#if HASHMAP_HAVE_MAP_TABLES
+    if (ptr) {
+        munmap(ptr, hashmap_table_map_length(memory, bytes));
+    }
+#else
+    (void)memory;
+    (void)ptr;
+    (void)bytes;
+#endif
 }
 
-// Get the value associated with a key
-static inline void *hashmap_get(const hashmap_t *map, const void *key, size_t key_size) {
-    if (!map || !key || key_size == 0) {
+// Allocate a zeroed bucket array (internal function)
+static inline hashmap_entry_t **hashmap_buckets_alloc(const hashmap_t *map, size_t capacity) {
+    if (capacity > SIZE_MAX / sizeof(hashmap_entry_t *)) {
         return NULL;
     }
+    size_t bytes = capacity * sizeof(hashmap_entry_t *);
+    if (hashmap_table_mapped(&map->table_memory, bytes)) {
+        return (hashmap_entry_t **)hashmap_table_map(&map->table_memory, bytes);
+    }
+    if (!map->allocator.alloc) {
+        return (hashmap_entry_t **)calloc(capacity, sizeof(hashmap_entry_t *));
+    }
+    hashmap_entry_t **buckets = (hashmap_entry_t **)hashmap_mem_alloc(&map->allocator, bytes);
+    if (buckets) {
+        memset(buckets, 0, bytes);
+    }
+    return buckets;
+}
+
+// Release a bucket array from hashmap_buckets_alloc (internal function)
+static inline void hashmap_buckets_free(const hashmap_t *map, hashmap_entry_t **buckets, size_t capacity) {
+    size_t bytes = capacity * sizeof(hashmap_entry_t *);
+    if (hashmap_table_mapped(&map->table_memory, bytes)) {
+        hashmap_table_unmap(&map->table_memory, buckets, bytes);
+    } else {
+        hashmap_mem_free(&map->allocator, buckets, bytes);
+    }
+}
+
+// Whether entries with key_size key bytes are carved from the pool (internal function)
+static inline bool hashmap_entry_pooled(const hashmap_t *map, size_t key_size) {
+    return map->pool.slot_size != 0 && key_size <= map->pool.key_limit;
+}
+
+// Bytes behind the key: a CLOCK reference byte in cache mode, then an
+// unaligned 64-bit deadline with expiry (internal function)
+static inline size_t hashmap_entry_tail(const hashmap_t *map) {
+    return (size_t)(map->cache_capacity != 0) + (map->expiry ? sizeof(uint64_t) : 0);
+}
 
-    size_t hash = hashmap_generic_hash(key, key_size);
-    size_t index = hash % map->capacity;
+static inline unsigned char *hashmap_entry_ref(hashmap_entry_t *entry) {
+    return entry->key + entry->key_size;
+}
+
+static inline uint64_t hashmap_entry_deadline(const hashmap_t *map, const hashmap_entry_t *entry) {
+    uint64_t deadline;
+    memcpy(&deadline, entry->key + entry->key_size + (map->cache_capacity != 0), sizeof(deadline));
+    return deadline;
+}
+
+static inline void hashmap_entry_set_deadline(const hashmap_t *map, hashmap_entry_t *entry, uint64_t deadline) {
+    memcpy(entry->key + entry->key_size + (map->cache_capacity != 0), &deadline, sizeof(deadline));
+}
+
+// Offset of an inline value behind a key of key_size bytes (internal function)
+static inline size_t hashmap_entry_value_offset(const hashmap_t *map, size_t key_size) {
+    size_t align = map->value_align;
+    return (sizeof(hashmap_entry_t) + key_size + hashmap_entry_tail(map) + align - 1) / align * align;
+}
+
+// Bytes in an entry allocation: header, key, the reference byte in cache mode
+// and, in value_size mode, the value (internal function)
+static inline size_t hashmap_entry_bytes(const hashmap_t *map, size_t key_size) {
+    if (map->value_size) {
+        return hashmap_entry_value_offset(map, key_size) + map->value_size;
+    }
+    return sizeof(hashmap_entry_t) + key_size + hashmap_entry_tail(map);
+}
 
-    hashmap_entry_t *entry = map->buckets[index];
-    while (entry) {
-        if (entry->key_size == key_size && 
-            hashmap_generic_compare(entry->key, key, key_size) == 0) {
-            return entry->value;
+// Mark an entry as recently used in cache mode. Only writes when the bit is
+// clear, so repeated hits leave the line clean (internal function)
+static inline void hashmap_cache_touch(const hashmap_t *map, hashmap_entry_t *entry) {
+    if (map->cache_capacity) {
+        unsigned char *ref = hashmap_entry_ref(entry);
+        if (!*ref) {
+            *ref = 1;
         }
-        entry = entry->next;
     }
+}
 
-    return NULL;
+// The monotonic clock where POSIX provides one, else the C11 wall clock
+// (internal function)
+static inline struct timespec hashmap_clock_read(void) {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return ts;
 }
 
-// Remove a key-value pair
-static inline bool hashmap_remove(hashmap_t *map, const void *key, size_t key_size) {
-    if (!map || !key || key_size == 0) {
+// Milliseconds on hashmap_clock_read's clock (internal function)
+static inline uint64_t hashmap_clock_now(void *ctx) {
+    (void)ctx;
+    struct timespec ts = hashmap_clock_read();
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+// Whether an entry's TTL has run out. The clock is read only for entries
+// that have a deadline (internal function)
+static inline bool hashmap_entry_expired(const hashmap_t *map, const hashmap_entry_t *entry) {
+    if (!map->expiry) {
         return false;
     }
+    uint64_t deadline = hashmap_entry_deadline(map, entry);
+    return deadline != HASHMAP_TTL_NEVER && deadline <= map->clock(map->clock_ctx);
+}
 
-    size_t hash = hashmap_generic_hash(key, key_size);
-    size_t index = hash % map->capacity;
+// Deadline ttl_ms from now, saturating at HASHMAP_TTL_NEVER (internal function)
+static inline uint64_t hashmap_ttl_deadline(const hashmap_t *map, uint64_t ttl_ms) {
+    uint64_t now = map->clock(map->clock_ctx);
+    return ttl_ms >= HASHMAP_TTL_NEVER - now ? HASHMAP_TTL_NEVER : now + ttl_ms;
+}
 
-    hashmap_entry_t *entry = map->buckets[index];
-    hashmap_entry_t *prev = NULL;
+// Slab layout: [next slab pointer, padded to slot alignment][slots...] (internal function)
+static inline size_t hashmap_pool_header_bytes(const hashmap_pool_t *pool) {
+    return (sizeof(void *) + pool->slot_align - 1) / pool->slot_align * pool->slot_align;
+}
 
-    while (entry) {
-        if (entry->key_size == key_size && 
-            hashmap_generic_compare(entry->key, key, key_size) == 0) {
-            // Remove entry from chain
-            if (prev) {
-                prev->next = entry->next;
-            } else {
-                map->buckets[index] = entry->next;
-            }
+static inline size_t hashmap_pool_slots_per_slab(const hashmap_pool_t *pool) {
+    size_t slots = (HASHMAP_POOL_SLAB_BYTES - hashmap_pool_header_bytes(pool)) / pool->slot_size;
+    return slots ? slots : 1;
+}
 
-            // Free the copied key
-            free(entry->key);
-            
-            // Free value if needed
-            if (map->value_free) {
-                map->value_free(entry->value);
-            }
+// Allocate an entry, from the pool when the key fits a slot (internal function)
+static inline hashmap_entry_t *hashmap_entry_alloc(hashmap_t *map, size_t key_size) {
+    hashmap_pool_t *pool = &map->pool;
+    if (!hashmap_entry_pooled(map, key_size)) {
+        hashmap_entry_t *entry = (hashmap_entry_t *)hashmap_mem_alloc(&map->allocator,
+                                                                      hashmap_entry_bytes(map, key_size));
+        if (entry) {
+            HASHMAP_STAT_ALLOC(map, hashmap_entry_bytes(map, key_size));
+        }
+        return entry;
+    }
 
-            free(entry);
-            map->size--;
-            return true;
+    if (pool->free_list) {
+        hashmap_entry_t *entry = pool->free_list;
+        pool->free_list = entry->next;
+        return entry;
+    }
+
+    if (pool->bump == pool->bump_end) {
+        size_t slab_bytes = pool->slot_size * hashmap_pool_slots_per_slab(pool);
+        unsigned char *slab = (unsigned char *)hashmap_mem_alloc(&map->allocator,
+                                                                 hashmap_pool_header_bytes(pool) + slab_bytes);
+        if (!slab) {
+            return NULL;
         }
-        prev = entry;
-        entry = entry->next;
+        HASHMAP_STAT_ALLOC(map, hashmap_pool_header_bytes(pool) + slab_bytes);
+        memcpy(slab, &pool->slabs, sizeof(void *));
+        pool->slabs = slab;
+        pool->bump = slab + hashmap_pool_header_bytes(pool);
+        pool->bump_end = pool->bump + slab_bytes;
     }
 
-    return false;
+    hashmap_entry_t *entry = (hashmap_entry_t *)pool->bump;
+    pool->bump += pool->slot_size;
+    return entry;
 }
 
-// Check if a key exists in the hashmap
-static inline bool hashmap_contains(const hashmap_t *map, const void *key, size_t key_size) {
-    return hashmap_get(map, key, key_size) != NULL;
+// Copy value_size bytes from value, or zero-fill when value is NULL. Out of
+// line, since the copy has a runtime size anyway (internal function)
+static HASHMAP_NOINLINE void hashmap_value_copy(const hashmap_t *map, void *dst, const void *value) {
+    if (value) {
+        memcpy(dst, value, map->value_size);
+    } else {
+        memset(dst, 0, map->value_size);
+    }
 }
 
-// Get the number of key-value pairs in the hashmap
-static inline size_t hashmap_size(const hashmap_t *map) {
-    return map ? map->size : 0;
+// Set the value of a new entry whose key_size is already filled in (internal function)
+static inline void hashmap_entry_init_value(const hashmap_t *map, hashmap_entry_t *entry, void *value) {
+    if (map->value_size) {
+        entry->value = (unsigned char *)entry + hashmap_entry_value_offset(map, entry->key_size);
+        hashmap_value_copy(map, entry->value, value);
+        return;
+    }
+    entry->value = value;
 }
 
-// Check if the hashmap is empty
-static inline bool hashmap_is_empty(const hashmap_t *map) {
-    return map ? map->size == 0 : true;
+// Replace the value of an existing entry (internal function)
+static inline void hashmap_entry_update_value(const hashmap_t *map, hashmap_entry_t *entry, void *value) {
+    if (map->value_size) {
+        hashmap_value_copy(map, entry->value, value);
+        return;
+    }
+    if (map->value_free && entry->value != value) {
+        map->value_free(entry->value);
+    }
+    entry->value = value;
+}
+
+// Return an entry to the pool free list or the allocator (internal function)
+static inline void hashmap_entry_release(hashmap_t *map, hashmap_entry_t *entry) {
+    hashmap_pool_t *pool = &map->pool;
+    if (hashmap_entry_pooled(map, entry->key_size)) {
+        entry->next = pool->free_list;
+        pool->free_list = entry;
+        return;
+    }
+    HASHMAP_STAT_FREE(map, hashmap_entry_bytes(map, entry->key_size));
+    hashmap_mem_free(&map->allocator, entry, hashmap_entry_bytes(map, entry->key_size));
+}
+
+// Release every slab at once; pooled entries must no longer be referenced (internal function)
+static inline void hashmap_pool_release(hashmap_t *map) {
+    hashmap_pool_t *pool = &map->pool;
+    while (pool->slabs) {
+        void *next;
+        memcpy(&next, pool->slabs, sizeof(void *));
+        size_t slab_bytes = hashmap_pool_header_bytes(pool) + pool->slot_size * hashmap_pool_slots_per_slab(pool);
+        HASHMAP_STAT_FREE(map, slab_bytes);
+        hashmap_mem_free(&map->allocator, pool->slabs, slab_bytes);
+        pool->slabs = next;
+    }
+    pool->bump = pool->bump_end = NULL;
+    pool->free_list = NULL;
+}
+
+// Unlink *link and drop its entry as evicted or expired: on_evict, then
+// value_free (internal function)
+static HASHMAP_NOINLINE void hashmap_entry_discard(hashmap_t *map, hashmap_entry_t **link) {
+    hashmap_entry_t *entry = *link;
+    *link = entry->next;
+    if (map->on_evict) {
+        map->on_evict(entry->key, entry->key_size, entry->value, map->evict_ctx);
+    }
+    if (map->value_free) {
+        map->value_free(entry->value);
+    }
+    hashmap_entry_release(map, entry);
+    map->size--;
+}
+
+// Move up to n_buckets old buckets into the current table (internal function)
+static inline void hashmap_migrate_step(hashmap_t *map, size_t n_buckets) {
+    if (!map->old_buckets) {
+        return;
+    }
+    HASHMAP_STAT_TIMER_START(started);
+
+    size_t end = map->old_capacity - map->migrate_index < n_buckets ? map->old_capacity
+                                                                    : map->migrate_index + n_buckets;
+    for (size_t i = map->migrate_index; i < end; i++) {
+        hashmap_entry_t *entry = map->old_buckets[i];
+        while (entry) {
+            hashmap_entry_t *next = entry->next;
+            
+            // Calculate new bucket index from the cached hash
+            size_t new_index = hashmap_bucket_index(entry->hash, map->capacity);
+            
+            // Insert into new bucket
+            entry->next = map->buckets[new_index];
+            map->buckets[new_index] = entry;
+            
+            entry = next;
+        }
+        map->old_buckets[i] = NULL;
+    }
+    map->migrate_index = end;
+
+    if (map->migrate_index == map->old_capacity) {
+        HASHMAP_STAT_FREE(map, map->old_capacity * sizeof(hashmap_entry_t *));
+        hashmap_buckets_free(map, map->old_buckets, map->old_capacity);
+        map->old_buckets = NULL;
+        map->old_capacity = 0;
+        map->migrate_index = 0;
+    }
+    HASHMAP_STAT_TIMER_STOP(map, started);
+}
+
+// Foreground share of a pending migration, run by every put and remove: a few
+// buckets, or in deferred mode nothing until the table has filled up again
+// without hashmap_resize_step catching up (internal function)
+static inline void hashmap_migrate_assist(hashmap_t *map) {
+    if (map->old_buckets && (!map->deferred || map->size >= map->max_entries)) {
+        hashmap_migrate_step(map, HASHMAP_MIGRATE_BUCKETS);
+    }
+}
+
+// Install a new bucket array and keep the old one for draining (internal function)
+static inline bool hashmap_resize_begin(hashmap_t *map, size_t new_capacity) {
+    // Only one migration at a time: finish the previous one first
+    hashmap_migrate_step(map, SIZE_MAX);
+
+    HASHMAP_STAT_TIMER_START(started);
+    hashmap_entry_t **new_buckets = hashmap_buckets_alloc(map, new_capacity);
+    if (!new_buckets) {
+        return false;
+    }
+    HASHMAP_STAT_ALLOC(map, new_capacity * sizeof(hashmap_entry_t *));
+    HASHMAP_STAT_ADD(map, resizes, 1);
+
+    map->old_buckets = map->buckets;
+    map->old_capacity = map->capacity;
+    map->migrate_index = 0;
+    map->buckets = new_buckets;
+    map->capacity = new_capacity;
+    map->max_entries = hashmap_load_threshold(new_capacity, map->max_load_factor);
+    HASHMAP_STAT_TIMER_STOP(map, started);
+    
+    return true;
+}
+
+// Resize the hashmap in one step (internal function)
+static inline bool hashmap_resize(hashmap_t *map, size_t new_capacity) {
+    if (!hashmap_resize_begin(map, new_capacity)) {
+        return false;
+    }
+    hashmap_migrate_step(map, SIZE_MAX);
+    return true;
+}
+
+// Whether entry holds exactly this key (internal function)
+static inline bool hashmap_entry_matches(const hashmap_entry_t *entry, const void *key,
+                                         size_t key_size, size_t hash) {
+    return entry->hash == hash && entry->key_size == key_size && hashmap_key_equal(entry->key, key, key_size);
+}
+
+// Locate the link that points at key's entry, searching the current table
+// and the not-yet-migrated part of the old one; NULL if absent. Adds the
+// number of entries compared to *probes (internal function)
+static inline hashmap_entry_t **hashmap_find_link_probed(const hashmap_t *map, const void *key,
+                                                        size_t key_size, size_t hash, size_t *probes) {
+    hashmap_entry_t **link = &map->buckets[hashmap_bucket_index(hash, map->capacity)];
+    for (; *link; link = &(*link)->next) {
+        ++*probes;
+        if (hashmap_entry_matches(*link, key, key_size, hash)) {
+            return link;
+        }
+    }
+
+    if (map->old_buckets) {
+        size_t old_index = hashmap_bucket_index(hash, map->old_capacity);
+        if (old_index >= map->migrate_index) {
+            for (link = &map->old_buckets[old_index]; *link; link = &(*link)->next) {
+                ++*probes;
+                if (hashmap_entry_matches(*link, key, key_size, hash)) {
+                    return link;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// hashmap_find_link_probed without the count, which the compiler drops (internal function)
+static inline hashmap_entry_t **hashmap_find_link(const hashmap_t *map, const void *key,
+                                                 size_t key_size, size_t hash) {
+    size_t probes = 0;
+    return hashmap_find_link_probed(map, key, key_size, hash, &probes);
+}
+
+// Lookup shared by hashmap_get and hashmap_get_with_hash (internal function)
+static inline void *hashmap_get_hashed(const hashmap_t *map, const void *key, size_t key_size, size_t hash) {
+    size_t probes = 0;
+    hashmap_entry_t **link = hashmap_find_link_probed(map, key, key_size, hash, &probes);
+    HASHMAP_STAT_LOOKUP(map, probes);
+    if (!link) {
+        return NULL;
+    }
+    if (hashmap_entry_expired(map, *link)) {
+        // Left in place for the next write or hashmap_expire_step to reclaim
+        return NULL;
+    }
+    hashmap_cache_touch(map, *link);
+    return (*link)->value;
+}
+
+// Create a new hashmap from an options struct
+static inline hashmap_t *hashmap_create_ex(const hashmap_options_t *options) {
+    hashmap_options_t defaults = {0};
+    if (!options) {
+        options = &defaults;
+    }
+
+    size_t initial_capacity = options->initial_capacity;
+    if (initial_capacity == 0) {
+        initial_capacity = HASHMAP_DEFAULT_CAPACITY;
+    }
+    initial_capacity = hashmap_round_capacity(initial_capacity);
+
+    // A cache is sized for its bound up front and then never grows
+    if (options->cache_capacity) {
+        size_t fit = hashmap_capacity_for_load(options->cache_capacity,
+                                               hashmap_options_load_factor(options, HASHMAP_DEFAULT_MAX_LOAD_FACTOR));
+        if (fit == SIZE_MAX) {
+            return NULL;
+        }
+        if (fit > initial_capacity) {
+            initial_capacity = fit;
+        }
+    }
+
+    hashmap_t *map = (hashmap_t *)hashmap_mem_alloc(&options->allocator, sizeof(hashmap_t));
+    if (!map) {
+        return NULL;
+    }
+    map->allocator = options->allocator;
+    map->table_memory = options->table_memory;
+
+    map->buckets = hashmap_buckets_alloc(map, initial_capacity);
+    if (!map->buckets) {
+        hashmap_mem_free(&options->allocator, map, sizeof(hashmap_t));
+        return NULL;
+    }
+
+    map->capacity = initial_capacity;
+    map->size = 0;
+    map->key_free = options->key_free;  // Not used, but kept for API compatibility
+    map->value_free = options->value_size ? NULL : options->value_free;  // Inline values are owned by the map
+    map->hash_func = options->hash_func;
+    map->value_size = options->value_size;
+    map->value_align = hashmap_value_align(options->value_size);
+    map->max_load_factor = hashmap_options_load_factor(options, HASHMAP_DEFAULT_MAX_LOAD_FACTOR);
+    map->max_entries = hashmap_load_threshold(initial_capacity, map->max_load_factor);
+    map->growth_shift = hashmap_options_growth_shift(options);
+    map->incremental = options->incremental_resize;
+    map->deferred = options->deferred_resize;
+    map->old_buckets = NULL;
+    map->old_capacity = 0;
+    map->migrate_index = 0;
+    map->cache_capacity = options->cache_capacity;
+    map->clock_hand = 0;
+    map->on_evict = options->on_evict;
+    map->evict_ctx = options->evict_ctx;
+    map->expiry = options->expiry;
+    map->clock = options->clock ? options->clock : hashmap_clock_now;
+    map->clock_ctx = options->clock_ctx;
+    map->expire_cursor = 0;
+#ifdef HASHMAP_ENABLE_STATS
+    memset(&map->counters, 0, sizeof(map->counters));
+    HASHMAP_STAT_ALLOC(map, sizeof(hashmap_t));
+    HASHMAP_STAT_ALLOC(map, initial_capacity * sizeof(hashmap_entry_t *));
+#endif
+
+    memset(&map->pool, 0, sizeof(map->pool));
+    if (options->entry_pool) {
+        size_t key_limit = options->pool_key_size ? options->pool_key_size : HASHMAP_POOL_DEFAULT_KEY_SIZE;
+        size_t align = _Alignof(hashmap_entry_t);
+        if (map->value_align > align) {
+            align = map->value_align;
+        }
+        map->pool.key_limit = key_limit;
+        map->pool.slot_align = align;
+        map->pool.slot_size = (hashmap_entry_bytes(map, key_limit) + align - 1) / align * align;
+    }
+
+    return map;
+}
+
+// Create a new hashmap
+static inline hashmap_t *hashmap_create(
+    size_t initial_capacity,
+    key_free_func_t key_free,
+    value_free_func_t value_free
+) {
+    hashmap_options_t options = {0};
+    options.initial_capacity = initial_capacity;
+    options.key_free = key_free;
+    options.value_free = value_free;
+    return hashmap_create_ex(&options);
+}
+
+// Clear all entries from the hashmap
+static inline void hashmap_clear(hashmap_t *map) {
+    if (!map) {
+        return;
+    }
+
+    // Fold any pending migration in so only one table needs walking
+    hashmap_migrate_step(map, SIZE_MAX);
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        hashmap_entry_t *entry = map->buckets[i];
+        while (entry) {
+            hashmap_entry_t *next = entry->next;
+            
+            // Free value if needed
+            if (map->value_free) {
+                map->value_free(entry->value);
+            }
+            
+            // Pooled entries are released in bulk below
+            if (!hashmap_entry_pooled(map, entry->key_size)) {
+                hashmap_entry_release(map, entry);
+            }
+            entry = next;
+        }
+        map->buckets[i] = NULL;
+    }
+    
+    hashmap_pool_release(map);
+    map->size = 0;
+}
+
+// Destroy the hashmap and free all resources
+static inline void hashmap_destroy(hashmap_t *map) {
+    if (!map) {
+        return;
+    }
+
+    hashmap_clear(map);
+    hashmap_buckets_free(map, map->buckets, map->capacity);
+    hashmap_allocator_t allocator = map->allocator;
+    hashmap_mem_free(&allocator, map, sizeof(hashmap_t));
+}
+
+// Evict one entry in cache mode. The CLOCK hand sweeps the buckets: an entry
+// whose reference byte is set has it cleared and gets a second chance, and
+// the first one found clear is removed. During a resize the sweep runs over
+// the current table and then the old table's unmigrated buckets, so eviction
+// never has to finish the migration inline (internal function)
+static HASHMAP_NOINLINE void hashmap_cache_evict(hashmap_t *map) {
+    if (map->size == 0) {
+        return;
+    }
+
+    size_t span = map->capacity + (map->old_buckets ? map->old_capacity - map->migrate_index : 0);
+    for (size_t hand = map->clock_hand < span ? map->clock_hand : 0;; hand = hand + 1 < span ? hand + 1 : 0) {
+        hashmap_entry_t **bucket = hand < map->capacity ? &map->buckets[hand]
+                                                        : &map->old_buckets[map->migrate_index + (hand - map->capacity)];
+        for (hashmap_entry_t **link = bucket; *link; link = &(*link)->next) {
+            unsigned char *ref = hashmap_entry_ref(*link);
+            if (*ref) {
+                *ref = 0;
+                continue;
+            }
+
+            map->clock_hand = hand + 1;
+            hashmap_entry_discard(map, link);
+            return;
+        }
+    }
+}
+
+// Make room for one more entry: evict in a full cache, grow once the load
+// factor threshold is reached; false if the table cannot grow (internal function)
+static inline bool hashmap_insert_room(hashmap_t *map) {
+    // A full cache makes room instead of growing
+    if (map->cache_capacity && map->size >= map->cache_capacity) {
+        hashmap_cache_evict(map);
+    }
+
+    // Resize once the load factor threshold is reached
+    if (map->size >= map->max_entries) {
+        // A deferred map never finishes a migration inline: it runs above its
+        // load factor while hashmap_migrate_assist drains the old table
+        if (map->deferred && map->old_buckets) {
+            return true;
+        }
+        if (map->capacity > (SIZE_MAX >> map->growth_shift)) {
+            return false;
+        }
+        size_t new_capacity = map->capacity << map->growth_shift;
+        bool staged = map->incremental || map->deferred;
+        return staged ? hashmap_resize_begin(map, new_capacity) : hashmap_resize(map, new_capacity);
+    }
+    return true;
+}
+
+// Link in a new entry for a key known to be absent, growing the table first
+// when the load threshold is reached; NULL on failure. Kept out of line so
+// the lookup path of put/get_or_insert stays small enough to inline (internal function)
+static HASHMAP_NOINLINE hashmap_entry_t *hashmap_insert_hashed(hashmap_t *map, const void *key, size_t key_size,
+                                                     size_t hash, void *value) {
+    if (!hashmap_insert_room(map)) {
+        return NULL;
+    }
+
+    // Create new entry with the key copied into the same allocation
+    hashmap_entry_t *entry = hashmap_entry_alloc(map, key_size);
+    if (!entry) {
+        return NULL;
+    }
+
+    size_t index = hashmap_bucket_index(hash, map->capacity);
+    memcpy(entry->key, key, key_size);
+    entry->key_size = key_size;
+    entry->hash = hash;
+    if (map->cache_capacity) {
+        *hashmap_entry_ref(entry) = 0;  // New keys start unreferenced, so one-off keys go first
+    }
+    if (map->expiry) {
+        hashmap_entry_set_deadline(map, entry, HASHMAP_TTL_NEVER);
+    }
+    hashmap_entry_init_value(map, entry, value);
+    entry->next = map->buckets[index];
+    map->buckets[index] = entry;
+    map->size++;
+    return entry;
+}
+
+// Insert or update a key whose table hash is already known and return its
+// entry, NULL on failure. A stored entry has no deadline (internal function)
+static inline hashmap_entry_t *hashmap_store_hashed(hashmap_t *map, const void *key, size_t key_size,
+                                                    size_t hash, void *value) {
+    hashmap_migrate_assist(map);
+
+    // Update the value if the key already exists (an expired entry is reused)
+    hashmap_entry_t **link = hashmap_find_link(map, key, key_size, hash);
+    if (link) {
+        hashmap_cache_touch(map, *link);
+        hashmap_entry_update_value(map, *link, value);
+        if (map->expiry) {
+            hashmap_entry_set_deadline(map, *link, HASHMAP_TTL_NEVER);
+        }
+        return *link;
+    }
+
+    return hashmap_insert_hashed(map, key, key_size, hash, value);
+}
+
+// Insert or update a key whose table hash is already known (internal function)
+static inline bool hashmap_put_hashed(hashmap_t *map, const void *key, size_t key_size,
+                                      size_t hash, void *value) {
+    return hashmap_store_hashed(map, key, key_size, hash, value) != NULL;
+}
+
+// Insert or update a key-value pair. In value_size mode value points to the
+// bytes to copy in (NULL stores zeros).
+static inline bool hashmap_put(hashmap_t *map, const void *key, size_t key_size, void *value) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    return hashmap_put_hashed(map, key, key_size, hash, value);
+}
+
+// Get the value associated with a key. In value_size mode this points at the
+// copy inside the entry, valid until the key is removed or the map cleared.
+// An expired key reads as absent but is not freed here. The only write a
+// lookup makes is setting a cache-mode entry's one-byte reference mark.
+static inline void *hashmap_get(const hashmap_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    return hashmap_get_hashed(map, key, key_size, hash);
+}
+
+// Unlink *link and drop its live entry: value_free, then the entry (internal function)
+static inline void hashmap_entry_remove(hashmap_t *map, hashmap_entry_t **link) {
+    // Remove entry from chain
+    hashmap_entry_t *entry = *link;
+    *link = entry->next;
+
+    // Free value if needed (the key lives inside the entry)
+    if (map->value_free) {
+        map->value_free(entry->value);
+    }
+
+    hashmap_entry_release(map, entry);
+    map->size--;
+}
+
+// Remove a key whose table hash is already known (internal function)
+static inline bool hashmap_remove_hashed(hashmap_t *map, const void *key, size_t key_size, size_t hash) {
+    hashmap_migrate_assist(map);
+
+    hashmap_entry_t **link = hashmap_find_link(map, key, key_size, hash);
+    if (!link) {
+        return false;
+    }
+    if (hashmap_entry_expired(map, *link)) {
+        hashmap_entry_discard(map, link);
+        return false;
+    }
+
+    hashmap_entry_remove(map, link);
+    return true;
+}
+
+// Remove a key-value pair
+static inline bool hashmap_remove(hashmap_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    return hashmap_remove_hashed(map, key, key_size, hash);
+}
+
+// Check if a key exists in the hashmap
+static inline bool hashmap_contains(const hashmap_t *map, const void *key, size_t key_size) {
+    return hashmap_get(map, key, key_size) != NULL;
+}
+
+// Get the number of key-value pairs in the hashmap
+static inline size_t hashmap_size(const hashmap_t *map) {
+    return map ? map->size : 0;
+}
+
+// Check if the hashmap is empty
+static inline bool hashmap_is_empty(const hashmap_t *map) {
+    return map ? map->size == 0 : true;
+}
+
+// Table hash of a key for the *_with_hash functions. Every access to a key
+// must use the same hash, so compute it with this function or always supply
+// your own well-mixed hash through the *_with_hash variants.
+static inline size_t hashmap_hash(const hashmap_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return 0;
+    }
+    return hashmap_hash_key(map->hash_func, key, key_size);
+}
+
+// hashmap_put with a precomputed hash
+static inline bool hashmap_put_with_hash(hashmap_t *map, const void *key, size_t key_size,
+                                         size_t hash, void *value) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+    return hashmap_put_hashed(map, key, key_size, hash, value);
+}
+
+// hashmap_get with a precomputed hash
+static inline void *hashmap_get_with_hash(const hashmap_t *map, const void *key, size_t key_size, size_t hash) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+    return hashmap_get_hashed(map, key, key_size, hash);
+}
+
+// hashmap_remove with a precomputed hash
+static inline bool hashmap_remove_with_hash(hashmap_t *map, const void *key, size_t key_size, size_t hash) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+    return hashmap_remove_hashed(map, key, key_size, hash);
+}
+
+// Return the value slot for key, inserting the key first when missing, with
+// one hash and one chain walk. The slot is the stored void * (cast the result
+// to void **) or, in value_size mode, the inline value. New slots hold NULL
+// or zeros. *inserted (may be NULL) reports whether the key was added. The
+// slot stays valid until the key is removed; NULL on failure.
+static inline void *hashmap_get_or_insert(hashmap_t *map, const void *key, size_t key_size, bool *inserted) {
+    if (inserted) {
+        *inserted = false;
+    }
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_migrate_assist(map);
+
+    hashmap_entry_t *entry;
+    hashmap_entry_t **link = hashmap_find_link(map, key, key_size, hash);
+    if (link && hashmap_entry_expired(map, *link)) {
+        // Reclaim the stale entry rather than hand back its value
+        hashmap_entry_discard(map, link);
+        link = NULL;
+    }
+    if (link) {
+        entry = *link;
+        hashmap_cache_touch(map, entry);
+    } else {
+        entry = hashmap_insert_hashed(map, key, key_size, hash, NULL);
+        if (!entry) {
+            return NULL;
+        }
+        if (inserted) {
+            *inserted = true;
+        }
+    }
+    return map->value_size ? entry->value : (void *)&entry->value;
+}
+
+// Insert or update a key that expires ttl_ms milliseconds from now; needs
+// options.expiry. Once expired the key reads as absent and is reclaimed by
+// the next write or hashmap_expire_step that reaches it. A later
+// hashmap_put of the key clears its TTL.
+static inline bool hashmap_put_ttl(hashmap_t *map, const void *key, size_t key_size, void *value, uint64_t ttl_ms) {
+    if (!map || !map->expiry || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_entry_t *entry = hashmap_store_hashed(map, key, key_size, hash, value);
+    if (!entry) {
+        return false;
+    }
+    hashmap_entry_set_deadline(map, entry, hashmap_ttl_deadline(map, ttl_ms));
+    return true;
+}
+
+// Restart a live key's TTL at ttl_ms (HASHMAP_TTL_NEVER keeps it for good).
+// Returns false if the key is absent or already expired.
+static inline bool hashmap_set_ttl(hashmap_t *map, const void *key, size_t key_size, uint64_t ttl_ms) {
+    if (!map || !map->expiry || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_entry_t **link = hashmap_find_link(map, key, key_size, hash);
+    if (!link) {
+        return false;
+    }
+    if (hashmap_entry_expired(map, *link)) {
+        hashmap_entry_discard(map, link);
+        return false;
+    }
+    hashmap_entry_set_deadline(map, *link, hashmap_ttl_deadline(map, ttl_ms));
+    return true;
+}
+
+// Reclaim expired entries in the next n_buckets buckets, continuing where the
+// previous call stopped, so expiry can be paced (e.g. a few hundred buckets
+// per tick) instead of scanning the whole table at once. SIZE_MAX makes one
+// full pass. Returns the number of entries reclaimed.
+static inline size_t hashmap_expire_step(hashmap_t *map, size_t n_buckets) {
+    if (!map || !map->expiry) {
+        return 0;
+    }
+
+    // The sweep walks the current table; old buckets are reached as they migrate
+    if (n_buckets >= map->capacity) {
+        hashmap_migrate_step(map, SIZE_MAX);
+    } else {
+        hashmap_migrate_assist(map);
+    }
+
+    uint64_t now = map->clock(map->clock_ctx);
+    size_t mask = map->capacity - 1;
+    size_t count = n_buckets < map->capacity ? n_buckets : map->capacity;
+    size_t index = map->expire_cursor & mask;
+    size_t reclaimed = 0;
+    for (size_t i = 0; i < count; i++, index = (index + 1) & mask) {
+        hashmap_entry_t **link = &map->buckets[index];
+        while (*link) {
+            uint64_t deadline = hashmap_entry_deadline(map, *link);
+            if (deadline != HASHMAP_TTL_NEVER && deadline <= now) {
+                hashmap_entry_discard(map, link);
+                reclaimed++;
+            } else {
+                link = &(*link)->next;
+            }
+        }
+    }
+    map->expire_cursor = index;
+    return reclaimed;
+}
+
+// Look up n keys at once. All keys in a window are hashed first and their
+// buckets, then chain heads, are prefetched before any chain is walked, so
+// the cache misses of different keys overlap. values_out[i] receives the
+// value or NULL. Returns the number of keys found.
+static inline size_t hashmap_get_batch(const hashmap_t *map, const void *const *keys,
+                                       const size_t *key_sizes, size_t n, void **values_out) {
+    if (!map || !keys || !key_sizes || !values_out) {
+        return 0;
+    }
+
+    size_t hashes[HASHMAP_BATCH_WINDOW];
+    size_t found = 0;
+
+    for (size_t base = 0; base < n; base += HASHMAP_BATCH_WINDOW) {
+        size_t count = n - base < HASHMAP_BATCH_WINDOW ? n - base : HASHMAP_BATCH_WINDOW;
+
+        for (size_t i = 0; i < count; i++) {
+            const void *key = keys[base + i];
+            if (key && key_sizes[base + i]) {
+                hashes[i] = hashmap_hash_key(map->hash_func, key, key_sizes[base + i]);
+                HASHMAP_PREFETCH(&map->buckets[hashmap_bucket_index(hashes[i], map->capacity)]);
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (keys[base + i] && key_sizes[base + i]) {
+                HASHMAP_PREFETCH(map->buckets[hashmap_bucket_index(hashes[i], map->capacity)]);
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            const void *key = keys[base + i];
+            values_out[base + i] = NULL;
+            if (!key || key_sizes[base + i] == 0) {
+                continue;
+            }
+            hashmap_entry_t **link = hashmap_find_link(map, key, key_sizes[base + i], hashes[i]);
+            if (link && !hashmap_entry_expired(map, *link)) {
+                hashmap_cache_touch(map, *link);
+                values_out[base + i] = (*link)->value;
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+// Insert or update n key-value pairs, hashing and prefetching a window of
+// keys ahead of the inserts. Later duplicates overwrite earlier ones, as with
+// repeated hashmap_put. Returns false if any pair could not be stored.
+static inline bool hashmap_put_batch(hashmap_t *map, const void *const *keys, const size_t *key_sizes,
+                                     void *const *values, size_t n) {
+    if (!map || !keys || !key_sizes || !values) {
+        return false;
+    }
+
+    size_t hashes[HASHMAP_BATCH_WINDOW];
+    bool ok = true;
+
+    for (size_t base = 0; base < n; base += HASHMAP_BATCH_WINDOW) {
+        size_t count = n - base < HASHMAP_BATCH_WINDOW ? n - base : HASHMAP_BATCH_WINDOW;
+
+        for (size_t i = 0; i < count; i++) {
+            const void *key = keys[base + i];
+            if (key && key_sizes[base + i]) {
+                hashes[i] = hashmap_hash_key(map->hash_func, key, key_sizes[base + i]);
+                HASHMAP_PREFETCH(&map->buckets[hashmap_bucket_index(hashes[i], map->capacity)]);
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            const void *key = keys[base + i];
+            if (!key || key_sizes[base + i] == 0 ||
+                !hashmap_put_hashed(map, key, key_sizes[base + i], hashes[i], values[base + i])) {
+                ok = false;
+            }
+        }
+    }
+
+    return ok;
+}
+
+// Grow the bucket array once so n_entries fit at the map's load factor
+static inline bool hashmap_reserve(hashmap_t *map, size_t n_entries) {
+    if (!map) {
+        return false;
+    }
+
+    // A cache never holds more than its bound
+    if (map->cache_capacity && n_entries > map->cache_capacity) {
+        n_entries = map->cache_capacity;
+    }
+    size_t required = hashmap_capacity_for_load(n_entries, map->max_load_factor);
+    if (required == SIZE_MAX) {
+        return false;
+    }
+    if (required <= map->capacity) {
+        return true;
+    }
+    return hashmap_resize(map, required);
+}
+
+// Shrink the bucket array to the smallest size that fits the current entries
+static inline bool hashmap_shrink_to_fit(hashmap_t *map) {
+    if (!map) {
+        return false;
+    }
+
+    size_t target = hashmap_capacity_for_load(map->size, map->max_load_factor);
+    if (target < HASHMAP_DEFAULT_CAPACITY) {
+        target = HASHMAP_DEFAULT_CAPACITY;
+    }
+    if (target >= map->capacity) {
+        return true;
+    }
+    return hashmap_resize(map, target);
+}
+
+// Migrate up to n_buckets buckets of a pending resize and return how many old
+// buckets are left (0 once the table is whole). With options.deferred_resize
+// this is what drains a growth resize, e.g. a few thousand buckets per tick
+// of an event loop; it also hurries an incremental one along.
+static inline size_t hashmap_resize_step(hashmap_t *map, size_t n_buckets) {
+    if (!map) {
+        return 0;
+    }
+    hashmap_migrate_step(map, n_buckets);
+    return map->old_buckets ? map->old_capacity - map->migrate_index : 0;
+}
+
+// Whether a resize still has old buckets to migrate
+static inline bool hashmap_resize_pending(const hashmap_t *map) {
+    return map && map->old_buckets;
+}
+
+// Iterator over a map's entries; initialize with hashmap_iter_init. The map
+// must not be modified while an iterator is in use.
+typedef struct hashmap_iter {
+    const hashmap_t *map;           // NULL once exhausted
+    hashmap_entry_t *entry;         // Next entry in the current chain
+    size_t bucket;                  // Next bucket to scan
+    bool old_table;                 // Scanning the unmigrated part of the old table
+} hashmap_iter_t;
+
+// Start iterating over map
+static inline void hashmap_iter_init(hashmap_iter_t *iter, const hashmap_t *map) {
+    iter->map = map;
+    iter->entry = NULL;
+    iter->bucket = 0;
+    iter->old_table = false;
+}
+
+// Advance to the next entry; false when there are no more. Any output pointer may be NULL.
+static inline bool hashmap_iter_next(hashmap_iter_t *iter, const void **key, size_t *key_size, void **value) {
+    if (!iter || !iter->map) {
+        return false;
+    }
+
+    const hashmap_t *map = iter->map;
+    while (!iter->entry) {
+        hashmap_entry_t **buckets = iter->old_table ? map->old_buckets : map->buckets;
+        size_t capacity = iter->old_table ? map->old_capacity : map->capacity;
+        if (iter->bucket < capacity) {
+            iter->entry = buckets[iter->bucket++];
+            continue;
+        }
+        // During an incremental resize, old buckets below migrate_index are already empty
+        if (iter->old_table || !map->old_buckets) {
+            iter->map = NULL;
+            return false;
+        }
+        iter->old_table = true;
+        iter->bucket = map->migrate_index;
+    }
+
+    hashmap_entry_t *entry = iter->entry;
+    iter->entry = entry->next;
+    if (key) {
+        *key = entry->key;
+    }
+    if (key_size) {
+        *key_size = entry->key_size;
+    }
+    if (value) {
+        *value = entry->value;
+    }
+    return true;
+}
+
+// Walk one bucket array from bucket first (internal function)
+static inline bool hashmap_foreach_table(hashmap_entry_t **buckets, size_t first, size_t capacity,
+                                         hashmap_visit_func_t visit, void *ctx, size_t *visited) {
+    for (size_t i = first; i < capacity; i++) {
+        for (hashmap_entry_t *entry = buckets[i]; entry; entry = entry->next) {
+            HASHMAP_PREFETCH(entry->next);
+            ++*visited;
+            if (!visit(entry->key, entry->key_size, entry->value, ctx)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Call visit for every entry until it returns false; returns the number of
+// entries visited. visit must not modify the map.
+static inline size_t hashmap_foreach(const hashmap_t *map, hashmap_visit_func_t visit, void *ctx) {
+    if (!map || !visit) {
+        return 0;
+    }
+
+    size_t visited = 0;
+    if (hashmap_foreach_table(map->buckets, 0, map->capacity, visit, ctx, &visited) && map->old_buckets) {
+        hashmap_foreach_table(map->old_buckets, map->migrate_index, map->old_capacity, visit, ctx, &visited);
+    }
+    return visited;
+}
+
+// Whether entry can be relinked from src into dst as it is: both maps lay
+// entries out alike, share an allocator and pool neither entries of this
+// key size (internal function)
+static inline bool hashmap_entry_movable(const hashmap_t *dst, const hashmap_t *src, const hashmap_entry_t *entry) {
+    return !hashmap_entry_pooled(dst, entry->key_size) && !hashmap_entry_pooled(src, entry->key_size) &&
+           hashmap_entry_tail(dst) == hashmap_entry_tail(src) && dst->value_align == src->value_align &&
+           dst->allocator.alloc == src->allocator.alloc && dst->allocator.dealloc == src->allocator.dealloc &&
+           dst->allocator.ctx == src->allocator.ctx;
+}
+
+// Hand src's entry for a key dst lacks over to dst at hash, relinking it when
+// movable and copying it otherwise. The caller unlinks it from src; false if
+// dst is out of memory, leaving the entry untouched (internal function)
+static inline bool hashmap_merge_insert(hashmap_t *dst, hashmap_t *src, hashmap_entry_t *entry, size_t hash) {
+    if (!hashmap_entry_movable(dst, src, entry)) {
+        hashmap_entry_t *copy = hashmap_insert_hashed(dst, entry->key, entry->key_size, hash, entry->value);
+        if (!copy) {
+            return false;
+        }
+        if (dst->expiry && src->expiry) {
+            hashmap_entry_set_deadline(dst, copy, hashmap_entry_deadline(src, entry));
+        }
+        hashmap_entry_release(src, entry);
+        return true;
+    }
+
+    if (!hashmap_insert_room(dst)) {
+        return false;
+    }
+    HASHMAP_STAT_FREE(src, hashmap_entry_bytes(src, entry->key_size));
+    HASHMAP_STAT_ADOPT(dst, hashmap_entry_bytes(dst, entry->key_size));
+
+    // Key, reference byte, deadline and inline value come along unchanged
+    size_t index = hashmap_bucket_index(hash, dst->capacity);
+    entry->hash = hash;
+    entry->next = dst->buckets[index];
+    dst->buckets[index] = entry;
+    dst->size++;
+    return true;
+}
+
+// Settle a key held by both maps in dst's entry kept, then release src's
+// entry (internal function)
+static inline void hashmap_merge_combine(hashmap_t *dst, hashmap_t *src, hashmap_entry_t *kept,
+                                         hashmap_entry_t *entry, hashmap_combine_func_t combine, void *ctx) {
+    void *value = combine ? combine(kept->key, kept->key_size, kept->value, entry->value, ctx) : entry->value;
+    hashmap_cache_touch(dst, kept);
+    if (dst->value_size) {
+        if (value != kept->value) {
+            hashmap_value_copy(dst, kept->value, value);
+        }
+    } else {
+        if (dst->value_free && kept->value != value) {
+            dst->value_free(kept->value);
+        }
+        if (src->value_free && entry->value != value) {
+            src->value_free(entry->value);
+        }
+        kept->value = value;
+    }
+    hashmap_entry_release(src, entry);
+}
+
+// Move every entry of src into dst, leaving src empty. dst grows once up
+// front, cached hashes are reused when both maps hash alike, and entries are
+// relinked without copying their keys when hashmap_entry_movable allows. For
+// a key in both maps the value combine returns is kept (NULL combine keeps
+// src's); in pointer mode the value not kept goes to its map's value_free, in
+// value_size mode the kept bytes are copied into dst's entry. The maps must
+// be distinct and share value_size. Returns false on invalid arguments or out
+// of memory, in which case the entries not yet merged remain in src.
+static inline bool hashmap_merge(hashmap_t *dst, hashmap_t *src, hashmap_combine_func_t combine, void *ctx) {
+    if (!dst || !src || dst == src || dst->value_size != src->value_size) {
+        return false;
+    }
+    if (!hashmap_reserve(dst, dst->size + src->size)) {
+        return false;
+    }
+    hashmap_migrate_step(src, SIZE_MAX);
+
+    bool same_hash = dst->hash_func == src->hash_func;
+    for (size_t i = 0; i < src->capacity; i++) {
+        hashmap_entry_t **link = &src->buckets[i];
+        while (*link) {
+            hashmap_entry_t *entry = *link;
+            hashmap_entry_t *next = entry->next;
+            if (hashmap_entry_expired(src, entry)) {
+                hashmap_entry_discard(src, link);
+                continue;
+            }
+
+            size_t hash = same_hash ? entry->hash : hashmap_hash_key(dst->hash_func, entry->key, entry->key_size);
+            hashmap_entry_t **match = hashmap_find_link(dst, entry->key, entry->key_size, hash);
+            if (match && hashmap_entry_expired(dst, *match)) {
+                hashmap_entry_discard(dst, match);
+                match = NULL;
+            }
+            if (match) {
+                hashmap_merge_combine(dst, src, *match, entry, combine, ctx);
+            } else if (!hashmap_merge_insert(dst, src, entry, hash)) {
+                return false;
+            }
+            *link = next;
+            src->size--;
+        }
+    }
+    return true;
+}
+
+// Whether other holds a live entry for the key of map's entry (internal function)
+static inline bool hashmap_holds(const hashmap_t *other, const hashmap_t *map, const hashmap_entry_t *entry) {
+    size_t hash = other->hash_func == map->hash_func
+                      ? entry->hash
+                      : hashmap_hash_key(other->hash_func, entry->key, entry->key_size);
+    hashmap_entry_t **link = hashmap_find_link(other, entry->key, entry->key_size, hash);
+    return link && !hashmap_entry_expired(other, *link);
+}
+
+// Remove map's live entries whose key other holds (present) or lacks
+// (!present); returns how many were removed (internal function)
+static inline size_t hashmap_remove_where(hashmap_t *map, const hashmap_t *other, bool present) {
+    hashmap_migrate_step(map, SIZE_MAX);
+
+    size_t removed = 0;
+    for (size_t i = 0; i < map->capacity; i++) {
+        hashmap_entry_t **link = &map->buckets[i];
+        while (*link) {
+            if (hashmap_entry_expired(map, *link)) {
+                hashmap_entry_discard(map, link);
+            } else if (hashmap_holds(other, map, *link) == present) {
+                hashmap_entry_remove(map, link);
+                removed++;
+            } else {
+                link = &(*link)->next;
+            }
+        }
+    }
+    return removed;
+}
+
+// Keep only the keys of dst that other also holds, probing other with dst's
+// cached hashes when both maps hash alike. Removed entries go through
+// value_free as with hashmap_remove. Returns the number removed.
+static inline size_t hashmap_intersect(hashmap_t *dst, const hashmap_t *other) {
+    if (!dst || !other) {
+        return 0;
+    }
+    return hashmap_remove_where(dst, other, false);
+}
+
+// Remove from dst every key other holds. The smaller map is walked and the
+// other probed, with cached hashes when both maps hash alike. Removed entries
+// go through value_free as with hashmap_remove. Returns the number removed.
+static inline size_t hashmap_difference(hashmap_t *dst, const hashmap_t *other) {
+    if (!dst || !other) {
+        return 0;
+    }
+    if (dst->size <= other->size) {
+        return hashmap_remove_where(dst, other, true);
+    }
+
+    bool same_hash = dst->hash_func == other->hash_func;
+    size_t removed = 0;
+    for (int old_table = 0; old_table < 2; old_table++) {
+        hashmap_entry_t **buckets = old_table ? other->old_buckets : other->buckets;
+        size_t first = old_table ? other->migrate_index : 0;
+        size_t capacity = old_table ? other->old_capacity : other->capacity;
+        for (size_t i = first; buckets && i < capacity; i++) {
+            for (hashmap_entry_t *entry = buckets[i]; entry; entry = entry->next) {
+                if (hashmap_entry_expired(other, entry)) {
+                    continue;
+                }
+                size_t hash = same_hash ? entry->hash
+                                        : hashmap_hash_key(dst->hash_func, entry->key, entry->key_size);
+                removed += hashmap_remove_hashed(dst, entry->key, entry->key_size, hash);
+            }
+        }
+    }
+    return removed;
 }
 
 #endif // HASHMAP_H
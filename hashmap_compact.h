@@ -0,0 +1,511 @@
+#ifndef HASHMAP_COMPACT_H
+#define HASHMAP_COMPACT_H
+
+#include "hashmap.h"
+
+// Compact engine for very large maps
+//
+// A chained hashmap_t spends a 32-byte entry header, an allocator header and
+// an 8-byte bucket pointer on every key. This engine keeps the same chaining
+// but in a handful of large arrays instead of one allocation per entry:
+//
+//   buckets   uint32_t head index per bucket (HASHMAP_COMPACT_NIL when empty)
+//   entries   dense array of 16-byte records {next index, 32 hash bits,
+//             40-bit key offset | 24-bit key size}, indices [0, size)
+//   values    parallel array, value_size bytes per entry (or one void *)
+//   keys      append-only byte slab the key offsets point into
+//
+// Removal moves the last entry into the hole, so entries stay dense and a
+// walk over them is a sequential scan. Removed key bytes stay in the slab as
+// garbage until it exceeds half the slab, at which point the live keys are
+// copied into a fresh one. hashmap_compact_memory reports the footprint and
+// bytes per entry.
+//
+// Limits follow from the field widths: fewer than 2^32 entries, keys under
+// 16 MiB and a key slab under 1 TiB. Value pointers into the values array
+// (value_size mode) are valid only until the next put or remove.
+
+#define HASHMAP_COMPACT_NIL UINT32_MAX                     // End of a chain / empty bucket
+#define HASHMAP_COMPACT_MAX_ENTRIES (UINT32_MAX - 1)       // Indices must stay below NIL
+#define HASHMAP_COMPACT_SIZE_BITS 24                       // Low bits of the key reference
+#define HASHMAP_COMPACT_MAX_KEY_SIZE (((size_t)1 << HASHMAP_COMPACT_SIZE_BITS) - 1)
+#define HASHMAP_COMPACT_MAX_KEY_BYTES ((uint64_t)1 << (64 - HASHMAP_COMPACT_SIZE_BITS))
+#define HASHMAP_COMPACT_MIN_GARBAGE 65536                  // Slab bytes left as garbage before compaction is considered
+#if SIZE_MAX > 0xFFFFFFFFu
+#define HASHMAP_COMPACT_MAX_BUCKETS ((size_t)1 << 32)      // 32 cached hash bits address this many buckets
+#else
+#define HASHMAP_COMPACT_MAX_BUCKETS ((size_t)1 << 31)
+#endif
+
+// Entry record (internal structure)
+typedef struct hashmap_compact_entry {
+    uint32_t next;                  // Next entry index in the chain
+    uint32_t hash;                  // Low 32 bits of the table hash
+    uint64_t key;                   // Slab offset << HASHMAP_COMPACT_SIZE_BITS | key size
+} hashmap_compact_entry_t;
+
+// Compact hashmap structure
+typedef struct hashmap_compact {
+    uint32_t *buckets;
+    hashmap_compact_entry_t *entries;
+    unsigned char *values;          // value_stride bytes per entry
+    unsigned char *keys;            // Key slab
+    size_t capacity;                // Buckets, a power of two
+    size_t size;
+    size_t entry_capacity;          // Slots allocated in entries and values
+    size_t max_entries;             // Growth threshold for the current capacity
+    uint64_t key_used;              // Slab bytes written, garbage included
+    uint64_t key_capacity;          // Slab bytes allocated
+    uint64_t key_garbage;           // Slab bytes of removed keys
+    size_t value_size;              // Inline value bytes, 0 for pointer values
+    size_t value_stride;            // Bytes per entry in values
+    value_free_func_t value_free;   // Pointer mode only
+    hash_func_t hash_func;          // NULL for the built-in hash
+    double max_load_factor;
+    unsigned growth_shift;          // log2 of the growth factor
+} hashmap_compact_t;
+
+// Memory footprint, filled in by hashmap_compact_memory
+typedef struct hashmap_compact_usage {
+    size_t size;                    // Live entries
+    size_t bucket_bytes;
+    size_t entry_bytes;             // Allocated entry records
+    size_t value_bytes;             // Allocated value slots
+    uint64_t key_bytes;             // Allocated key slab
+    uint64_t key_garbage;           // Slab bytes held by removed keys
+    uint64_t total_bytes;           // All of the above plus the map structure
+    double bytes_per_entry;         // total_bytes / size (0 when empty)
+} hashmap_compact_usage_t;
+
+// Fields of an entry's key reference (internal functions)
+static inline uint64_t hashmap_compact_key_offset(const hashmap_compact_entry_t *entry) {
+    return entry->key >> HASHMAP_COMPACT_SIZE_BITS;
+}
+
+static inline size_t hashmap_compact_key_size(const hashmap_compact_entry_t *entry) {
+    return (size_t)(entry->key & HASHMAP_COMPACT_MAX_KEY_SIZE);
+}
+
+static inline const unsigned char *hashmap_compact_key(const hashmap_compact_t *map,
+                                                      const hashmap_compact_entry_t *entry) {
+    return map->keys + hashmap_compact_key_offset(entry);
+}
+
+// Slot of entry index in the values array (internal function)
+static inline void *hashmap_compact_value_slot(const hashmap_compact_t *map, size_t index) {
+    return map->values + index * map->value_stride;
+}
+
+// What get returns for entry index: the stored pointer or the inline value (internal function)
+static inline void *hashmap_compact_value(const hashmap_compact_t *map, size_t index) {
+    void *slot = hashmap_compact_value_slot(map, index);
+    if (map->value_size) {
+        return slot;
+    }
+    void *value;
+    memcpy(&value, slot, sizeof(value));
+    return value;
+}
+
+// Store value into entry index's slot; NULL zero-fills in value_size mode (internal function)
+static inline void hashmap_compact_store_value(hashmap_compact_t *map, size_t index, void *value) {
+    void *slot = hashmap_compact_value_slot(map, index);
+    if (!map->value_size) {
+        memcpy(slot, &value, sizeof(value));
+    } else if (value) {
+        memcpy(slot, value, map->value_size);
+    } else {
+        memset(slot, 0, map->value_size);
+    }
+}
+
+// Link that holds key's entry index, or NULL if absent. The pointer is valid
+// until the next insert (internal function)
+static inline uint32_t *hashmap_compact_find_link(const hashmap_compact_t *map, const void *key,
+                                                  size_t key_size, size_t hash) {
+    uint32_t hash32 = (uint32_t)hash;
+    uint32_t *link = &map->buckets[hashmap_bucket_index(hash, map->capacity)];
+    while (*link != HASHMAP_COMPACT_NIL) {
+        const hashmap_compact_entry_t *entry = &map->entries[*link];
+        if (entry->hash == hash32 && hashmap_compact_key_size(entry) == key_size &&
+            hashmap_key_equal(hashmap_compact_key(map, entry), key, key_size)) {
+            return link;
+        }
+        link = (uint32_t *)&entry->next;
+    }
+    return NULL;
+}
+
+// Replace the bucket array and relink every entry from its cached hash bits (internal function)
+static inline bool hashmap_compact_rehash(hashmap_compact_t *map, size_t new_capacity) {
+    if (new_capacity > HASHMAP_COMPACT_MAX_BUCKETS || new_capacity > SIZE_MAX / sizeof(uint32_t)) {
+        return false;
+    }
+    uint32_t *buckets = (uint32_t *)malloc(new_capacity * sizeof(uint32_t));
+    if (!buckets) {
+        return false;
+    }
+    memset(buckets, 0xFF, new_capacity * sizeof(uint32_t));  // Every bucket HASHMAP_COMPACT_NIL
+
+    // Walk entries in index order: sequential reads, scattered head writes
+    for (size_t i = 0; i < map->size; i++) {
+        size_t index = hashmap_bucket_index(map->entries[i].hash, new_capacity);
+        map->entries[i].next = buckets[index];
+        buckets[index] = (uint32_t)i;
+    }
+
+    free(map->buckets);
+    map->buckets = buckets;
+    map->capacity = new_capacity;
+    // Buckets cannot address more than 32 hash bits; past that, chains lengthen instead
+    map->max_entries = new_capacity >= HASHMAP_COMPACT_MAX_BUCKETS
+                           ? HASHMAP_COMPACT_MAX_ENTRIES
+                           : hashmap_load_threshold(new_capacity, map->max_load_factor);
+    return true;
+}
+
+// Resize the entry and value arrays to n slots (n >= size) (internal function)
+static inline bool hashmap_compact_resize_entries(hashmap_compact_t *map, size_t n) {
+    if (n > SIZE_MAX / sizeof(hashmap_compact_entry_t) || n > SIZE_MAX / map->value_stride) {
+        return false;
+    }
+    size_t alloc = n ? n : 1;
+    hashmap_compact_entry_t *entries =
+        (hashmap_compact_entry_t *)realloc(map->entries, alloc * sizeof(hashmap_compact_entry_t));
+    if (!entries) {
+        return false;
+    }
+    map->entries = entries;
+    // Until the values follow, only the smaller of the two sizes is usable
+    if (n < map->entry_capacity) {
+        map->entry_capacity = n;
+    }
+    unsigned char *values = (unsigned char *)realloc(map->values, alloc * map->value_stride);
+    if (!values) {
+        return false;
+    }
+    map->values = values;
+    map->entry_capacity = n;
+    return true;
+}
+
+// Make room for key_size more slab bytes (internal function)
+static inline bool hashmap_compact_reserve_keys(hashmap_compact_t *map, size_t key_size) {
+    if (key_size > HASHMAP_COMPACT_MAX_KEY_BYTES - map->key_used) {
+        return false;
+    }
+    uint64_t needed = map->key_used + key_size;
+    if (needed <= map->key_capacity) {
+        return true;
+    }
+    uint64_t capacity = map->key_capacity ? map->key_capacity : 4096;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    if (capacity > HASHMAP_COMPACT_MAX_KEY_BYTES) {
+        capacity = HASHMAP_COMPACT_MAX_KEY_BYTES;
+    }
+    if (capacity > SIZE_MAX) {
+        return false;
+    }
+    unsigned char *keys = (unsigned char *)realloc(map->keys, (size_t)capacity);
+    if (!keys) {
+        return false;
+    }
+    map->keys = keys;
+    map->key_capacity = capacity;
+    return true;
+}
+
+// Copy the live keys into a fresh slab of exactly their size, dropping garbage (internal function)
+static inline bool hashmap_compact_collect_keys(hashmap_compact_t *map) {
+    uint64_t live = map->key_used - map->key_garbage;
+    unsigned char *keys = (unsigned char *)malloc(live ? (size_t)live : 1);
+    if (!keys) {
+        return false;
+    }
+    uint64_t offset = 0;
+    for (size_t i = 0; i < map->size; i++) {
+        hashmap_compact_entry_t *entry = &map->entries[i];
+        size_t key_size = hashmap_compact_key_size(entry);
+        memcpy(keys + offset, hashmap_compact_key(map, entry), key_size);
+        entry->key = offset << HASHMAP_COMPACT_SIZE_BITS | key_size;
+        offset += key_size;
+    }
+    free(map->keys);
+    map->keys = keys;
+    map->key_used = live;
+    map->key_capacity = live ? live : 1;
+    map->key_garbage = 0;
+    return true;
+}
+
+// Create a new compact hashmap from an options struct. Uses initial_capacity,
+// value_free, hash_func, value_size, max_load_factor and growth_factor.
+static inline hashmap_compact_t *hashmap_compact_create_ex(const hashmap_options_t *options) {
+    hashmap_options_t defaults = {0};
+    if (!options) {
+        options = &defaults;
+    }
+
+    hashmap_compact_t *map = (hashmap_compact_t *)calloc(1, sizeof(hashmap_compact_t));
+    if (!map) {
+        return NULL;
+    }
+    map->value_size = options->value_size;
+    map->value_stride = options->value_size ? options->value_size : sizeof(void *);
+    map->value_free = options->value_size ? NULL : options->value_free;  // Inline values are owned by the map
+    map->hash_func = options->hash_func;
+    map->max_load_factor = hashmap_options_load_factor(options, HASHMAP_DEFAULT_MAX_LOAD_FACTOR);
+    map->growth_shift = hashmap_options_growth_shift(options);
+
+    size_t initial_capacity = options->initial_capacity ? options->initial_capacity : HASHMAP_DEFAULT_CAPACITY;
+    initial_capacity = hashmap_round_capacity(initial_capacity);
+    if (!hashmap_compact_rehash(map, initial_capacity)) {
+        free(map);
+        return NULL;
+    }
+    return map;
+}
+
+// Create a new compact hashmap
+static inline hashmap_compact_t *hashmap_compact_create(size_t initial_capacity, value_free_func_t value_free) {
+    hashmap_options_t options = {0};
+    options.initial_capacity = initial_capacity;
+    options.value_free = value_free;
+    return hashmap_compact_create_ex(&options);
+}
+
+// Remove every entry, keeping the arrays for reuse
+static inline void hashmap_compact_clear(hashmap_compact_t *map) {
+    if (!map) {
+        return;
+    }
+    if (map->value_free) {
+        for (size_t i = 0; i < map->size; i++) {
+            map->value_free(hashmap_compact_value(map, i));
+        }
+    }
+    memset(map->buckets, 0xFF, map->capacity * sizeof(uint32_t));
+    map->size = 0;
+    map->key_used = 0;
+    map->key_garbage = 0;
+}
+
+// Destroy the hashmap and free all resources
+static inline void hashmap_compact_destroy(hashmap_compact_t *map) {
+    if (!map) {
+        return;
+    }
+    hashmap_compact_clear(map);
+    free(map->buckets);
+    free(map->entries);
+    free(map->values);
+    free(map->keys);
+    free(map);
+}
+
+// Insert or update a key-value pair. In value_size mode value points to the
+// bytes to copy in (NULL stores zeros).
+static inline bool hashmap_compact_put(hashmap_compact_t *map, const void *key, size_t key_size, void *value) {
+    if (!map || !key || key_size == 0 || key_size > HASHMAP_COMPACT_MAX_KEY_SIZE) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    uint32_t *link = hashmap_compact_find_link(map, key, key_size, hash);
+    if (link) {
+        if (map->value_free) {
+            void *old = hashmap_compact_value(map, *link);
+            if (old != value) {
+                map->value_free(old);
+            }
+        }
+        hashmap_compact_store_value(map, *link, value);
+        return true;
+    }
+
+    if (map->size >= HASHMAP_COMPACT_MAX_ENTRIES) {
+        return false;
+    }
+    if (map->size >= map->max_entries && map->capacity < HASHMAP_COMPACT_MAX_BUCKETS) {
+        size_t shift = map->growth_shift;
+        size_t new_capacity = map->capacity > (HASHMAP_COMPACT_MAX_BUCKETS >> shift) ? HASHMAP_COMPACT_MAX_BUCKETS
+                                                                                     : map->capacity << shift;
+        if (!hashmap_compact_rehash(map, new_capacity)) {
+            return false;
+        }
+    }
+    if (map->size == map->entry_capacity) {
+        size_t grown = map->entry_capacity ? map->entry_capacity * 2 : HASHMAP_DEFAULT_CAPACITY;
+        if (grown > HASHMAP_COMPACT_MAX_ENTRIES) {
+            grown = HASHMAP_COMPACT_MAX_ENTRIES;
+        }
+        if (!hashmap_compact_resize_entries(map, grown)) {
+            return false;
+        }
+    }
+    if (!hashmap_compact_reserve_keys(map, key_size)) {
+        return false;
+    }
+
+    size_t index = map->size;
+    size_t bucket = hashmap_bucket_index(hash, map->capacity);
+    hashmap_compact_entry_t *entry = &map->entries[index];
+    memcpy(map->keys + map->key_used, key, key_size);
+    entry->key = map->key_used << HASHMAP_COMPACT_SIZE_BITS | key_size;
+    entry->hash = (uint32_t)hash;
+    entry->next = map->buckets[bucket];
+    map->buckets[bucket] = (uint32_t)index;
+    map->key_used += key_size;
+    hashmap_compact_store_value(map, index, value);
+    map->size++;
+    return true;
+}
+
+// Get the value associated with a key. In value_size mode this points into
+// the values array and is valid until the next put or remove.
+static inline void *hashmap_compact_get(const hashmap_compact_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    uint32_t *link = hashmap_compact_find_link(map, key, key_size, hash);
+    return link ? hashmap_compact_value(map, *link) : NULL;
+}
+
+// Remove a key-value pair. The last entry moves into the freed index.
+static inline bool hashmap_compact_remove(hashmap_compact_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    uint32_t *link = hashmap_compact_find_link(map, key, key_size, hash);
+    if (!link) {
+        return false;
+    }
+
+    uint32_t index = *link;
+    hashmap_compact_entry_t *entry = &map->entries[index];
+    *link = entry->next;
+    map->key_garbage += hashmap_compact_key_size(entry);
+    if (map->value_free) {
+        map->value_free(hashmap_compact_value(map, index));
+    }
+
+    // Fill the hole with the last entry, redirecting the link that names it
+    uint32_t last = (uint32_t)(map->size - 1);
+    if (index != last) {
+        hashmap_compact_entry_t *moved = &map->entries[last];
+        uint32_t *to_last = &map->buckets[hashmap_bucket_index(moved->hash, map->capacity)];
+        while (*to_last != last) {
+            to_last = &map->entries[*to_last].next;
+        }
+        *to_last = index;
+        *entry = *moved;
+        memcpy(hashmap_compact_value_slot(map, index), hashmap_compact_value_slot(map, last), map->value_stride);
+    }
+    map->size--;
+
+    // Reclaim the slab once removed keys dominate it; failure just defers it
+    if (map->key_garbage >= HASHMAP_COMPACT_MIN_GARBAGE && map->key_garbage * 2 > map->key_used) {
+        hashmap_compact_collect_keys(map);
+    }
+    return true;
+}
+
+// Check if a key exists in the hashmap
+static inline bool hashmap_compact_contains(const hashmap_compact_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    return hashmap_compact_find_link(map, key, key_size, hash) != NULL;
+}
+
+// Get the number of key-value pairs in the hashmap
+static inline size_t hashmap_compact_size(const hashmap_compact_t *map) {
+    return map ? map->size : 0;
+}
+
+// Check if the hashmap is empty
+static inline bool hashmap_compact_is_empty(const hashmap_compact_t *map) {
+    return map ? map->size == 0 : true;
+}
+
+// Size buckets and entry arrays once so n_entries fit without further growth;
+// key_bytes (may be 0) pre-sizes the key slab as well
+static inline bool hashmap_compact_reserve(hashmap_compact_t *map, size_t n_entries, size_t key_bytes) {
+    if (!map || n_entries > HASHMAP_COMPACT_MAX_ENTRIES) {
+        return false;
+    }
+
+    size_t required = hashmap_capacity_for_load(n_entries, map->max_load_factor);
+    if (required > HASHMAP_COMPACT_MAX_BUCKETS) {
+        required = HASHMAP_COMPACT_MAX_BUCKETS;
+    }
+    if (required > map->capacity && !hashmap_compact_rehash(map, required)) {
+        return false;
+    }
+    if (n_entries > map->entry_capacity && !hashmap_compact_resize_entries(map, n_entries)) {
+        return false;
+    }
+    return key_bytes == 0 || hashmap_compact_reserve_keys(map, key_bytes);
+}
+
+// Trim every array to the current entries: fewer buckets if the load allows,
+// exact-size entry and value arrays, and a key slab without garbage
+static inline bool hashmap_compact_shrink_to_fit(hashmap_compact_t *map) {
+    if (!map) {
+        return false;
+    }
+
+    size_t target = hashmap_capacity_for_load(map->size, map->max_load_factor);
+    if (target < map->capacity && !hashmap_compact_rehash(map, target)) {
+        return false;
+    }
+    if (map->entry_capacity > map->size && !hashmap_compact_resize_entries(map, map->size)) {
+        return false;
+    }
+    return hashmap_compact_collect_keys(map);
+}
+
+// Call visit for every entry until it returns false; returns the number of
+// entries visited. Entries are read in index order, which is a sequential
+// scan. visit must not modify the map.
+static inline size_t hashmap_compact_foreach(const hashmap_compact_t *map, hashmap_visit_func_t visit, void *ctx) {
+    if (!map || !visit) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < map->size; i++) {
+        const hashmap_compact_entry_t *entry = &map->entries[i];
+        if (!visit(hashmap_compact_key(map, entry), hashmap_compact_key_size(entry),
+                   hashmap_compact_value(map, i), ctx)) {
+            return i + 1;
+        }
+    }
+    return map->size;
+}
+
+// Fill out with the map's memory footprint
+static inline bool hashmap_compact_memory(const hashmap_compact_t *map, hashmap_compact_usage_t *out) {
+    if (!map || !out) {
+        return false;
+    }
+
+    out->size = map->size;
+    out->bucket_bytes = map->capacity * sizeof(uint32_t);
+    out->entry_bytes = map->entry_capacity * sizeof(hashmap_compact_entry_t);
+    out->value_bytes = map->entry_capacity * map->value_stride;
+    out->key_bytes = map->key_capacity;
+    out->key_garbage = map->key_garbage;
+    out->total_bytes = sizeof(hashmap_compact_t) + out->bucket_bytes + out->entry_bytes + out->value_bytes +
+                       out->key_bytes;
+    out->bytes_per_entry = map->size ? (double)out->total_bytes / (double)map->size : 0.0;
+    return true;
+}
+
+#endif // HASHMAP_COMPACT_H
@@ -0,0 +1,399 @@
+#ifndef HASHMAP_CONCURRENT_H
+#define HASHMAP_CONCURRENT_H
+
+// Reader-writer locks are POSIX, not C11. Under a strict -std, request them
+// when this is the first header included and no feature level was chosen
+#if defined(__STRICT_ANSI__) && !defined(_POSIX_C_SOURCE) && !defined(_XOPEN_SOURCE) && \
+    !defined(_GNU_SOURCE) && !defined(_DEFAULT_SOURCE) && !defined(HASHMAP_H) && !defined(_FEATURES_H)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "hashmap.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+// Thread-safe hashmap with lock striping
+//
+// The key space is split into independent segments, each a complete hashmap_t
+// guarded by its own reader-writer lock. A key's segment comes from the top
+// bits of its hash and its bucket from the low bits, so the hash is computed
+// once per call. Lookups take a read lock and never block each other; a write
+// locks only its own segment. Each segment grows on its own, so a resize only
+// stalls the keys that hash into the segment being resized.
+//
+// With options.cache_capacity each segment is a cache holding its share of
+// the bound. Lookups run under the shared lock and so never set the CLOCK
+// reference byte; only puts do, and reads alone leave eviction close to
+// insertion order.
+//
+// With options.deferred_resize a segment that grows only installs its new
+// bucket array, and hashmap_concurrent_resize_step drains the old one a chunk
+// at a time under the segment's write lock. options.resize_thread runs that
+// step on a background thread woken by each growth, so no application thread
+// rehashes a whole segment inline; writers help only if it falls a full
+// table behind.
+//
+// Requires POSIX reader-writer locks. Under a strict -std (e.g. -std=c11)
+// compile with -D_POSIX_C_SOURCE=200809L, unless this header is included
+// before any other, in which case it defines the macro itself. Link with
+// -pthread. Allocator hooks in the options are used by every segment and
+// must themselves be thread-safe.
+
+#define HASHMAP_CONCURRENT_DEFAULT_SEGMENTS HASHMAP_DEFAULT_PARTITIONS  // Lock stripes used when 0 is requested
+#define HASHMAP_CONCURRENT_RESIZE_CHUNK 1024  // Old buckets migrated per write-lock hold
+
+// One lock stripe; the alignment rounds its size up to whole cache lines
+// (internal structure)
+typedef struct hashmap_segment {
+    _Alignas(HASHMAP_CACHE_LINE) pthread_rwlock_t lock;
+    hashmap_t *map;
+} hashmap_segment_t;
+
+// Concurrent hashmap structure
+typedef struct hashmap_concurrent {
+    hashmap_segment_t *segments;    // Cache-line aligned array
+    size_t segment_count;           // Always a power of two
+    unsigned segment_bits;          // log2(segment_count)
+    hash_func_t hash_func;          // NULL for the built-in hash
+    bool has_resizer;               // options.resize_thread started a resizer
+    pthread_t resizer;
+    pthread_mutex_t resize_lock;    // Guards the two flags below
+    pthread_cond_t resize_wake;
+    bool resize_requested;          // A segment grew since the resizer last looked
+    bool resize_stop;
+} hashmap_concurrent_t;
+
+// Segment owning a hash (internal function)
+static inline hashmap_segment_t *hashmap_concurrent_segment(const hashmap_concurrent_t *map, size_t hash) {
+    return &map->segments[hashmap_partition_index(hash, map->segment_bits)];
+}
+
+// Ask the resizer to look for pending migrations (internal function)
+static inline void hashmap_concurrent_wake_resizer(hashmap_concurrent_t *map) {
+    if (!map->has_resizer) {
+        return;
+    }
+    pthread_mutex_lock(&map->resize_lock);
+    map->resize_requested = true;
+    pthread_cond_signal(&map->resize_wake);
+    pthread_mutex_unlock(&map->resize_lock);
+}
+
+// Migrate up to n_buckets old buckets across the segments one chunk per lock
+// hold; with yield the CPU is given up between chunks so writers queued on
+// the lock get it first (internal function)
+static inline size_t hashmap_concurrent_migrate(hashmap_concurrent_t *map, size_t n_buckets, bool yield) {
+    size_t pending = 0;
+    for (size_t i = 0; i < map->segment_count; i++) {
+        hashmap_segment_t *segment = &map->segments[i];
+        size_t left;
+        do {
+            size_t chunk = n_buckets < HASHMAP_CONCURRENT_RESIZE_CHUNK ? n_buckets : HASHMAP_CONCURRENT_RESIZE_CHUNK;
+            pthread_rwlock_wrlock(&segment->lock);
+            size_t before = hashmap_resize_step(segment->map, 0);
+            left = hashmap_resize_step(segment->map, chunk);
+            pthread_rwlock_unlock(&segment->lock);
+            n_buckets -= before > left ? before - left : 0;
+            if (yield && left) {
+                sched_yield();
+            }
+        } while (left && n_buckets);
+        pending += left;
+    }
+    return pending;
+}
+
+// Migrate up to n_buckets old buckets of pending segment resizes, holding a
+// segment's write lock for at most HASHMAP_CONCURRENT_RESIZE_CHUNK buckets at
+// a time, and return the number of old buckets still pending in all segments.
+// Drives options.deferred_resize from the caller's own loop; not needed with
+// options.resize_thread.
+static inline size_t hashmap_concurrent_resize_step(hashmap_concurrent_t *map, size_t n_buckets) {
+    if (!map) {
+        return 0;
+    }
+    return hashmap_concurrent_migrate(map, n_buckets, false);
+}
+
+// Resizer thread: sleep until a segment grows, then drain every pending
+// migration (internal function)
+static inline void *hashmap_concurrent_resizer(void *arg) {
+    hashmap_concurrent_t *map = (hashmap_concurrent_t *)arg;
+    pthread_mutex_lock(&map->resize_lock);
+    for (;;) {
+        while (!map->resize_requested && !map->resize_stop) {
+            pthread_cond_wait(&map->resize_wake, &map->resize_lock);
+        }
+        if (map->resize_stop) {
+            break;
+        }
+        map->resize_requested = false;
+        pthread_mutex_unlock(&map->resize_lock);
+        hashmap_concurrent_migrate(map, SIZE_MAX, true);
+        pthread_mutex_lock(&map->resize_lock);
+    }
+    pthread_mutex_unlock(&map->resize_lock);
+    return NULL;
+}
+
+// Start the resizer thread (internal function)
+static inline bool hashmap_concurrent_start_resizer(hashmap_concurrent_t *map) {
+    if (pthread_mutex_init(&map->resize_lock, NULL) != 0) {
+        return false;
+    }
+    if (pthread_cond_init(&map->resize_wake, NULL) != 0) {
+        pthread_mutex_destroy(&map->resize_lock);
+        return false;
+    }
+    map->resize_requested = false;
+    map->resize_stop = false;
+    if (pthread_create(&map->resizer, NULL, hashmap_concurrent_resizer, map) != 0) {
+        pthread_cond_destroy(&map->resize_wake);
+        pthread_mutex_destroy(&map->resize_lock);
+        return false;
+    }
+    map->has_resizer = true;
+    return true;
+}
+
+// Stop and join the resizer thread, if any (internal function)
+static inline void hashmap_concurrent_stop_resizer(hashmap_concurrent_t *map) {
+    if (!map->has_resizer) {
+        return;
+    }
+    pthread_mutex_lock(&map->resize_lock);
+    map->resize_stop = true;
+    pthread_cond_signal(&map->resize_wake);
+    pthread_mutex_unlock(&map->resize_lock);
+    pthread_join(map->resizer, NULL);
+    pthread_cond_destroy(&map->resize_wake);
+    pthread_mutex_destroy(&map->resize_lock);
+    map->has_resizer = false;
+}
+
+// Tear down the first n segments (internal function)
+static inline void hashmap_concurrent_release(hashmap_concurrent_t *map, size_t n) {
+    hashmap_concurrent_stop_resizer(map);
+    for (size_t i = 0; i < n; i++) {
+        pthread_rwlock_destroy(&map->segments[i].lock);
+        hashmap_destroy(map->segments[i].map);
+    }
+    free(map->segments);
+    free(map);
+}
+
+// Create a new concurrent hashmap from an options struct. initial_capacity is
+// the total across all segments.
+static inline hashmap_concurrent_t *hashmap_concurrent_create_ex(const hashmap_options_t *options) {
+    hashmap_options_t defaults = {0};
+    if (!options) {
+        options = &defaults;
+    }
+
+    size_t segment_count = options->concurrency;
+    if (segment_count == 0) {
+        segment_count = HASHMAP_CONCURRENT_DEFAULT_SEGMENTS;
+    }
+    segment_count = hashmap_round_capacity(segment_count);
+    if (segment_count > SIZE_MAX / sizeof(hashmap_segment_t)) {
+        return NULL;
+    }
+
+    hashmap_concurrent_t *map = (hashmap_concurrent_t *)malloc(sizeof(hashmap_concurrent_t));
+    if (!map) {
+        return NULL;
+    }
+    map->segments = (hashmap_segment_t *)aligned_alloc(HASHMAP_CACHE_LINE,
+                                                       segment_count * sizeof(hashmap_segment_t));
+    if (!map->segments) {
+        free(map);
+        return NULL;
+    }
+    map->segment_count = segment_count;
+    map->segment_bits = 0;
+    while (((size_t)1 << map->segment_bits) < segment_count) {
+        map->segment_bits++;
+    }
+    map->hash_func = options->hash_func;
+    map->has_resizer = false;
+
+    // Spread the requested capacity over the segments
+    hashmap_options_t segment_options = *options;
+    if (options->initial_capacity) {
+        segment_options.initial_capacity = (options->initial_capacity + segment_count - 1) / segment_count;
+    }
+    if (options->cache_capacity) {
+        segment_options.cache_capacity = (options->cache_capacity + segment_count - 1) / segment_count;
+    }
+    if (options->resize_thread) {
+        segment_options.deferred_resize = true;
+    }
+
+    for (size_t i = 0; i < segment_count; i++) {
+        hashmap_segment_t *segment = &map->segments[i];
+        segment->map = hashmap_create_ex(&segment_options);
+        if (!segment->map) {
+            hashmap_concurrent_release(map, i);
+            return NULL;
+        }
+        if (pthread_rwlock_init(&segment->lock, NULL) != 0) {
+            hashmap_destroy(segment->map);
+            hashmap_concurrent_release(map, i);
+            return NULL;
+        }
+    }
+    if (options->resize_thread && !hashmap_concurrent_start_resizer(map)) {
+        hashmap_concurrent_release(map, segment_count);
+        return NULL;
+    }
+
+    return map;
+}
+
+// Create a new concurrent hashmap with the default number of segments
+static inline hashmap_concurrent_t *hashmap_concurrent_create(
+    size_t initial_capacity,
+    key_free_func_t key_free,
+    value_free_func_t value_free
+) {
+    hashmap_options_t options = {0};
+    options.initial_capacity = initial_capacity;
+    options.key_free = key_free;
+    options.value_free = value_free;
+    return hashmap_concurrent_create_ex(&options);
+}
+
+// Destroy the hashmap and free all resources (no other thread may use it)
+static inline void hashmap_concurrent_destroy(hashmap_concurrent_t *map) {
+    if (!map) {
+        return;
+    }
+    hashmap_concurrent_release(map, map->segment_count);
+}
+
+// Clear all entries, one segment at a time
+static inline void hashmap_concurrent_clear(hashmap_concurrent_t *map) {
+    if (!map) {
+        return;
+    }
+
+    for (size_t i = 0; i < map->segment_count; i++) {
+        hashmap_segment_t *segment = &map->segments[i];
+        pthread_rwlock_wrlock(&segment->lock);
+        hashmap_clear(segment->map);
+        pthread_rwlock_unlock(&segment->lock);
+    }
+}
+
+// Insert or update a key-value pair
+static inline bool hashmap_concurrent_put(hashmap_concurrent_t *map, const void *key, size_t key_size, void *value) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_segment_t *segment = hashmap_concurrent_segment(map, hash);
+
+    pthread_rwlock_wrlock(&segment->lock);
+    size_t capacity = segment->map->capacity;
+    bool result = hashmap_put_hashed(segment->map, key, key_size, hash, value);
+    bool grew = segment->map->capacity != capacity;
+    pthread_rwlock_unlock(&segment->lock);
+    if (grew) {
+        hashmap_concurrent_wake_resizer(map);
+    }
+    return result;
+}
+
+// Get the value associated with a key. The map does not keep the value alive:
+// with a value_free function, a concurrent remove or update may free it. In
+// value_size mode the result points into the entry, which a concurrent put
+// overwrites and a remove frees, so use hashmap_concurrent_get_copy whenever
+// other threads may write the key.
+static inline void *hashmap_concurrent_get(const hashmap_concurrent_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_segment_t *segment = hashmap_concurrent_segment(map, hash);
+
+    pthread_rwlock_rdlock(&segment->lock);
+    hashmap_entry_t **link = hashmap_find_link(segment->map, key, key_size, hash);
+    // Expired entries read as absent; reclaiming them needs the write lock
+    void *value = link && !hashmap_entry_expired(segment->map, *link) ? (*link)->value : NULL;
+    pthread_rwlock_unlock(&segment->lock);
+    return value;
+}
+
+// Copy a key's value into out while the segment's read lock is held: the
+// value_size bytes of the inline value, or the stored void * in pointer
+// mode. Returns false, leaving out untouched, if the key is absent.
+static inline bool hashmap_concurrent_get_copy(const hashmap_concurrent_t *map, const void *key, size_t key_size,
+                                               void *out) {
+    if (!map || !key || key_size == 0 || !out) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_segment_t *segment = hashmap_concurrent_segment(map, hash);
+
+    pthread_rwlock_rdlock(&segment->lock);
+    hashmap_entry_t **link = hashmap_find_link(segment->map, key, key_size, hash);
+    bool found = link && !hashmap_entry_expired(segment->map, *link);
+    if (found) {
+        size_t value_size = segment->map->value_size;
+        if (value_size) {
+            memcpy(out, (*link)->value, value_size);
+        } else {
+            memcpy(out, &(*link)->value, sizeof(void *));
+        }
+    }
+    pthread_rwlock_unlock(&segment->lock);
+    return found;
+}
+
+// Remove a key-value pair
+static inline bool hashmap_concurrent_remove(hashmap_concurrent_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_segment_t *segment = hashmap_concurrent_segment(map, hash);
+
+    pthread_rwlock_wrlock(&segment->lock);
+    bool removed = hashmap_remove_hashed(segment->map, key, key_size, hash);
+    pthread_rwlock_unlock(&segment->lock);
+    return removed;
+}
+
+// Check if a key exists in the hashmap
+static inline bool hashmap_concurrent_contains(const hashmap_concurrent_t *map, const void *key, size_t key_size) {
+    return hashmap_concurrent_get(map, key, key_size) != NULL;
+}
+
+// Get the number of key-value pairs. Segments are counted one at a time, so
+// the total is exact only when no writer runs concurrently.
+static inline size_t hashmap_concurrent_size(const hashmap_concurrent_t *map) {
+    if (!map) {
+        return 0;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < map->segment_count; i++) {
+        hashmap_segment_t *segment = &map->segments[i];
+        pthread_rwlock_rdlock(&segment->lock);
+        total += segment->map->size;
+        pthread_rwlock_unlock(&segment->lock);
+    }
+    return total;
+}
+
+// Check if the hashmap is empty
+static inline bool hashmap_concurrent_is_empty(const hashmap_concurrent_t *map) {
+    return hashmap_concurrent_size(map) == 0;
+}
+
+#endif // HASHMAP_CONCURRENT_H
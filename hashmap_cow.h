@@ -0,0 +1,518 @@
+#ifndef HASHMAP_COW_H
+#define HASHMAP_COW_H
+
+#include "hashmap.h"
+
+#include <stdatomic.h>
+
+// Copy-on-write hashmap with cheap consistent snapshots
+//
+// The bucket array is cut into segments of HASHMAP_COW_SEGMENT_BUCKETS
+// buckets, and each segment owns the chains hanging off its buckets. The map
+// holds a directory of segment pointers. hashmap_cow_snapshot copies only the
+// directory and takes a reference on every segment: one pointer per segment,
+// and no entry is touched. A writer about to modify a segment that a snapshot
+// still references copies the segment (its buckets and entries) and modifies
+// the copy. The cost of a snapshot is therefore paid in proportion to the
+// segments written while it is held, not to the map size.
+//
+// Writers (put, remove, clear, snapshot) are not synchronized with each
+// other; serialize them as for hashmap_t. A snapshot is immutable: it may be
+// read, walked and released from any thread, concurrently with writers, with
+// no locking. Snapshots hold their own references and stay valid after the
+// map is destroyed.
+//
+// Values: with options.value_size the bytes are copied into the entry, and a
+// segment copy copies them too. In pointer mode value_free is not used,
+// because a value removed from the map may still be reachable from a
+// snapshot; free such values once the snapshots that might hold them are
+// released. Never write through a value pointer obtained from a map that
+// has snapshots outstanding: the entry may be shared with them.
+
+#define HASHMAP_COW_SEGMENT_BUCKETS 64  // Buckets per copy-on-write segment
+
+// Segment of the bucket array, shared by the map and its snapshots (internal structure)
+typedef struct hashmap_cow_segment {
+    atomic_size_t refs;             // Map and snapshots referencing this segment
+    hashmap_entry_t *buckets[HASHMAP_COW_SEGMENT_BUCKETS];
+} hashmap_cow_segment_t;
+
+// Copy-on-write hashmap structure
+typedef struct hashmap_cow {
+    hashmap_cow_segment_t **segments;  // capacity / HASHMAP_COW_SEGMENT_BUCKETS, NULL while empty
+    size_t capacity;                // Buckets, a power of two of at least one segment
+    size_t size;
+    size_t segment_copies;          // Shared segments copied before a write, since creation
+    hash_func_t hash_func;          // NULL for the built-in hash
+    size_t value_size;              // Inline value bytes, 0 for pointer values
+    size_t value_align;
+    double max_load_factor;
+    size_t max_entries;             // Growth threshold for the current capacity
+    unsigned growth_shift;          // log2 of the growth factor
+} hashmap_cow_t;
+
+// Read-only view of a hashmap_cow_t at the moment it was taken
+typedef struct hashmap_cow_snapshot {
+    hashmap_cow_segment_t **segments;
+    size_t capacity;
+    size_t size;
+    hash_func_t hash_func;
+    size_t value_size;
+} hashmap_cow_snapshot_t;
+
+// Segments in a directory of capacity buckets (internal function)
+static inline size_t hashmap_cow_segment_count(size_t capacity) {
+    return capacity / HASHMAP_COW_SEGMENT_BUCKETS;
+}
+
+// Offset of the inline value in an entry (internal function)
+static inline size_t hashmap_cow_value_offset(size_t value_align, size_t key_size) {
+    size_t offset = sizeof(hashmap_entry_t) + key_size;
+    return (offset + value_align - 1) & ~(value_align - 1);
+}
+
+// Allocate an entry for key; value is copied in value_size mode, NULL zero-filling (internal function)
+static inline hashmap_entry_t *hashmap_cow_entry_create(size_t value_size, size_t value_align, const void *key,
+                                                        size_t key_size, size_t hash, const void *value) {
+    if (key_size > SIZE_MAX - sizeof(hashmap_entry_t) - value_size - value_align) {
+        return NULL;
+    }
+    size_t bytes = value_size ? hashmap_cow_value_offset(value_align, key_size) + value_size
+                              : sizeof(hashmap_entry_t) + key_size;
+    hashmap_entry_t *entry = (hashmap_entry_t *)malloc(bytes);
+    if (!entry) {
+        return NULL;
+    }
+    entry->next = NULL;
+    entry->hash = hash;
+    entry->key_size = key_size;
+    memcpy(entry->key, key, key_size);
+    if (value_size) {
+        entry->value = (unsigned char *)entry + hashmap_cow_value_offset(value_align, key_size);
+        if (value) {
+            memcpy(entry->value, value, value_size);
+        } else {
+            memset(entry->value, 0, value_size);
+        }
+    } else {
+        entry->value = (void *)value;
+    }
+    return entry;
+}
+
+// Drop one reference; the last one frees the segment and its entries (internal function)
+static inline void hashmap_cow_segment_release(hashmap_cow_segment_t *segment) {
+    if (!segment || atomic_fetch_sub_explicit(&segment->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    for (size_t i = 0; i < HASHMAP_COW_SEGMENT_BUCKETS; i++) {
+        hashmap_entry_t *entry = segment->buckets[i];
+        while (entry) {
+            hashmap_entry_t *next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(segment);
+}
+
+// Private copy of a shared segment, chains in the same order (internal function)
+static inline hashmap_cow_segment_t *hashmap_cow_segment_copy(const hashmap_cow_t *map,
+                                                              const hashmap_cow_segment_t *segment) {
+    hashmap_cow_segment_t *copy = (hashmap_cow_segment_t *)calloc(1, sizeof(hashmap_cow_segment_t));
+    if (!copy) {
+        return NULL;
+    }
+    atomic_init(&copy->refs, 1);
+    for (size_t i = 0; i < HASHMAP_COW_SEGMENT_BUCKETS; i++) {
+        hashmap_entry_t **tail = &copy->buckets[i];
+        for (const hashmap_entry_t *entry = segment->buckets[i]; entry; entry = entry->next) {
+            *tail = hashmap_cow_entry_create(map->value_size, map->value_align, entry->key, entry->key_size,
+                                             entry->hash, entry->value);
+            if (!*tail) {
+                hashmap_cow_segment_release(copy);
+                return NULL;
+            }
+            tail = &(*tail)->next;
+        }
+    }
+    return copy;
+}
+
+// The map's segment for bucket index, made private to the map: created if
+// still empty, copied if a snapshot shares it. NULL on allocation failure
+// (internal function)
+static inline hashmap_cow_segment_t *hashmap_cow_writable(hashmap_cow_t *map, size_t index) {
+    hashmap_cow_segment_t **slot = &map->segments[index / HASHMAP_COW_SEGMENT_BUCKETS];
+    if (!*slot) {
+        *slot = (hashmap_cow_segment_t *)calloc(1, sizeof(hashmap_cow_segment_t));
+        if (*slot) {
+            atomic_init(&(*slot)->refs, 1);
+        }
+        return *slot;
+    }
+    // Only writers add references, so a count of one cannot grow under us
+    if (atomic_load_explicit(&(*slot)->refs, memory_order_acquire) == 1) {
+        return *slot;
+    }
+    hashmap_cow_segment_t *copy = hashmap_cow_segment_copy(map, *slot);
+    if (!copy) {
+        return NULL;
+    }
+    hashmap_cow_segment_release(*slot);
+    *slot = copy;
+    map->segment_copies++;
+    return copy;
+}
+
+// Entry holding key in a directory, or NULL (internal function)
+static inline hashmap_entry_t *hashmap_cow_find(hashmap_cow_segment_t *const *segments, size_t capacity,
+                                                const void *key, size_t key_size, size_t hash) {
+    size_t index = hashmap_bucket_index(hash, capacity);
+    const hashmap_cow_segment_t *segment = segments[index / HASHMAP_COW_SEGMENT_BUCKETS];
+    if (!segment) {
+        return NULL;
+    }
+    for (hashmap_entry_t *entry = segment->buckets[index % HASHMAP_COW_SEGMENT_BUCKETS]; entry; entry = entry->next) {
+        if (hashmap_entry_matches(entry, key, key_size, hash)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Visit every entry of a directory until visit returns false (internal function)
+static inline size_t hashmap_cow_walk(hashmap_cow_segment_t *const *segments, size_t capacity,
+                                      hashmap_visit_func_t visit, void *ctx) {
+    size_t visited = 0;
+    for (size_t s = 0; s < hashmap_cow_segment_count(capacity); s++) {
+        const hashmap_cow_segment_t *segment = segments[s];
+        for (size_t i = 0; segment && i < HASHMAP_COW_SEGMENT_BUCKETS; i++) {
+            for (hashmap_entry_t *entry = segment->buckets[i]; entry; entry = entry->next) {
+                visited++;
+                if (!visit(entry->key, entry->key_size, entry->value, ctx)) {
+                    return visited;
+                }
+            }
+        }
+    }
+    return visited;
+}
+
+// Rebuild the directory with new_capacity buckets. Private segments have
+// their entries relinked; shared ones are copied and left to the snapshots
+// (internal function)
+static inline bool hashmap_cow_resize(hashmap_cow_t *map, size_t new_capacity) {
+    size_t count = hashmap_cow_segment_count(new_capacity);
+    hashmap_cow_segment_t **segments = (hashmap_cow_segment_t **)calloc(count, sizeof(*segments));
+    if (!segments) {
+        return false;
+    }
+    for (size_t s = 0; s < count; s++) {
+        segments[s] = (hashmap_cow_segment_t *)calloc(1, sizeof(hashmap_cow_segment_t));
+        if (!segments[s]) {
+            for (size_t i = 0; i < s; i++) {
+                free(segments[i]);
+            }
+            free(segments);
+            return false;
+        }
+        atomic_init(&segments[s]->refs, 1);
+    }
+
+    // Copies of shared segments are made first, so a failure leaves the map intact
+    size_t old_count = hashmap_cow_segment_count(map->capacity);
+    for (size_t s = 0; s < old_count; s++) {
+        hashmap_cow_segment_t *segment = map->segments[s];
+        if (segment && atomic_load_explicit(&segment->refs, memory_order_acquire) > 1) {
+            hashmap_cow_segment_t *copy = hashmap_cow_segment_copy(map, segment);
+            if (!copy) {
+                for (size_t i = 0; i < count; i++) {
+                    free(segments[i]);               // Still empty
+                }
+                free(segments);
+                return false;
+            }
+            hashmap_cow_segment_release(segment);
+            map->segments[s] = copy;
+            map->segment_copies++;
+        }
+    }
+
+    // Every old segment is now private: move its entries and free it
+    for (size_t s = 0; s < old_count; s++) {
+        hashmap_cow_segment_t *segment = map->segments[s];
+        for (size_t i = 0; segment && i < HASHMAP_COW_SEGMENT_BUCKETS; i++) {
+            hashmap_entry_t *entry = segment->buckets[i];
+            while (entry) {
+                hashmap_entry_t *next = entry->next;
+                size_t index = hashmap_bucket_index(entry->hash, new_capacity);
+                hashmap_cow_segment_t *target = segments[index / HASHMAP_COW_SEGMENT_BUCKETS];
+                entry->next = target->buckets[index % HASHMAP_COW_SEGMENT_BUCKETS];
+                target->buckets[index % HASHMAP_COW_SEGMENT_BUCKETS] = entry;
+                entry = next;
+            }
+        }
+        free(segment);
+    }
+
+    free(map->segments);
+    map->segments = segments;
+    map->capacity = new_capacity;
+    map->max_entries = hashmap_load_threshold(new_capacity, map->max_load_factor);
+    return true;
+}
+
+// Create a new copy-on-write hashmap from an options struct. Uses
+// initial_capacity, hash_func, value_size, max_load_factor and growth_factor.
+static inline hashmap_cow_t *hashmap_cow_create_ex(const hashmap_options_t *options) {
+    hashmap_options_t defaults = {0};
+    if (!options) {
+        options = &defaults;
+    }
+
+    size_t initial_capacity = options->initial_capacity ? options->initial_capacity : HASHMAP_DEFAULT_CAPACITY;
+    initial_capacity = hashmap_round_capacity(initial_capacity < HASHMAP_COW_SEGMENT_BUCKETS
+                                                  ? HASHMAP_COW_SEGMENT_BUCKETS
+                                                  : initial_capacity);
+
+    hashmap_cow_t *map = (hashmap_cow_t *)calloc(1, sizeof(hashmap_cow_t));
+    if (!map) {
+        return NULL;
+    }
+    map->segments = (hashmap_cow_segment_t **)calloc(hashmap_cow_segment_count(initial_capacity),
+                                                     sizeof(hashmap_cow_segment_t *));
+    if (!map->segments) {
+        free(map);
+        return NULL;
+    }
+    map->capacity = initial_capacity;
+    map->hash_func = options->hash_func;
+    map->value_size = options->value_size;
+    map->value_align = hashmap_value_align(options->value_size);
+    map->max_load_factor = hashmap_options_load_factor(options, HASHMAP_DEFAULT_MAX_LOAD_FACTOR);
+    map->max_entries = hashmap_load_threshold(initial_capacity, map->max_load_factor);
+    map->growth_shift = hashmap_options_growth_shift(options);
+    return map;
+}
+
+// Create a new copy-on-write hashmap with pointer values
+static inline hashmap_cow_t *hashmap_cow_create(size_t initial_capacity) {
+    hashmap_options_t options = {0};
+    options.initial_capacity = initial_capacity;
+    return hashmap_cow_create_ex(&options);
+}
+
+// Remove every entry; snapshots keep theirs
+static inline void hashmap_cow_clear(hashmap_cow_t *map) {
+    if (!map) {
+        return;
+    }
+    for (size_t s = 0; s < hashmap_cow_segment_count(map->capacity); s++) {
+        hashmap_cow_segment_release(map->segments[s]);
+        map->segments[s] = NULL;
+    }
+    map->size = 0;
+}
+
+// Destroy the hashmap; outstanding snapshots remain valid
+static inline void hashmap_cow_destroy(hashmap_cow_t *map) {
+    if (!map) {
+        return;
+    }
+    hashmap_cow_clear(map);
+    free(map->segments);
+    free(map);
+}
+
+// Insert or update a key-value pair. In value_size mode value points to the
+// bytes to copy in (NULL stores zeros).
+static inline bool hashmap_cow_put(hashmap_cow_t *map, const void *key, size_t key_size, void *value) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_entry_t *existing = hashmap_cow_find(map->segments, map->capacity, key, key_size, hash);
+    if (!existing && map->size >= map->max_entries && map->capacity <= (SIZE_MAX >> map->growth_shift)) {
+        if (!hashmap_cow_resize(map, map->capacity << map->growth_shift)) {
+            return false;
+        }
+    }
+
+    size_t index = hashmap_bucket_index(hash, map->capacity);
+    hashmap_cow_segment_t *segment = hashmap_cow_writable(map, index);
+    if (!segment) {
+        return false;
+    }
+    hashmap_entry_t **bucket = &segment->buckets[index % HASHMAP_COW_SEGMENT_BUCKETS];
+    if (existing) {
+        // The segment may have just been copied, so look the entry up again
+        for (hashmap_entry_t *entry = *bucket; entry; entry = entry->next) {
+            if (hashmap_entry_matches(entry, key, key_size, hash)) {
+                if (!map->value_size) {
+                    entry->value = value;
+                } else if (value) {
+                    memcpy(entry->value, value, map->value_size);
+                } else {
+                    memset(entry->value, 0, map->value_size);
+                }
+                return true;
+            }
+        }
+    }
+
+    hashmap_entry_t *entry = hashmap_cow_entry_create(map->value_size, map->value_align, key, key_size, hash, value);
+    if (!entry) {
+        return false;
+    }
+    entry->next = *bucket;
+    *bucket = entry;
+    map->size++;
+    return true;
+}
+
+// Get the value associated with a key (see the header note on writing through it)
+static inline void *hashmap_cow_get(const hashmap_cow_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_entry_t *entry = hashmap_cow_find(map->segments, map->capacity, key, key_size, hash);
+    return entry ? entry->value : NULL;
+}
+
+// Remove a key-value pair; snapshots that hold it keep it
+static inline bool hashmap_cow_remove(hashmap_cow_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    if (!hashmap_cow_find(map->segments, map->capacity, key, key_size, hash)) {
+        return false;                   // Absent keys never cost a segment copy
+    }
+    size_t index = hashmap_bucket_index(hash, map->capacity);
+    hashmap_cow_segment_t *segment = hashmap_cow_writable(map, index);
+    if (!segment) {
+        return false;
+    }
+    for (hashmap_entry_t **link = &segment->buckets[index % HASHMAP_COW_SEGMENT_BUCKETS]; *link;
+         link = &(*link)->next) {
+        if (hashmap_entry_matches(*link, key, key_size, hash)) {
+            hashmap_entry_t *entry = *link;
+            *link = entry->next;
+            free(entry);
+            map->size--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check if a key exists in the hashmap
+static inline bool hashmap_cow_contains(const hashmap_cow_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    return hashmap_cow_find(map->segments, map->capacity, key, key_size, hash) != NULL;
+}
+
+// Get the number of key-value pairs in the hashmap
+static inline size_t hashmap_cow_size(const hashmap_cow_t *map) {
+    return map ? map->size : 0;
+}
+
+// Check if the hashmap is empty
+static inline bool hashmap_cow_is_empty(const hashmap_cow_t *map) {
+    return map ? map->size == 0 : true;
+}
+
+// Call visit for every entry until it returns false; returns the number of
+// entries visited. visit must not modify the map.
+static inline size_t hashmap_cow_foreach(const hashmap_cow_t *map, hashmap_visit_func_t visit, void *ctx) {
+    if (!map || !visit) {
+        return 0;
+    }
+    return hashmap_cow_walk(map->segments, map->capacity, visit, ctx);
+}
+
+// Take a read-only view of the map as it is now. Costs one pointer copy and
+// reference per segment; NULL on allocation failure. Serialize with writers.
+static inline hashmap_cow_snapshot_t *hashmap_cow_snapshot(hashmap_cow_t *map) {
+    if (!map) {
+        return NULL;
+    }
+
+    size_t count = hashmap_cow_segment_count(map->capacity);
+    hashmap_cow_snapshot_t *snapshot = (hashmap_cow_snapshot_t *)malloc(sizeof(hashmap_cow_snapshot_t));
+    hashmap_cow_segment_t **segments = (hashmap_cow_segment_t **)malloc(count * sizeof(*segments));
+    if (!snapshot || !segments) {
+        free(snapshot);
+        free(segments);
+        return NULL;
+    }
+    for (size_t s = 0; s < count; s++) {
+        segments[s] = map->segments[s];
+        if (segments[s]) {
+            atomic_fetch_add_explicit(&segments[s]->refs, 1, memory_order_relaxed);
+        }
+    }
+    snapshot->segments = segments;
+    snapshot->capacity = map->capacity;
+    snapshot->size = map->size;
+    snapshot->hash_func = map->hash_func;
+    snapshot->value_size = map->value_size;
+    return snapshot;
+}
+
+// Release a snapshot, freeing whatever only it still referenced
+static inline void hashmap_cow_snapshot_release(hashmap_cow_snapshot_t *snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    for (size_t s = 0; s < hashmap_cow_segment_count(snapshot->capacity); s++) {
+        hashmap_cow_segment_release(snapshot->segments[s]);
+    }
+    free(snapshot->segments);
+    free(snapshot);
+}
+
+// Get a key's value as of the snapshot; valid until the snapshot is released
+static inline void *hashmap_cow_snapshot_get(const hashmap_cow_snapshot_t *snapshot, const void *key,
+                                             size_t key_size) {
+    if (!snapshot || !key || key_size == 0) {
+        return NULL;
+    }
+    size_t hash = hashmap_hash_key(snapshot->hash_func, key, key_size);
+    hashmap_entry_t *entry = hashmap_cow_find(snapshot->segments, snapshot->capacity, key, key_size, hash);
+    return entry ? entry->value : NULL;
+}
+
+// Check if a key existed when the snapshot was taken
+static inline bool hashmap_cow_snapshot_contains(const hashmap_cow_snapshot_t *snapshot, const void *key,
+                                                 size_t key_size) {
+    if (!snapshot || !key || key_size == 0) {
+        return false;
+    }
+    size_t hash = hashmap_hash_key(snapshot->hash_func, key, key_size);
+    return hashmap_cow_find(snapshot->segments, snapshot->capacity, key, key_size, hash) != NULL;
+}
+
+// Get the number of key-value pairs in the snapshot
+static inline size_t hashmap_cow_snapshot_size(const hashmap_cow_snapshot_t *snapshot) {
+    return snapshot ? snapshot->size : 0;
+}
+
+// Call visit for every entry of the snapshot until it returns false; returns
+// the number of entries visited
+static inline size_t hashmap_cow_snapshot_foreach(const hashmap_cow_snapshot_t *snapshot,
+                                                  hashmap_visit_func_t visit, void *ctx) {
+    if (!snapshot || !visit) {
+        return 0;
+    }
+    return hashmap_cow_walk(snapshot->segments, snapshot->capacity, visit, ctx);
+}
+
+#endif // HASHMAP_COW_H
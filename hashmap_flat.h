@@ -0,0 +1,716 @@
+#ifndef HASHMAP_FLAT_H
+#define HASHMAP_FLAT_H
+
+#include "hashmap.h"
+
+// Open-addressing engine (Swiss-table style)
+//
+// Entries live directly in a slot array; a parallel array of one-byte control
+// tags (7 bits of hash, or EMPTY / DELETED) is scanned a group at a time, so a
+// lookup usually touches one control group and one slot. The API mirrors the
+// chained hashmap_* functions one-to-one, so switching engines is a rename.
+
+#define HASHMAP_FLAT_GROUP_WIDTH 16     // Control bytes examined per probe step
+#define HASHMAP_FLAT_INLINE_KEY_SIZE 16 // Keys up to this size are stored in the slot
+#define HASHMAP_FLAT_MAX_LOAD_FACTOR 0.875 // Default and upper bound for the flat engine
+
+#define HASHMAP_FLAT_CTRL_EMPTY ((int8_t)-128)  // 0x80: never used since last rehash
+#define HASHMAP_FLAT_CTRL_DELETED ((int8_t)-2)  // 0xFE: tombstone left by a remove
+
+// Slot structure
+typedef struct hashmap_flat_slot {
+    size_t hash;                    // Full hash of the key
+    size_t key_size;                // Size of key in bytes
+    void *value;                    // Value pointer (not copied)
+    union {
+        void *ptr;                  // Copied key data (key_size > inline size)
+        unsigned char bytes[HASHMAP_FLAT_INLINE_KEY_SIZE]; // Inline key data
+    } key;
+} hashmap_flat_slot_t;
+
+// Open-addressing hashmap structure
+typedef struct hashmap_flat {
+    int8_t *ctrl;                   // One control byte per slot
+    hashmap_flat_slot_t *slots;
+    size_t capacity;                // Power of two, multiple of the group width
+    size_t size;
+    size_t growth_left;             // Inserts into EMPTY slots allowed before rehash
+    key_free_func_t key_free;       // Not used (keys are always copied and freed internally)
+    value_free_func_t value_free;
+    hash_func_t hash_func;          // NULL for the built-in hash
+    double max_load_factor;         // At most HASHMAP_FLAT_MAX_LOAD_FACTOR
+    unsigned growth_shift;          // log2 of the growth factor
+    hashmap_table_memory_t table_memory;
+    hashmap_allocator_t allocator;  // Map, tables and out-of-line keys
+} hashmap_flat_t;
+
+// Index of the lowest set bit (mask must be non-zero)
+static inline unsigned hashmap_flat_ctz(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned n = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+#define HASHMAP_FLAT_HIGH_BITS 0x8080808080808080ULL
+#define HASHMAP_FLAT_LOW_BITS 0x7F7F7F7F7F7F7F7FULL
+
+// Pack the high bit of each byte of an 8-byte control word into bits 0-7,
+// first byte lowest. word may have no other bits set; the multiply moves
+// byte i's bit to bit 56 + i with no overlapping partial products
+// (internal function)
+static inline uint32_t hashmap_flat_pack_word(uint64_t word) {
+    return (uint32_t)(((word >> 7) * 0x0102040810204080ULL) >> 56);
+}
+
+// Portable versions of the group kernels below, one word of eight control
+// bytes at a time on little-endian targets and one byte at a time elsewhere.
+// They define the results the vector kernels must reproduce (internal functions)
+static inline uint32_t hashmap_flat_match_portable(const int8_t *group, int8_t tag) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t pattern = 0x0101010101010101ULL * (uint8_t)tag;
+    uint32_t mask = 0;
+    for (unsigned half = 0; half < 2; half++) {
+        uint64_t diff = hashmap_read64((const uint8_t *)group + half * 8) ^ pattern;
+        // High bit set exactly in the zero bytes: no byte's sum carries into the next
+        uint64_t zero = ~(((diff & HASHMAP_FLAT_LOW_BITS) + HASHMAP_FLAT_LOW_BITS) | diff) & HASHMAP_FLAT_HIGH_BITS;
+        mask |= hashmap_flat_pack_word(zero) << (half * 8);
+    }
+    return mask;
+#else
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < HASHMAP_FLAT_GROUP_WIDTH; i++) {
+        mask |= (uint32_t)(group[i] == tag) << i;
+    }
+    return mask;
+#endif
+}
+
+static inline uint32_t hashmap_flat_match_free_portable(const int8_t *group) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return hashmap_flat_pack_word(hashmap_read64((const uint8_t *)group) & HASHMAP_FLAT_HIGH_BITS) |
+           hashmap_flat_pack_word(hashmap_read64((const uint8_t *)group + 8) & HASHMAP_FLAT_HIGH_BITS) << 8;
+#else
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < HASHMAP_FLAT_GROUP_WIDTH; i++) {
+        mask |= (uint32_t)(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+#if defined(__ARM_NEON) && defined(__aarch64__) && !defined(__SSE2__)
+// movemask for NEON: weight each lane's all-ones result by its bit and add
+// up each half (internal function)
+static inline uint32_t hashmap_flat_neon_mask(uint8x16_t lanes) {
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t bits = vandq_u8(lanes, vld1q_u8(weights));
+    return (uint32_t)vaddv_u8(vget_low_u8(bits)) | (uint32_t)vaddv_u8(vget_high_u8(bits)) << 8;
+}
+#endif
+
+// Bitmask of group positions whose control byte equals tag
+static inline uint32_t hashmap_flat_match(const int8_t *group, int8_t tag) {
+#if defined(__SSE2__)
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return hashmap_flat_neon_mask(vceqq_s8(vld1q_s8(group), vdupq_n_s8(tag)));
+#else
+    return hashmap_flat_match_portable(group, tag);
+#endif
+}
+
+// Bitmask of group positions that are EMPTY or DELETED (sign bit set)
+static inline uint32_t hashmap_flat_match_free(const int8_t *group) {
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return hashmap_flat_neon_mask(vcltzq_s8(vld1q_s8(group)));
+#else
+    return hashmap_flat_match_free_portable(group);
+#endif
+}
+
+static inline int8_t hashmap_flat_tag(size_t hash) {
+    return (int8_t)(hash & 0x7F);
+}
+
+// Entries a table of capacity slots may hold at load factor lf; always
+// leaves a free slot (internal function)
+static inline size_t hashmap_flat_load_limit(size_t capacity, double lf) {
+    size_t limit = hashmap_load_threshold(capacity, lf);
+    if (limit >= capacity) {
+        limit = capacity - 1;
+    }
+    return limit ? limit : 1;
+}
+
+// Entries the table may hold at its load factor; always leaves a free slot
+static inline size_t hashmap_flat_max_load(const hashmap_flat_t *map, size_t capacity) {
+    return hashmap_flat_load_limit(capacity, map->max_load_factor);
+}
+
+static inline const void *hashmap_flat_slot_key(const hashmap_flat_slot_t *slot) {
+    return slot->key_size > HASHMAP_FLAT_INLINE_KEY_SIZE ? slot->key.ptr : slot->key.bytes;
+}
+
+// Mark the full slot at index free. A group that still has an EMPTY slot has
+// never been full, so no probe sequence continues past it and the slot can go
+// back to EMPTY; returns true in that case, false for a tombstone (internal function)
+static inline bool hashmap_flat_release_ctrl(int8_t *ctrl, size_t index) {
+    size_t group = index / HASHMAP_FLAT_GROUP_WIDTH;
+    if (hashmap_flat_match(ctrl + group * HASHMAP_FLAT_GROUP_WIDTH, HASHMAP_FLAT_CTRL_EMPTY)) {
+        ctrl[index] = HASHMAP_FLAT_CTRL_EMPTY;
+        return true;
+    }
+    ctrl[index] = HASHMAP_FLAT_CTRL_DELETED;
+    return false;
+}
+
+// Round a requested slot count up to a power of two of at least one group
+static inline size_t hashmap_flat_round_capacity(size_t capacity) {
+    return hashmap_round_capacity(capacity < HASHMAP_FLAT_GROUP_WIDTH ? HASHMAP_FLAT_GROUP_WIDTH : capacity);
+}
+
+// Find the slot holding key, or SIZE_MAX (internal function)
+static inline size_t hashmap_flat_find(const hashmap_flat_t *map, const void *key,
+                                       size_t key_size, size_t hash) {
+    size_t group_mask = map->capacity / HASHMAP_FLAT_GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+    int8_t tag = hashmap_flat_tag(hash);
+
+    // Triangular probing visits every group exactly once
+    for (size_t step = 1; step <= group_mask + 1; step++) {
+        const int8_t *ctrl = map->ctrl + group * HASHMAP_FLAT_GROUP_WIDTH;
+        uint32_t match = hashmap_flat_match(ctrl, tag);
+        while (match) {
+            size_t index = group * HASHMAP_FLAT_GROUP_WIDTH + hashmap_flat_ctz(match);
+            const hashmap_flat_slot_t *slot = &map->slots[index];
+            if (slot->hash == hash && slot->key_size == key_size &&
+                hashmap_key_equal(hashmap_flat_slot_key(slot), key, key_size)) {
+                return index;
+            }
+            match &= match - 1;
+        }
+        if (hashmap_flat_match(ctrl, HASHMAP_FLAT_CTRL_EMPTY)) {
+            return SIZE_MAX;
+        }
+        group = (group + step) & group_mask;
+    }
+
+    return SIZE_MAX;
+}
+
+// First EMPTY or DELETED slot on the probe sequence of hash in a control
+// array of capacity bytes (internal function)
+static inline size_t hashmap_flat_probe_free(const int8_t *ctrl, size_t capacity, size_t hash) {
+    size_t group_mask = capacity / HASHMAP_FLAT_GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+
+    for (size_t step = 1;; step++) {
+        uint32_t free_mask = hashmap_flat_match_free(ctrl + group * HASHMAP_FLAT_GROUP_WIDTH);
+        if (free_mask) {
+            return group * HASHMAP_FLAT_GROUP_WIDTH + hashmap_flat_ctz(free_mask);
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+// First EMPTY or DELETED slot on the probe sequence of hash (internal function)
+static inline size_t hashmap_flat_find_free(const hashmap_flat_t *map, size_t hash) {
+    return hashmap_flat_probe_free(map->ctrl, map->capacity, hash);
+}
+
+// Allocate a control or slot array under the map's table policy; slots are
+// never read before their control byte is set, so they need no zeroing
+// (internal function)
+static inline void *hashmap_flat_table_alloc(const hashmap_flat_t *map, size_t bytes) {
+    if (hashmap_table_mapped(&map->table_memory, bytes)) {
+        return hashmap_table_map(&map->table_memory, bytes);
+    }
+    return hashmap_mem_alloc(&map->allocator, bytes);
+}
+
+static inline void hashmap_flat_table_free(const hashmap_flat_t *map, void *ptr, size_t bytes) {
+    if (hashmap_table_mapped(&map->table_memory, bytes)) {
+        hashmap_table_unmap(&map->table_memory, ptr, bytes);
+    } else {
+        hashmap_mem_free(&map->allocator, ptr, bytes);
+    }
+}
+
+// Allocate both arrays for capacity slots, with every control byte EMPTY (internal function)
+static inline bool hashmap_flat_tables_alloc(const hashmap_flat_t *map, size_t capacity,
+                                             int8_t **ctrl, hashmap_flat_slot_t **slots) {
+    if (capacity > SIZE_MAX / sizeof(hashmap_flat_slot_t)) {
+        return false;
+    }
+    *ctrl = (int8_t *)hashmap_flat_table_alloc(map, capacity);
+    *slots = (hashmap_flat_slot_t *)hashmap_flat_table_alloc(map, capacity * sizeof(hashmap_flat_slot_t));
+    if (!*ctrl || !*slots) {
+        hashmap_flat_table_free(map, *ctrl, capacity);
+        hashmap_flat_table_free(map, *slots, capacity * sizeof(hashmap_flat_slot_t));
+        return false;
+    }
+    memset(*ctrl, (unsigned char)HASHMAP_FLAT_CTRL_EMPTY, capacity);
+    return true;
+}
+
+// Release both arrays of a capacity-slot table (internal function)
+static inline void hashmap_flat_tables_free(const hashmap_flat_t *map, size_t capacity,
+                                            int8_t *ctrl, hashmap_flat_slot_t *slots) {
+    hashmap_flat_table_free(map, ctrl, capacity);
+    hashmap_flat_table_free(map, slots, capacity * sizeof(hashmap_flat_slot_t));
+}
+
+// Rebuild the table with new_capacity slots, dropping tombstones (internal function)
+static inline bool hashmap_flat_resize(hashmap_flat_t *map, size_t new_capacity) {
+    int8_t *new_ctrl;
+    hashmap_flat_slot_t *new_slots;
+    if (!hashmap_flat_tables_alloc(map, new_capacity, &new_ctrl, &new_slots)) {
+        return false;
+    }
+
+    int8_t *old_ctrl = map->ctrl;
+    hashmap_flat_slot_t *old_slots = map->slots;
+    size_t old_capacity = map->capacity;
+
+    map->ctrl = new_ctrl;
+    map->slots = new_slots;
+    map->capacity = new_capacity;
+
+    // Reinsert using the stored hash; keys are moved, never rehashed
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] < 0) {
+            continue;
+        }
+        size_t index = hashmap_flat_find_free(map, old_slots[i].hash);
+        map->ctrl[index] = old_ctrl[i];
+        map->slots[index] = old_slots[i];
+    }
+
+    map->growth_left = hashmap_flat_max_load(map, new_capacity) - map->size;
+
+    hashmap_flat_tables_free(map, old_capacity, old_ctrl, old_slots);
+    return true;
+}
+
+// Create a new open-addressing hashmap from an options struct. Uses
+// initial_capacity, value_free, hash_func, allocator, max_load_factor,
+// growth_factor and table_memory; the chained-engine modes (entry_pool,
+// incremental and deferred resize, value_size, cache_capacity, expiry) are
+// ignored.
+static inline hashmap_flat_t *hashmap_flat_create_ex(const hashmap_options_t *options) {
+    hashmap_options_t defaults = {0};
+    if (!options) {
+        options = &defaults;
+    }
+
+    size_t initial_capacity = options->initial_capacity;
+    if (initial_capacity == 0) {
+        initial_capacity = HASHMAP_DEFAULT_CAPACITY;
+    }
+
+    hashmap_flat_t *map = (hashmap_flat_t *)hashmap_mem_alloc(&options->allocator, sizeof(hashmap_flat_t));
+    if (!map) {
+        return NULL;
+    }
+    map->allocator = options->allocator;
+
+    map->max_load_factor = hashmap_options_load_factor(options, HASHMAP_FLAT_MAX_LOAD_FACTOR);
+    if (map->max_load_factor > HASHMAP_FLAT_MAX_LOAD_FACTOR) {
+        map->max_load_factor = HASHMAP_FLAT_MAX_LOAD_FACTOR;
+    }
+    map->growth_shift = hashmap_options_growth_shift(options);
+
+    map->table_memory = options->table_memory;
+
+    map->capacity = hashmap_flat_round_capacity(initial_capacity);
+    if (!hashmap_flat_tables_alloc(map, map->capacity, &map->ctrl, &map->slots)) {
+        hashmap_mem_free(&map->allocator, map, sizeof(hashmap_flat_t));
+        return NULL;
+    }
+
+    map->size = 0;
+    map->growth_left = hashmap_flat_max_load(map, map->capacity);
+    map->key_free = options->key_free;  // Not used, but kept for API compatibility
+    map->value_free = options->value_free;
+    map->hash_func = options->hash_func;
+
+    return map;
+}
+
+// Create a new open-addressing hashmap
+static inline hashmap_flat_t *hashmap_flat_create(
+    size_t initial_capacity,
+    key_free_func_t key_free,
+    value_free_func_t value_free
+) {
+    hashmap_options_t options = {0};
+    options.initial_capacity = initial_capacity;
+    options.key_free = key_free;
+    options.value_free = value_free;
+    return hashmap_flat_create_ex(&options);
+}
+
+// Clear all entries from the hashmap
+static inline void hashmap_flat_clear(hashmap_flat_t *map) {
+    if (!map) {
+        return;
+    }
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->ctrl[i] < 0) {
+            continue;
+        }
+        hashmap_flat_slot_t *slot = &map->slots[i];
+
+        // Free the copied key
+        if (slot->key_size > HASHMAP_FLAT_INLINE_KEY_SIZE) {
+            hashmap_mem_free(&map->allocator, slot->key.ptr, slot->key_size);
+        }
+
+        // Free value if needed
+        if (map->value_free) {
+            map->value_free(slot->value);
+        }
+    }
+    memset(map->ctrl, (unsigned char)HASHMAP_FLAT_CTRL_EMPTY, map->capacity);
+
+    map->size = 0;
+    map->growth_left = hashmap_flat_max_load(map, map->capacity);
+}
+
+// Destroy the hashmap and free all resources
+static inline void hashmap_flat_destroy(hashmap_flat_t *map) {
+    if (!map) {
+        return;
+    }
+
+    hashmap_flat_clear(map);
+    hashmap_flat_tables_free(map, map->capacity, map->ctrl, map->slots);
+    hashmap_mem_free(&map->allocator, map, sizeof(hashmap_flat_t));
+}
+
+// Find key's slot, or fill a free one with value; SIZE_MAX on allocation
+// failure. *inserted tells which happened (internal function)
+static inline size_t hashmap_flat_find_or_insert(hashmap_flat_t *map, const void *key, size_t key_size,
+                                                 size_t hash, void *value, bool *inserted) {
+    // Check if key already exists
+    size_t index = hashmap_flat_find(map, key, key_size, hash);
+    if (index != SIZE_MAX) {
+        *inserted = false;
+        return index;
+    }
+
+    index = hashmap_flat_find_free(map, hash);
+    if (map->ctrl[index] == HASHMAP_FLAT_CTRL_EMPTY && map->growth_left == 0) {
+        // Grow when genuinely full; otherwise just purge tombstones in place
+        size_t new_capacity = map->capacity;
+        if (map->size >= hashmap_flat_max_load(map, map->capacity) / 2) {
+            if (map->capacity > (SIZE_MAX >> map->growth_shift) / sizeof(hashmap_flat_slot_t)) {
+                return SIZE_MAX;
+            }
+            new_capacity = map->capacity << map->growth_shift;
+        }
+        if (!hashmap_flat_resize(map, new_capacity)) {
+            return SIZE_MAX;
+        }
+        index = hashmap_flat_find_free(map, hash);
+    }
+
+    // Fill the slot and copy the key
+    hashmap_flat_slot_t *slot = &map->slots[index];
+    if (key_size > HASHMAP_FLAT_INLINE_KEY_SIZE) {
+        slot->key.ptr = hashmap_mem_alloc(&map->allocator, key_size);
+        if (!slot->key.ptr) {
+            return SIZE_MAX;
+        }
+        memcpy(slot->key.ptr, key, key_size);
+    } else {
+        memcpy(slot->key.bytes, key, key_size);
+    }
+    slot->hash = hash;
+    slot->key_size = key_size;
+    slot->value = value;
+
+    if (map->ctrl[index] == HASHMAP_FLAT_CTRL_EMPTY) {
+        map->growth_left--;
+    }
+    map->ctrl[index] = hashmap_flat_tag(hash);
+    map->size++;
+
+    *inserted = true;
+    return index;
+}
+
+// Insert or update a key whose table hash is already known (internal function)
+static inline bool hashmap_flat_put_hashed(hashmap_flat_t *map, const void *key, size_t key_size,
+                                           size_t hash, void *value) {
+    bool inserted;
+    size_t index = hashmap_flat_find_or_insert(map, key, key_size, hash, value, &inserted);
+    if (index == SIZE_MAX) {
+        return false;
+    }
+    if (!inserted) {
+        hashmap_flat_slot_t *slot = &map->slots[index];
+        // Update existing entry
+        if (map->value_free && slot->value != value) {
+            map->value_free(slot->value);
+        }
+        slot->value = value;
+    }
+    return true;
+}
+
+// Insert or update a key-value pair
+static inline bool hashmap_flat_put(hashmap_flat_t *map, const void *key, size_t key_size, void *value) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    return hashmap_flat_put_hashed(map, key, key_size, hash, value);
+}
+
+// Get the value associated with a key
+static inline void *hashmap_flat_get(const hashmap_flat_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    size_t index = hashmap_flat_find(map, key, key_size, hash);
+
+    return index != SIZE_MAX ? map->slots[index].value : NULL;
+}
+
+// Remove a key-value pair
+static inline bool hashmap_flat_remove(hashmap_flat_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    size_t index = hashmap_flat_find(map, key, key_size, hash);
+    if (index == SIZE_MAX) {
+        return false;
+    }
+
+    hashmap_flat_slot_t *slot = &map->slots[index];
+
+    // Free the copied key
+    if (slot->key_size > HASHMAP_FLAT_INLINE_KEY_SIZE) {
+        hashmap_mem_free(&map->allocator, slot->key.ptr, slot->key_size);
+    }
+
+    // Free value if needed
+    if (map->value_free) {
+        map->value_free(slot->value);
+    }
+
+    if (hashmap_flat_release_ctrl(map->ctrl, index)) {
+        map->growth_left++;
+    }
+    map->size--;
+
+    return true;
+}
+
+// Check if a key exists in the hashmap
+static inline bool hashmap_flat_contains(const hashmap_flat_t *map, const void *key, size_t key_size) {
+    return hashmap_flat_get(map, key, key_size) != NULL;
+}
+
+// Get the number of key-value pairs in the hashmap
+static inline size_t hashmap_flat_size(const hashmap_flat_t *map) {
+    return map ? map->size : 0;
+}
+
+// Check if the hashmap is empty
+static inline bool hashmap_flat_is_empty(const hashmap_flat_t *map) {
+    return map ? map->size == 0 : true;
+}
+
+// Smallest slot count that holds n_entries at the map's load factor (internal function)
+static inline size_t hashmap_flat_capacity_for(const hashmap_flat_t *map, size_t n_entries) {
+    size_t capacity = hashmap_capacity_for_load(n_entries, map->max_load_factor);
+    if (capacity == SIZE_MAX) {
+        return SIZE_MAX;
+    }
+    capacity = hashmap_flat_round_capacity(capacity);
+    while (hashmap_flat_max_load(map, capacity) < n_entries) {
+        if (capacity > SIZE_MAX / 2) {
+            return SIZE_MAX;
+        }
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+// Grow the slot array once so n_entries fit without further rehashes
+static inline bool hashmap_flat_reserve(hashmap_flat_t *map, size_t n_entries) {
+    if (!map) {
+        return false;
+    }
+
+    size_t required = hashmap_flat_capacity_for(map, n_entries);
+    if (required == SIZE_MAX) {
+        return false;
+    }
+    if (required <= map->capacity) {
+        return true;
+    }
+    return hashmap_flat_resize(map, required);
+}
+
+// Shrink the slot array to the smallest size that fits the current entries
+static inline bool hashmap_flat_shrink_to_fit(hashmap_flat_t *map) {
+    if (!map) {
+        return false;
+    }
+
+    size_t target = hashmap_flat_capacity_for(map, map->size);
+    if (target >= map->capacity) {
+        return true;
+    }
+    return hashmap_flat_resize(map, target);
+}
+
+// Table hash of a key for the *_with_hash functions (see hashmap_hash)
+static inline size_t hashmap_flat_hash(const hashmap_flat_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return 0;
+    }
+    return hashmap_hash_key(map->hash_func, key, key_size);
+}
+
+// hashmap_flat_put with a precomputed hash
+static inline bool hashmap_flat_put_with_hash(hashmap_flat_t *map, const void *key, size_t key_size,
+                                              size_t hash, void *value) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+    return hashmap_flat_put_hashed(map, key, key_size, hash, value);
+}
+
+// hashmap_flat_get with a precomputed hash
+static inline void *hashmap_flat_get_with_hash(const hashmap_flat_t *map, const void *key, size_t key_size,
+                                               size_t hash) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+    size_t index = hashmap_flat_find(map, key, key_size, hash);
+    return index != SIZE_MAX ? map->slots[index].value : NULL;
+}
+
+// Return the value slot for key (the stored void *, so convert it to void **),
+// inserting it with a NULL value when missing; same signature as
+// hashmap_get_or_insert. Slots move when the table rehashes, so the pointer
+// is valid only until the next insert; NULL on failure.
+static inline void *hashmap_flat_get_or_insert(hashmap_flat_t *map, const void *key, size_t key_size,
+                                               bool *inserted) {
+    bool added = false;
+    if (inserted) {
+        *inserted = false;
+    }
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    size_t index = hashmap_flat_find_or_insert(map, key, key_size, hash, NULL, &added);
+    if (index == SIZE_MAX) {
+        return NULL;
+    }
+    if (inserted) {
+        *inserted = added;
+    }
+    return &map->slots[index].value;
+}
+
+// Iterator over a flat map's slots; initialize with hashmap_flat_iter_init.
+// The map must not be modified while an iterator is in use.
+typedef struct hashmap_flat_iter {
+    const hashmap_flat_t *map;      // NULL once exhausted
+    size_t group;                   // Next group to load
+    size_t base;                    // First slot of the loaded group
+    uint32_t full;                  // Unvisited full slots of the loaded group
+} hashmap_flat_iter_t;
+
+// Bitmask of full group positions (internal function)
+static inline uint32_t hashmap_flat_match_full(const int8_t *group) {
+    return ~hashmap_flat_match_free(group) & ((1u << HASHMAP_FLAT_GROUP_WIDTH) - 1);
+}
+
+// Start iterating over map
+static inline void hashmap_flat_iter_init(hashmap_flat_iter_t *iter, const hashmap_flat_t *map) {
+    iter->map = map;
+    iter->group = 0;
+    iter->base = 0;
+    iter->full = 0;
+}
+
+// Advance to the next entry in slot order; false when there are no more. Any
+// output pointer may be NULL.
+static inline bool hashmap_flat_iter_next(hashmap_flat_iter_t *iter, const void **key, size_t *key_size, void **value) {
+    if (!iter || !iter->map) {
+        return false;
+    }
+
+    const hashmap_flat_t *map = iter->map;
+    size_t groups = map->capacity / HASHMAP_FLAT_GROUP_WIDTH;
+    while (!iter->full) {
+        if (iter->group >= groups) {
+            iter->map = NULL;
+            return false;
+        }
+        iter->base = iter->group * HASHMAP_FLAT_GROUP_WIDTH;
+        iter->full = hashmap_flat_match_full(map->ctrl + iter->base);
+        iter->group++;
+    }
+
+    const hashmap_flat_slot_t *slot = &map->slots[iter->base + hashmap_flat_ctz(iter->full)];
+    iter->full &= iter->full - 1;
+    if (key) {
+        *key = hashmap_flat_slot_key(slot);
+    }
+    if (key_size) {
+        *key_size = slot->key_size;
+    }
+    if (value) {
+        *value = slot->value;
+    }
+    return true;
+}
+
+// Call visit for every entry until it returns false; returns the number of
+// entries visited. Slots are read in address order. visit must not modify the map.
+static inline size_t hashmap_flat_foreach(const hashmap_flat_t *map, hashmap_visit_func_t visit, void *ctx) {
+    if (!map || !visit) {
+        return 0;
+    }
+
+    size_t visited = 0;
+    for (size_t base = 0; base < map->capacity; base += HASHMAP_FLAT_GROUP_WIDTH) {
+        uint32_t full = hashmap_flat_match_full(map->ctrl + base);
+        while (full) {
+            const hashmap_flat_slot_t *slot = &map->slots[base + hashmap_flat_ctz(full)];
+            full &= full - 1;
+            visited++;
+            if (!visit(hashmap_flat_slot_key(slot), slot->key_size, slot->value, ctx)) {
+                return visited;
+            }
+        }
+    }
+    return visited;
+}
+
+#endif // HASHMAP_FLAT_H
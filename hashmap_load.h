@@ -0,0 +1,232 @@
+#ifndef HASHMAP_LOAD_H
+#define HASHMAP_LOAD_H
+
+#include "hashmap.h"
+
+#include <stdio.h>
+#include <time.h>
+
+// Streaming bulk loader
+//
+// Ingests a row file into a hashmap_t without holding the file in memory.
+// The file is read in chunks of HASHMAP_LOAD_CHUNK_BYTES into one buffer. The
+// keys and values of every complete row in a chunk are referenced in place
+// and inserted through hashmap_put_batch, which copies them into the
+// entries. The chunk buffer is therefore the only staging memory: rows need
+// no allocation of their own, and with options.entry_pool the entries
+// themselves come from slabs. The header's row count pre-sizes the table, so
+// the load never rehashes.
+//
+// Row file layout (native byte order, no padding):
+//
+//   header   magic "HMAPROWS", version, byte order, row count, value size
+//   rows     uint32_t key_size, key bytes, value_size value bytes
+//
+// Rows may be sorted or split across several partition files; each file is
+// loaded with its own call. hashmap_rows_write_header/_row produce the format.
+//
+// Values are copied, so files with a non-zero value size load into maps
+// created with the same value_size. Files with value size 0 carry keys only
+// and load into pointer-mode maps without value_free; every key gets the
+// non-NULL marker hashmap_rows_present(), so hashmap_contains finds it.
+
+#define HASHMAP_ROWS_MAGIC "HMAPROWS"
+#define HASHMAP_ROWS_VERSION 1
+#define HASHMAP_ROWS_BYTE_ORDER 0x0102030405060708ULL  // Reads back differently on foreign endianness
+#define HASHMAP_LOAD_CHUNK_BYTES (1 << 20)             // Read size; grows to fit a larger row
+#define HASHMAP_LOAD_BATCH 256                         // Rows handed to hashmap_put_batch at once
+
+// Row file header (internal structure)
+typedef struct hashmap_rows_header {
+    char magic[8];                  // HASHMAP_ROWS_MAGIC, not NUL-terminated
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t byte_order;            // HASHMAP_ROWS_BYTE_ORDER as written
+    uint64_t count;                 // Number of rows that follow
+    uint64_t value_size;            // Bytes of value after each key
+} hashmap_rows_header_t;
+
+// Load statistics, filled in by hashmap_load_stream/hashmap_load_file
+typedef struct hashmap_load_stats {
+    size_t rows;                    // Rows stored, duplicate keys included
+    uint64_t bytes;                 // Bytes read, header included
+    double seconds;                 // Wall-clock time of the load
+} hashmap_load_stats_t;
+
+// Write a row file header for count rows of value_size-byte values
+static inline bool hashmap_rows_write_header(FILE *file, uint64_t count, size_t value_size) {
+    if (!file) {
+        return false;
+    }
+    hashmap_rows_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HASHMAP_ROWS_MAGIC, sizeof(header.magic));
+    header.version = HASHMAP_ROWS_VERSION;
+    header.byte_order = HASHMAP_ROWS_BYTE_ORDER;
+    header.count = count;
+    header.value_size = value_size;
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+// Value stored for the keys of a keys-only file. Never freed; compare against
+// it within one translation unit only, as each has its own copy
+static inline void *hashmap_rows_present(void) {
+    static const char present = 1;
+    return (void *)&present;
+}
+
+// Append one row; value must hold the value_size given in the header
+static inline bool hashmap_rows_write_row(FILE *file, const void *key, size_t key_size,
+                                          const void *value, size_t value_size) {
+    if (!file || !key || key_size == 0 || key_size > UINT32_MAX || (value_size && !value)) {
+        return false;
+    }
+    uint32_t size = (uint32_t)key_size;
+    return fwrite(&size, sizeof(size), 1, file) == 1 &&
+           fwrite(key, 1, key_size, file) == key_size &&
+           (value_size == 0 || fwrite(value, 1, value_size, file) == value_size);
+}
+
+// Seconds on hashmap_clock_read's clock (internal function)
+static inline double hashmap_load_now(void) {
+    struct timespec ts = hashmap_clock_read();
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Insert the first n staged rows (internal function)
+static inline bool hashmap_load_flush(hashmap_t *map, const void **keys, const size_t *key_sizes,
+                                      void **values, size_t n) {
+    return n == 0 || hashmap_put_batch(map, keys, key_sizes, values, n);
+}
+
+// Load every row of an open row file into map, reading it in chunks. Stops at
+// the first malformed, truncated or unstorable row and returns false; rows
+// loaded before that stay in the map. stats may be NULL.
+static inline bool hashmap_load_stream(hashmap_t *map, FILE *file, hashmap_load_stats_t *stats) {
+    hashmap_load_stats_t local = {0};
+    double start = hashmap_load_now();
+    if (!stats) {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!map || !file) {
+        return false;
+    }
+
+    hashmap_rows_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, HASHMAP_ROWS_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != HASHMAP_ROWS_VERSION || header.byte_order != HASHMAP_ROWS_BYTE_ORDER ||
+        header.value_size != map->value_size || (header.value_size == 0 && map->value_free)) {
+        return false;
+    }
+    stats->bytes = sizeof(header);
+
+    // Size the table once for everything the file will add
+    if (header.count > SIZE_MAX - map->size || !hashmap_reserve(map, map->size + (size_t)header.count)) {
+        return false;
+    }
+
+    size_t value_size = map->value_size;
+    size_t capacity = HASHMAP_LOAD_CHUNK_BYTES;
+    unsigned char *buffer = (unsigned char *)malloc(capacity);
+    if (!buffer) {
+        return false;
+    }
+
+    const void *keys[HASHMAP_LOAD_BATCH];
+    size_t key_sizes[HASHMAP_LOAD_BATCH];
+    void *values[HASHMAP_LOAD_BATCH];
+    size_t staged = 0;
+    size_t filled = 0;             // Valid bytes in buffer
+    uint64_t remaining = header.count;
+    bool ok = true;
+
+    while (ok && remaining > 0) {
+        size_t got = fread(buffer + filled, 1, capacity - filled, file);
+        stats->bytes += got;
+        filled += got;
+
+        // Stage every complete row in the buffer
+        size_t pos = 0;
+        while (remaining > 0 && filled - pos >= sizeof(uint32_t)) {
+            uint32_t key_size;
+            memcpy(&key_size, buffer + pos, sizeof(key_size));
+            size_t row_bytes = sizeof(uint32_t) + (size_t)key_size + value_size;
+            if (key_size == 0) {
+                ok = false;
+                break;
+            }
+            if (filled - pos < row_bytes) {
+                break;
+            }
+            keys[staged] = buffer + pos + sizeof(uint32_t);
+            key_sizes[staged] = key_size;
+            values[staged] = value_size ? buffer + pos + sizeof(uint32_t) + key_size : hashmap_rows_present();
+            pos += row_bytes;
+            remaining--;
+            if (++staged == HASHMAP_LOAD_BATCH) {
+                ok = hashmap_load_flush(map, keys, key_sizes, values, staged);
+                if (!ok) {
+                    break;
+                }
+                stats->rows += staged;
+                staged = 0;
+            }
+        }
+
+        // Rows still point into the buffer, so insert them before it is reused
+        if (ok) {
+            ok = hashmap_load_flush(map, keys, key_sizes, values, staged);
+            if (ok) {
+                stats->rows += staged;
+            }
+            staged = 0;
+        }
+        if (!ok || remaining == 0) {
+            break;
+        }
+        if (got == 0) {
+            ok = false;             // Truncated: fewer rows than the header promised
+            break;
+        }
+
+        // Carry the partial row to the front, growing the buffer if one row
+        // is larger than a whole chunk
+        memmove(buffer, buffer + pos, filled - pos);
+        filled -= pos;
+        if (filled == capacity) {
+            unsigned char *grown = capacity <= SIZE_MAX / 2 ? (unsigned char *)realloc(buffer, capacity * 2) : NULL;
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+    }
+
+    free(buffer);
+    stats->seconds = hashmap_load_now() - start;
+    return ok;
+}
+
+// Open path and load it with hashmap_load_stream
+static inline bool hashmap_load_file(hashmap_t *map, const char *path, hashmap_load_stats_t *stats) {
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+    if (!map || !path) {
+        return false;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    bool ok = hashmap_load_stream(map, file, stats);
+    fclose(file);
+    return ok;
+}
+
+#endif // HASHMAP_LOAD_H
@@ -0,0 +1,378 @@
+#ifndef HASHMAP_MAPPED_H
+#define HASHMAP_MAPPED_H
+
+#include "hashmap.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Memory-mapped snapshots
+//
+// hashmap_save writes a value_size map to a file. hashmap_open_mapped maps
+// that file read-only and answers lookups straight from the mapping, so
+// opening costs one mmap however many entries the snapshot holds. Pages are
+// faulted in by the lookups that touch them.
+//
+// The layout uses file offsets instead of pointers, so it can be mapped at any
+// address:
+//
+//   header                  magic, version, sizes and region offsets
+//   bucket_starts[cap + 1]  bucket b owns records [starts[b], starts[b + 1])
+//   records[count]          hash, key offset, key size, value offset
+//   data                    each key followed by its aligned value
+//
+// Records are grouped by bucket (hash & (cap - 1)), so a lookup reads two
+// bucket bounds and scans a short contiguous run of records. Snapshots store
+// the built-in hash and native byte order and word size. A file written
+// elsewhere is rejected at open time rather than misread.
+//
+// Requires POSIX (mmap). Saving needs a map created with value_size. Pointer
+// values cannot outlive the process, and a custom hash_func cannot be
+// recorded in the file.
+
+#define HASHMAP_SNAPSHOT_MAGIC "HMAPSNAP"
+#define HASHMAP_SNAPSHOT_VERSION 1
+#define HASHMAP_SNAPSHOT_BYTE_ORDER 0x0102030405060708ULL  // Reads back differently on foreign endianness
+#define HASHMAP_SNAPSHOT_DATA_ALIGN 64                        // Alignment of the key/value region
+#define HASHMAP_SNAPSHOT_WRITE_BUFFER (1 << 20)               // stdio buffer used while saving
+
+// File header (internal structure)
+typedef struct hashmap_snapshot_header {
+    char magic[8];                  // HASHMAP_SNAPSHOT_MAGIC, not NUL-terminated
+    uint32_t version;
+    uint32_t word_size;             // sizeof(size_t) of the writer; hashes are that wide
+    uint64_t byte_order;            // HASHMAP_SNAPSHOT_BYTE_ORDER as written
+    uint64_t capacity;              // Bucket count, a power of two
+    uint64_t count;                 // Number of records
+    uint64_t value_size;
+    uint64_t value_align;
+    uint64_t buckets_offset;
+    uint64_t records_offset;
+    uint64_t data_offset;
+    uint64_t file_size;
+} hashmap_snapshot_header_t;
+
+// One entry; offsets are from the start of the file (internal structure)
+typedef struct hashmap_snapshot_record {
+    uint64_t hash;
+    uint64_t key_offset;
+    uint64_t key_size;
+    uint64_t value_offset;
+} hashmap_snapshot_record_t;
+
+// Read-only hashmap served from a mapped snapshot
+typedef struct hashmap_mapped {
+    const unsigned char *base;      // Start of the mapping
+    size_t length;                  // Mapped bytes (the whole file)
+    const uint64_t *bucket_starts;
+    const hashmap_snapshot_record_t *records;
+    size_t capacity;
+    size_t size;
+    size_t value_size;
+} hashmap_mapped_t;
+
+// Round offset up to a power-of-two alignment (internal function)
+static inline uint64_t hashmap_snapshot_align(uint64_t offset, uint64_t align) {
+    return (offset + align - 1) & ~(align - 1);
+}
+
+// Write n zero bytes (internal function)
+static inline bool hashmap_snapshot_pad(FILE *file, uint64_t n) {
+    static const unsigned char zeros[HASHMAP_SNAPSHOT_DATA_ALIGN] = {0};
+    while (n > 0) {
+        size_t chunk = n < sizeof(zeros) ? (size_t)n : sizeof(zeros);
+        if (fwrite(zeros, 1, chunk, file) != chunk) {
+            return false;
+        }
+        n -= chunk;
+    }
+    return true;
+}
+
+// Whether an entry goes into the snapshot: expired entries are left out.
+// Every pass uses the same now, so they all skip the same entries (internal function)
+static inline bool hashmap_snapshot_live(const hashmap_t *map, const hashmap_entry_t *entry, uint64_t now) {
+    if (!map->expiry) {
+        return true;
+    }
+    uint64_t deadline = hashmap_entry_deadline(map, entry);
+    return deadline == HASHMAP_TTL_NEVER || deadline > now;
+}
+
+// Write the bucket bounds, records and data regions; entries are visited in
+// the same bucket order by every pass, so the offsets line up (internal function)
+static inline bool hashmap_snapshot_write_body(FILE *file, const hashmap_t *map,
+                                               const hashmap_snapshot_header_t *header, uint64_t now) {
+    uint64_t start = 0;
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (fwrite(&start, sizeof(start), 1, file) != 1) {
+            return false;
+        }
+        for (const hashmap_entry_t *entry = map->buckets[i]; entry; entry = entry->next) {
+            start += hashmap_snapshot_live(map, entry, now);
+        }
+    }
+    if (fwrite(&start, sizeof(start), 1, file) != 1) {
+        return false;
+    }
+
+    uint64_t offset = header->data_offset;
+    for (size_t i = 0; i < map->capacity; i++) {
+        for (const hashmap_entry_t *entry = map->buckets[i]; entry; entry = entry->next) {
+            if (!hashmap_snapshot_live(map, entry, now)) {
+                continue;
+            }
+            hashmap_snapshot_record_t record;
+            record.hash = entry->hash;
+            record.key_offset = offset;
+            record.key_size = entry->key_size;
+            record.value_offset = hashmap_snapshot_align(offset + entry->key_size, header->value_align);
+            offset = record.value_offset + header->value_size;
+            if (fwrite(&record, sizeof(record), 1, file) != 1) {
+                return false;
+            }
+        }
+    }
+
+    uint64_t position = header->records_offset + header->count * sizeof(hashmap_snapshot_record_t);
+    if (!hashmap_snapshot_pad(file, header->data_offset - position)) {
+        return false;
+    }
+    position = header->data_offset;
+    for (size_t i = 0; i < map->capacity; i++) {
+        for (const hashmap_entry_t *entry = map->buckets[i]; entry; entry = entry->next) {
+            if (!hashmap_snapshot_live(map, entry, now)) {
+                continue;
+            }
+            uint64_t value_offset = hashmap_snapshot_align(position + entry->key_size, header->value_align);
+            if (fwrite(entry->key, 1, entry->key_size, file) != entry->key_size ||
+                !hashmap_snapshot_pad(file, value_offset - (position + entry->key_size)) ||
+                fwrite(entry->value, 1, map->value_size, file) != map->value_size) {
+                return false;
+            }
+            position = value_offset + header->value_size;
+        }
+    }
+    return true;
+}
+
+// Write a snapshot of map to path for hashmap_open_mapped. The map must use
+// value_size and the built-in hash. A pending incremental migration is
+// finished first. Entries whose TTL has run out are left out, and deadlines
+// are not stored: a key the snapshot holds never expires there. The file is
+// written next to path and renamed over it, so readers never see a partial
+// snapshot.
+static inline bool hashmap_save(hashmap_t *map, const char *path) {
+    if (!map || !path || map->value_size == 0 || map->hash_func) {
+        return false;
+    }
+    hashmap_migrate_step(map, SIZE_MAX);
+    uint64_t now = map->expiry ? map->clock(map->clock_ctx) : 0;
+
+    // The record region is sized for the live entries
+    uint64_t count = map->size;
+    if (map->expiry) {
+        count = 0;
+        for (size_t i = 0; i < map->capacity; i++) {
+            for (const hashmap_entry_t *entry = map->buckets[i]; entry; entry = entry->next) {
+                count += hashmap_snapshot_live(map, entry, now);
+            }
+        }
+    }
+
+    hashmap_snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HASHMAP_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = HASHMAP_SNAPSHOT_VERSION;
+    header.word_size = (uint32_t)sizeof(size_t);
+    header.byte_order = HASHMAP_SNAPSHOT_BYTE_ORDER;
+    header.capacity = map->capacity;
+    header.count = count;
+    header.value_size = map->value_size;
+    header.value_align = map->value_align;
+    header.buckets_offset = hashmap_snapshot_align(sizeof(header), sizeof(uint64_t));
+    header.records_offset = header.buckets_offset + (header.capacity + 1) * sizeof(uint64_t);
+    header.data_offset = hashmap_snapshot_align(header.records_offset +
+                                                header.count * sizeof(hashmap_snapshot_record_t),
+                                                HASHMAP_SNAPSHOT_DATA_ALIGN);
+
+    // Size the data region with the same walk the writer uses
+    uint64_t offset = header.data_offset;
+    for (size_t i = 0; i < map->capacity; i++) {
+        for (const hashmap_entry_t *entry = map->buckets[i]; entry; entry = entry->next) {
+            if (!hashmap_snapshot_live(map, entry, now)) {
+                continue;
+            }
+            offset = hashmap_snapshot_align(offset + entry->key_size, header.value_align) + header.value_size;
+        }
+    }
+    header.file_size = offset;
+
+    size_t path_len = strlen(path);
+    char *tmp_path = (char *)malloc(path_len + sizeof(".tmp"));
+    if (!tmp_path) {
+        return false;
+    }
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", sizeof(".tmp"));
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        free(tmp_path);
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, HASHMAP_SNAPSHOT_WRITE_BUFFER);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              hashmap_snapshot_pad(file, header.buckets_offset - sizeof(header)) &&
+              hashmap_snapshot_write_body(file, map, &header, now);
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(tmp_path, path) == 0;
+    if (!ok) {
+        remove(tmp_path);
+    }
+    free(tmp_path);
+    return ok;
+}
+
+// Whether a mapped header describes a well-formed file of length bytes (internal function)
+static inline bool hashmap_snapshot_valid(const hashmap_snapshot_header_t *header, size_t length) {
+    if (memcmp(header->magic, HASHMAP_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != HASHMAP_SNAPSHOT_VERSION || header->word_size != sizeof(size_t) ||
+        header->byte_order != HASHMAP_SNAPSHOT_BYTE_ORDER || header->file_size != length) {
+        return false;
+    }
+    if (header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+        header->value_size == 0 || header->value_size > length ||
+        header->value_align == 0 || (header->value_align & (header->value_align - 1)) != 0) {
+        return false;
+    }
+    if (header->buckets_offset % sizeof(uint64_t) != 0 || header->records_offset % sizeof(uint64_t) != 0) {
+        return false;
+    }
+
+    // Every offset lies inside the file and every region fits in what follows
+    // its offset, checked by division so no size or end can wrap
+    if (header->buckets_offset < sizeof(*header) || header->buckets_offset > length ||
+        header->records_offset > length || header->data_offset > length) {
+        return false;
+    }
+    if (header->capacity >= (length - header->buckets_offset) / sizeof(uint64_t) ||
+        header->count > (length - header->records_offset) / sizeof(hashmap_snapshot_record_t)) {
+        return false;
+    }
+
+    // Regions must follow each other
+    uint64_t buckets_end = header->buckets_offset + (header->capacity + 1) * sizeof(uint64_t);
+    uint64_t records_end = header->records_offset + header->count * sizeof(hashmap_snapshot_record_t);
+    return buckets_end <= header->records_offset && records_end <= header->data_offset;
+}
+
+// Map a snapshot written by hashmap_save read-only; NULL if the file is
+// missing, truncated or was written with a different format, word size or
+// byte order
+static inline hashmap_mapped_t *hashmap_open_mapped(const char *path) {
+    if (!path) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(hashmap_snapshot_header_t) ||
+        (uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t)st.st_size;
+    void *base = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping keeps the file open
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    const hashmap_snapshot_header_t *header = (const hashmap_snapshot_header_t *)base;
+    hashmap_mapped_t *map = NULL;
+    if (hashmap_snapshot_valid(header, length)) {
+        map = (hashmap_mapped_t *)malloc(sizeof(hashmap_mapped_t));
+    }
+    if (!map) {
+        munmap(base, length);
+        return NULL;
+    }
+
+    map->base = (const unsigned char *)base;
+    map->length = length;
+    map->bucket_starts = (const uint64_t *)(map->base + header->buckets_offset);
+    map->records = (const hashmap_snapshot_record_t *)(map->base + header->records_offset);
+    map->capacity = (size_t)header->capacity;
+    map->size = (size_t)header->count;
+    map->value_size = (size_t)header->value_size;
+
+    // Lookups land on scattered pages; skip read-ahead
+#ifdef POSIX_MADV_RANDOM
+    posix_madvise(base, length, POSIX_MADV_RANDOM);
+#endif
+    return map;
+}
+
+// Unmap the snapshot; pointers returned by hashmap_mapped_get become invalid
+static inline void hashmap_mapped_close(hashmap_mapped_t *map) {
+    if (!map) {
+        return;
+    }
+    munmap((void *)map->base, map->length);
+    free(map);
+}
+
+// Pointer to the value_size bytes stored for key inside the mapping, or NULL.
+// Records that point outside the file are treated as missing.
+static inline const void *hashmap_mapped_get(const hashmap_mapped_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0 || key_size > map->length) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_generic_hash(key, key_size);
+    size_t bucket = hashmap_bucket_index(hash, map->capacity);
+    uint64_t start = map->bucket_starts[bucket];
+    uint64_t end = map->bucket_starts[bucket + 1];
+    if (start > end || end > map->size) {
+        return NULL;
+    }
+
+    for (uint64_t i = start; i < end; i++) {
+        const hashmap_snapshot_record_t *record = &map->records[i];
+        if (record->hash != hash || record->key_size != key_size) {
+            continue;
+        }
+        if (record->key_offset > map->length - key_size ||
+            record->value_offset > map->length - map->value_size) {
+            return NULL;
+        }
+        if (hashmap_key_equal(map->base + record->key_offset, key, key_size)) {
+            return map->base + record->value_offset;
+        }
+    }
+    return NULL;
+}
+
+// Check if a key exists in the snapshot
+static inline bool hashmap_mapped_contains(const hashmap_mapped_t *map, const void *key, size_t key_size) {
+    return hashmap_mapped_get(map, key, key_size) != NULL;
+}
+
+// Get the number of key-value pairs in the snapshot
+static inline size_t hashmap_mapped_size(const hashmap_mapped_t *map) {
+    return map ? map->size : 0;
+}
+
+// Size in bytes of every value in the snapshot
+static inline size_t hashmap_mapped_value_size(const hashmap_mapped_t *map) {
+    return map ? map->value_size : 0;
+}
+
+#endif // HASHMAP_MAPPED_H
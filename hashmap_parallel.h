@@ -0,0 +1,406 @@
+#ifndef HASHMAP_PARALLEL_H
+#define HASHMAP_PARALLEL_H
+
+#include "hashmap.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+// Multi-threaded bulk operations on a hashmap_t
+//
+// Each function splits the bucket array into contiguous ranges, one per
+// worker thread. Workers only touch chains in their own range, so they need
+// no locks. The calling thread counts as one of the workers. While a call is
+// running, no other thread may use the map. Requires linking with -pthread.
+//
+// Entries are allocated and freed from the workers, so custom allocator hooks
+// and value_free must be thread-safe. Inserts into a map with an entry pool
+// run on one thread, because the pool is not synchronized.
+
+#define HASHMAP_PARALLEL_MIN_WORK 16384  // Rows or buckets per additional thread
+
+// Worker thread count: requested, or one per online CPU, bounded by the work (internal function)
+static inline size_t hashmap_parallel_threads(size_t requested, size_t work) {
+    size_t threads = requested;
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    size_t useful = work / HASHMAP_PARALLEL_MIN_WORK + 1;
+    return threads < useful ? threads : useful;
+}
+
+// Run task on args[0..threads) with args[0] on the calling thread. A task
+// whose thread cannot be started runs inline instead (internal function).
+static inline void hashmap_parallel_run(size_t threads, void *(*task)(void *), void *args, size_t arg_size) {
+    pthread_t stack_ids[16];
+    pthread_t *ids = threads <= 16 ? stack_ids : (pthread_t *)malloc(threads * sizeof(pthread_t));
+    bool *started = (bool *)calloc(threads, sizeof(bool));
+
+    for (size_t i = 1; i < threads; i++) {
+        void *arg = (unsigned char *)args + i * arg_size;
+        if (ids && started && pthread_create(&ids[i], NULL, task, arg) == 0) {
+            started[i] = true;
+        } else {
+            task(arg);
+        }
+    }
+    task(args);
+    for (size_t i = 1; i < threads; i++) {
+        if (started && started[i]) {
+            pthread_join(ids[i], NULL);
+        }
+    }
+
+    free(started);
+    if (ids != stack_ids) {
+        free(ids);
+    }
+}
+
+// Bucket range [first, last) owned by worker id of threads (internal function)
+static inline void hashmap_parallel_range(size_t capacity, size_t id, size_t threads,
+                                          size_t *first, size_t *last) {
+    *first = capacity / threads * id + (id < capacity % threads ? id : capacity % threads);
+    *last = *first + capacity / threads + (id < capacity % threads ? 1 : 0);
+}
+
+// Shared state for a parallel build (internal structure)
+typedef struct hashmap_parallel_build {
+    hashmap_t *map;
+    const void *const *keys;
+    const size_t *key_sizes;
+    void *const *values;
+    size_t n;
+    size_t threads;                 // Input slices and partitions
+    size_t insert_threads;          // Workers for phase 3 (1 with an entry pool)
+    size_t chunk;                   // Buckets per partition; the last may be shorter
+    size_t *hashes;                 // Table hash per input row
+    size_t *order;                  // Row indices grouped by partition, input order within each
+    size_t *offsets;                // [slice][partition], threads x (threads + 1); last column is invalid rows
+    size_t *partition_start;        // threads + 1 boundaries into order
+} hashmap_parallel_build_t;
+
+// Per-worker state for a parallel build (internal structure)
+typedef struct hashmap_parallel_build_task {
+    hashmap_parallel_build_t *build;
+    size_t id;
+    size_t inserted;
+    bool ok;
+} hashmap_parallel_build_task_t;
+
+// Partition that owns a hash: the one whose bucket chunk holds its bucket (internal function)
+static inline size_t hashmap_parallel_partition(const hashmap_parallel_build_t *build, size_t hash) {
+    return hashmap_bucket_index(hash, build->map->capacity) / build->chunk;
+}
+
+// Phase 1: hash a slice of the input and count rows per partition (internal function)
+static inline void *hashmap_parallel_build_hash(void *arg) {
+    hashmap_parallel_build_task_t *task = (hashmap_parallel_build_task_t *)arg;
+    hashmap_parallel_build_t *build = task->build;
+    size_t first, last;
+    hashmap_parallel_range(build->n, task->id, build->threads, &first, &last);
+    size_t *counts = build->offsets + task->id * (build->threads + 1);
+
+    for (size_t row = first; row < last; row++) {
+        const void *key = build->keys[row];
+        size_t key_size = build->key_sizes[row];
+        if (!key || key_size == 0) {
+            counts[build->threads]++;
+            continue;
+        }
+        if (row + HASHMAP_BATCH_WINDOW < last && build->keys[row + HASHMAP_BATCH_WINDOW]) {
+            HASHMAP_PREFETCH(build->keys[row + HASHMAP_BATCH_WINDOW]);
+        }
+        size_t hash = hashmap_hash_key(build->map->hash_func, key, key_size);
+        build->hashes[row] = hash;
+        counts[hashmap_parallel_partition(build, hash)]++;
+    }
+    return NULL;
+}
+
+// Phase 2: scatter a slice's row indices into partition order (internal function)
+static inline void *hashmap_parallel_build_scatter(void *arg) {
+    hashmap_parallel_build_task_t *task = (hashmap_parallel_build_task_t *)arg;
+    hashmap_parallel_build_t *build = task->build;
+    size_t first, last;
+    hashmap_parallel_range(build->n, task->id, build->threads, &first, &last);
+    size_t *offsets = build->offsets + task->id * (build->threads + 1);
+
+    for (size_t row = first; row < last; row++) {
+        if (!build->keys[row] || build->key_sizes[row] == 0) {
+            continue;
+        }
+        build->order[offsets[hashmap_parallel_partition(build, build->hashes[row])]++] = row;
+    }
+    return NULL;
+}
+
+// Phase 3: insert partitions into their own bucket chunks (internal function)
+static inline void *hashmap_parallel_build_insert(void *arg) {
+    hashmap_parallel_build_task_t *task = (hashmap_parallel_build_task_t *)arg;
+    hashmap_parallel_build_t *build = task->build;
+    hashmap_t *map = build->map;
+
+    for (size_t p = task->id; p < build->threads; p += build->insert_threads) {
+        for (size_t k = build->partition_start[p]; k < build->partition_start[p + 1]; k++) {
+            size_t row = build->order[k];
+            const void *key = build->keys[row];
+            size_t key_size = build->key_sizes[row];
+            size_t hash = build->hashes[row];
+            void *value = build->values[row];
+            size_t index = hashmap_bucket_index(hash, map->capacity);
+
+            hashmap_entry_t *entry = map->buckets[index];
+            while (entry && !hashmap_entry_matches(entry, key, key_size, hash)) {
+                entry = entry->next;
+            }
+            // As with hashmap_put, a built entry has no deadline (an expired one is reused)
+            if (entry) {
+                hashmap_entry_update_value(map, entry, value);
+                if (map->expiry) {
+                    hashmap_entry_set_deadline(map, entry, HASHMAP_TTL_NEVER);
+                }
+                continue;
+            }
+
+            entry = hashmap_entry_alloc(map, key_size);
+            if (!entry) {
+                task->ok = false;
+                continue;
+            }
+            memcpy(entry->key, key, key_size);
+            entry->key_size = key_size;
+            entry->hash = hash;
+            if (map->expiry) {
+                hashmap_entry_set_deadline(map, entry, HASHMAP_TTL_NEVER);
+            }
+            hashmap_entry_init_value(map, entry, value);
+            entry->next = map->buckets[index];
+            map->buckets[index] = entry;
+            task->inserted++;
+        }
+    }
+    return NULL;
+}
+
+// Insert or update n key-value pairs using up to threads workers (0 selects
+// one per CPU). Semantics match hashmap_put_batch: later duplicates win, and
+// invalid pairs are skipped and make the call return false. The table is
+// sized for size + n up front, so no resize happens while workers run.
+static inline bool hashmap_parallel_build(hashmap_t *map, const void *const *keys, const size_t *key_sizes,
+                                          void *const *values, size_t n, size_t threads) {
+    if (!map || !keys || !key_sizes || !values) {
+        return false;
+    }
+    if (n == 0) {
+        return true;
+    }
+    // Evictions reorder the table as rows arrive, so caches insert serially
+    if (map->cache_capacity) {
+        return hashmap_put_batch(map, keys, key_sizes, values, n);
+    }
+
+    hashmap_migrate_step(map, SIZE_MAX);
+    if (n > SIZE_MAX - map->size || !hashmap_reserve(map, map->size + n)) {
+        return false;
+    }
+
+    hashmap_parallel_build_t build;
+    build.map = map;
+    build.keys = keys;
+    build.key_sizes = key_sizes;
+    build.values = values;
+    build.n = n;
+    build.threads = hashmap_parallel_threads(threads, n);
+    if (build.threads > map->capacity) {
+        build.threads = map->capacity;
+    }
+    // The entry pool is not synchronized; inserts then run on one thread
+    build.insert_threads = map->pool.slot_size ? 1 : build.threads;
+    build.chunk = (map->capacity + build.threads - 1) / build.threads;
+    if (n > SIZE_MAX / sizeof(size_t)) {
+        return false;
+    }
+    build.hashes = (size_t *)malloc(n * sizeof(size_t));
+    build.order = (size_t *)malloc(n * sizeof(size_t));
+    build.offsets = (size_t *)calloc(build.threads * (build.threads + 1), sizeof(size_t));
+    build.partition_start = (size_t *)malloc((build.threads + 1) * sizeof(size_t));
+    hashmap_parallel_build_task_t *tasks =
+        (hashmap_parallel_build_task_t *)malloc(build.threads * sizeof(hashmap_parallel_build_task_t));
+    bool ok = build.hashes && build.order && build.offsets && build.partition_start && tasks;
+
+    if (ok) {
+        for (size_t i = 0; i < build.threads; i++) {
+            tasks[i].build = &build;
+            tasks[i].id = i;
+            tasks[i].inserted = 0;
+            tasks[i].ok = true;
+        }
+        hashmap_parallel_run(build.threads, hashmap_parallel_build_hash, tasks, sizeof(*tasks));
+
+        // Turn counts into scatter offsets: partitions in order, slices in input order within each
+        size_t running = 0;
+        for (size_t p = 0; p <= build.threads; p++) {
+            build.partition_start[p] = running;
+            for (size_t s = 0; s < build.threads; s++) {
+                size_t *cell = &build.offsets[s * (build.threads + 1) + p];
+                size_t count = *cell;
+                *cell = running;
+                running += count;
+            }
+        }
+        ok = build.partition_start[build.threads] == n;  // Otherwise some rows were invalid
+
+        hashmap_parallel_run(build.threads, hashmap_parallel_build_scatter, tasks, sizeof(*tasks));
+        hashmap_parallel_run(build.insert_threads, hashmap_parallel_build_insert, tasks, sizeof(*tasks));
+
+        for (size_t i = 0; i < build.threads; i++) {
+            map->size += tasks[i].inserted;
+            ok = ok && tasks[i].ok;
+        }
+    }
+
+    free(build.hashes);
+    free(build.order);
+    free(build.offsets);
+    free(build.partition_start);
+    free(tasks);
+    return ok;
+}
+
+// Per-worker state for foreach and clear (internal structure)
+typedef struct hashmap_parallel_walk_task {
+    hashmap_t *map;
+    size_t id;
+    size_t threads;
+    hashmap_visit_func_t visit;
+    void *ctx;
+    _Atomic bool *stop;
+    size_t visited;
+} hashmap_parallel_walk_task_t;
+
+// Visit one worker's share of a bucket array (internal function)
+static inline bool hashmap_parallel_visit_range(hashmap_parallel_walk_task_t *task, hashmap_entry_t **buckets,
+                                                size_t base, size_t capacity) {
+    size_t first, last;
+    hashmap_parallel_range(capacity - base, task->id, task->threads, &first, &last);
+    for (size_t i = base + first; i < base + last; i++) {
+        for (hashmap_entry_t *entry = buckets[i]; entry; entry = entry->next) {
+            HASHMAP_PREFETCH(entry->next);
+            if (atomic_load_explicit(task->stop, memory_order_relaxed)) {
+                return false;
+            }
+            task->visited++;
+            if (!task->visit(entry->key, entry->key_size, entry->value, task->ctx)) {
+                atomic_store_explicit(task->stop, true, memory_order_relaxed);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static inline void *hashmap_parallel_foreach_task(void *arg) {
+    hashmap_parallel_walk_task_t *task = (hashmap_parallel_walk_task_t *)arg;
+    const hashmap_t *map = task->map;
+    if (hashmap_parallel_visit_range(task, map->buckets, 0, map->capacity) && map->old_buckets) {
+        hashmap_parallel_visit_range(task, map->old_buckets, map->migrate_index, map->old_capacity);
+    }
+    return NULL;
+}
+
+// Call visit for every entry from up to threads workers (0 selects one per
+// CPU). visit runs concurrently and must be thread-safe; returning false stops
+// all workers soon after. Returns the number of entries visited.
+static inline size_t hashmap_parallel_foreach(const hashmap_t *map, hashmap_visit_func_t visit, void *ctx,
+                                              size_t threads) {
+    if (!map || !visit) {
+        return 0;
+    }
+
+    threads = hashmap_parallel_threads(threads, map->capacity);
+    hashmap_parallel_walk_task_t *tasks =
+        (hashmap_parallel_walk_task_t *)malloc(threads * sizeof(hashmap_parallel_walk_task_t));
+    if (!tasks) {
+        return hashmap_foreach(map, visit, ctx);
+    }
+
+    _Atomic bool stop = false;
+    for (size_t i = 0; i < threads; i++) {
+        tasks[i] = (hashmap_parallel_walk_task_t){(hashmap_t *)map, i, threads, visit, ctx, &stop, 0};
+    }
+    hashmap_parallel_run(threads, hashmap_parallel_foreach_task, tasks, sizeof(*tasks));
+
+    size_t visited = 0;
+    for (size_t i = 0; i < threads; i++) {
+        visited += tasks[i].visited;
+    }
+    free(tasks);
+    return visited;
+}
+
+// Free one worker's share of the chains (internal function)
+static inline void *hashmap_parallel_clear_task(void *arg) {
+    hashmap_parallel_walk_task_t *task = (hashmap_parallel_walk_task_t *)arg;
+    hashmap_t *map = task->map;
+    size_t first, last;
+    hashmap_parallel_range(map->capacity, task->id, task->threads, &first, &last);
+
+    for (size_t i = first; i < last; i++) {
+        hashmap_entry_t *entry = map->buckets[i];
+        while (entry) {
+            hashmap_entry_t *next = entry->next;
+            if (map->value_free) {
+                map->value_free(entry->value);
+            }
+            // Pooled entries are released in bulk by the caller
+            if (!hashmap_entry_pooled(map, entry->key_size)) {
+                HASHMAP_STAT_FREE(map, hashmap_entry_bytes(map, entry->key_size));
+                hashmap_mem_free(&map->allocator, entry, hashmap_entry_bytes(map, entry->key_size));
+            }
+            entry = next;
+        }
+        map->buckets[i] = NULL;
+    }
+    return NULL;
+}
+
+// Clear all entries, freeing entries and calling value_free from up to
+// threads workers (0 selects one per CPU)
+static inline void hashmap_parallel_clear(hashmap_t *map, size_t threads) {
+    if (!map) {
+        return;
+    }
+
+    hashmap_migrate_step(map, SIZE_MAX);
+    threads = hashmap_parallel_threads(threads, map->capacity);
+    hashmap_parallel_walk_task_t *tasks =
+        (hashmap_parallel_walk_task_t *)malloc(threads * sizeof(hashmap_parallel_walk_task_t));
+    if (!tasks) {
+        hashmap_clear(map);
+        return;
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        tasks[i] = (hashmap_parallel_walk_task_t){map, i, threads, NULL, NULL, NULL, 0};
+    }
+    hashmap_parallel_run(threads, hashmap_parallel_clear_task, tasks, sizeof(*tasks));
+    free(tasks);
+
+    hashmap_pool_release(map);
+    map->size = 0;
+}
+
+// Destroy the hashmap, freeing entries from up to threads workers
+static inline void hashmap_parallel_destroy(hashmap_t *map, size_t threads) {
+    if (!map) {
+        return;
+    }
+
+    hashmap_parallel_clear(map, threads);
+    hashmap_destroy(map);
+}
+
+#endif // HASHMAP_PARALLEL_H
@@ -0,0 +1,480 @@
+#ifndef HASHMAP_RCU_H
+#define HASHMAP_RCU_H
+
+#include "hashmap.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sched.h>
+
+// Read-mostly hashmap with a lock-free read path
+//
+// Readers never take a lock: buckets and chain links are atomic pointers, and
+// a published entry is immutable. Writers serialize on a mutex and never
+// modify an entry a reader may be traversing. Updates and removals unlink the
+// old entry and put it on a retire list, and a resize copies every entry into
+// a fresh table before publishing it. Retired memory is freed only after a
+// grace period: every reader that could still see it has left its read
+// section.
+//
+// Grace periods use an epoch counter with two sets of reader counters, one
+// per epoch parity. Each set is striped across cache lines so that readers on
+// different threads do not contend. A writer flips the epoch and waits for the
+// previous parity's counters to drain. Requires linking with -pthread.
+
+#define HASHMAP_RCU_READER_SLOTS 16     // Reader counter stripes per epoch parity
+#define HASHMAP_RCU_RETIRE_BATCH 64     // Retired entries that trigger a grace period
+
+// Entry structure (immutable once published, except for next)
+typedef struct hashmap_rcu_entry {
+    _Atomic(struct hashmap_rcu_entry *) next;
+    struct hashmap_rcu_entry *retired_next; // Retire list link, writer-only
+    size_t hash;                    // Cached hash of the key
+    size_t key_size;
+    void *value;
+    bool owns_value;                // Call value_free when reclaimed
+    unsigned char key[];            // Copied key data, stored inline
+} hashmap_rcu_entry_t;
+
+// Bucket array published as one unit (internal structure)
+typedef struct hashmap_rcu_table {
+    size_t capacity;                // Always a power of two
+    _Atomic(hashmap_rcu_entry_t *) buckets[];
+} hashmap_rcu_table_t;
+
+// Reader counter on its own cache line; the alignment rounds its size up to
+// a whole line (internal structure)
+typedef struct hashmap_rcu_counter {
+    _Alignas(HASHMAP_CACHE_LINE) _Atomic size_t active;
+} hashmap_rcu_counter_t;
+
+// Read-mostly hashmap structure
+typedef struct hashmap_rcu {
+    hashmap_rcu_counter_t readers[2][HASHMAP_RCU_READER_SLOTS];
+    _Atomic(hashmap_rcu_table_t *) table;
+    _Atomic size_t epoch;
+    _Atomic size_t size;
+    pthread_mutex_t write_lock;     // Serializes put/remove/clear
+    hashmap_rcu_entry_t *retired;   // Unlinked entries awaiting a grace period
+    size_t retired_count;
+    value_free_func_t value_free;
+    hash_func_t hash_func;          // NULL for the built-in hash
+    double max_load_factor;
+    size_t max_entries;             // Growth threshold for the current capacity
+    unsigned growth_shift;          // log2 of the growth factor
+} hashmap_rcu_t;
+
+// Reader stripe for the calling thread (internal function)
+static inline size_t hashmap_rcu_reader_slot(void) {
+    static _Thread_local char anchor;
+    return hashmap_mix_hash((size_t)(uintptr_t)&anchor) & (HASHMAP_RCU_READER_SLOTS - 1);
+}
+
+// Enter a read section. Entries and values seen inside stay valid until the
+// matching hashmap_rcu_read_unlock. Sections may nest; never call a writer
+// function inside one (it would wait for itself).
+static inline size_t hashmap_rcu_read_lock(hashmap_rcu_t *map) {
+    size_t slot = hashmap_rcu_reader_slot();
+    for (;;) {
+        size_t epoch = atomic_load(&map->epoch);
+        _Atomic size_t *active = &map->readers[epoch & 1][slot].active;
+        atomic_fetch_add(active, 1);
+        // Registered under the epoch a writer will wait for only if it did not flip meanwhile
+        if (atomic_load(&map->epoch) == epoch) {
+            return (epoch & 1) * HASHMAP_RCU_READER_SLOTS + slot;
+        }
+        atomic_fetch_sub(active, 1);
+    }
+}
+
+// Leave the read section identified by the token from hashmap_rcu_read_lock
+static inline void hashmap_rcu_read_unlock(hashmap_rcu_t *map, size_t token) {
+    atomic_fetch_sub_explicit(&map->readers[token / HASHMAP_RCU_READER_SLOTS][token % HASHMAP_RCU_READER_SLOTS].active,
+                              1, memory_order_release);
+}
+
+// Wait until every reader that might see unlinked memory has left (write lock held, internal function)
+static inline void hashmap_rcu_wait_readers(hashmap_rcu_t *map) {
+    size_t epoch = atomic_load(&map->epoch);
+    atomic_store(&map->epoch, epoch + 1);
+    // Readers of the previous parity were drained by the previous grace period
+    for (size_t i = 0; i < HASHMAP_RCU_READER_SLOTS; i++) {
+        while (atomic_load(&map->readers[epoch & 1][i].active) != 0) {
+            sched_yield();
+        }
+    }
+}
+
+// Free an entry that no reader can reach (internal function)
+static inline void hashmap_rcu_entry_free(hashmap_rcu_t *map, hashmap_rcu_entry_t *entry) {
+    if (entry->owns_value && map->value_free) {
+        map->value_free(entry->value);
+    }
+    free(entry);
+}
+
+// Free the retire list; a grace period must have passed (internal function)
+static inline void hashmap_rcu_free_retired(hashmap_rcu_t *map) {
+    while (map->retired) {
+        hashmap_rcu_entry_t *entry = map->retired;
+        map->retired = entry->retired_next;
+        hashmap_rcu_entry_free(map, entry);
+    }
+    map->retired_count = 0;
+}
+
+// Free every retired entry after a grace period (write lock held, internal function)
+static inline void hashmap_rcu_reclaim(hashmap_rcu_t *map) {
+    if (!map->retired) {
+        return;
+    }
+    hashmap_rcu_wait_readers(map);
+    hashmap_rcu_free_retired(map);
+}
+
+// Queue an unlinked entry for reclamation (write lock held, internal function)
+static inline void hashmap_rcu_retire(hashmap_rcu_t *map, hashmap_rcu_entry_t *entry, bool owns_value) {
+    entry->owns_value = owns_value;
+    entry->retired_next = map->retired;
+    map->retired = entry;
+    if (++map->retired_count >= HASHMAP_RCU_RETIRE_BATCH) {
+        hashmap_rcu_reclaim(map);
+    }
+}
+
+// Allocate an empty table (internal function)
+static inline hashmap_rcu_table_t *hashmap_rcu_table_alloc(size_t capacity) {
+    if (capacity > (SIZE_MAX - sizeof(hashmap_rcu_table_t)) / sizeof(hashmap_rcu_entry_t *)) {
+        return NULL;
+    }
+    hashmap_rcu_table_t *table = (hashmap_rcu_table_t *)malloc(
+        sizeof(hashmap_rcu_table_t) + capacity * sizeof(hashmap_rcu_entry_t *));
+    if (!table) {
+        return NULL;
+    }
+    table->capacity = capacity;
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&table->buckets[i], NULL);
+    }
+    return table;
+}
+
+// Allocate an unpublished entry with a copy of the key (internal function)
+static inline hashmap_rcu_entry_t *hashmap_rcu_entry_create(const void *key, size_t key_size,
+                                                           size_t hash, void *value) {
+    if (key_size > SIZE_MAX - sizeof(hashmap_rcu_entry_t)) {
+        return NULL;
+    }
+    hashmap_rcu_entry_t *entry = (hashmap_rcu_entry_t *)malloc(sizeof(hashmap_rcu_entry_t) + key_size);
+    if (!entry) {
+        return NULL;
+    }
+    atomic_init(&entry->next, NULL);
+    entry->retired_next = NULL;
+    entry->hash = hash;
+    entry->key_size = key_size;
+    entry->value = value;
+    entry->owns_value = false;
+    memcpy(entry->key, key, key_size);
+    return entry;
+}
+
+// Free a table and its entries once unreachable (internal function)
+static inline void hashmap_rcu_table_free(hashmap_rcu_t *map, hashmap_rcu_table_t *table, bool free_values) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        hashmap_rcu_entry_t *entry = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+        while (entry) {
+            hashmap_rcu_entry_t *next = atomic_load_explicit(&entry->next, memory_order_relaxed);
+            entry->owns_value = free_values;
+            hashmap_rcu_entry_free(map, entry);
+            entry = next;
+        }
+    }
+    free(table);
+}
+
+// Publish a copy of the table with new_capacity buckets (write lock held, internal function)
+static inline bool hashmap_rcu_resize(hashmap_rcu_t *map, size_t new_capacity) {
+    hashmap_rcu_table_t *old_table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    hashmap_rcu_table_t *new_table = hashmap_rcu_table_alloc(new_capacity);
+    if (!new_table) {
+        return false;
+    }
+
+    // Copy entries: relinking the originals could hide keys from a reader mid-chain
+    for (size_t i = 0; i < old_table->capacity; i++) {
+        hashmap_rcu_entry_t *entry = atomic_load_explicit(&old_table->buckets[i], memory_order_relaxed);
+        for (; entry; entry = atomic_load_explicit(&entry->next, memory_order_relaxed)) {
+            hashmap_rcu_entry_t *copy = hashmap_rcu_entry_create(entry->key, entry->key_size,
+                                                                 entry->hash, entry->value);
+            if (!copy) {
+                hashmap_rcu_table_free(map, new_table, false);
+                return false;
+            }
+            size_t index = hashmap_bucket_index(copy->hash, new_capacity);
+            atomic_init(&copy->next, atomic_load_explicit(&new_table->buckets[index], memory_order_relaxed));
+            atomic_init(&new_table->buckets[index], copy);
+        }
+    }
+
+    atomic_store_explicit(&map->table, new_table, memory_order_release);
+    map->max_entries = hashmap_load_threshold(new_capacity, map->max_load_factor);
+
+    // One grace period covers the old table and anything already retired
+    hashmap_rcu_wait_readers(map);
+    hashmap_rcu_table_free(map, old_table, false);
+    hashmap_rcu_free_retired(map);
+    return true;
+}
+
+// Create a new read-mostly hashmap from an options struct (allocator and pool
+// options are not used)
+static inline hashmap_rcu_t *hashmap_rcu_create_ex(const hashmap_options_t *options) {
+    hashmap_options_t defaults = {0};
+    if (!options) {
+        options = &defaults;
+    }
+
+    size_t initial_capacity = options->initial_capacity;
+    if (initial_capacity == 0) {
+        initial_capacity = HASHMAP_DEFAULT_CAPACITY;
+    }
+    initial_capacity = hashmap_round_capacity(initial_capacity);
+
+    hashmap_rcu_t *map = (hashmap_rcu_t *)aligned_alloc(HASHMAP_CACHE_LINE, sizeof(hashmap_rcu_t));
+    if (!map) {
+        return NULL;
+    }
+    hashmap_rcu_table_t *table = hashmap_rcu_table_alloc(initial_capacity);
+    if (!table) {
+        free(map);
+        return NULL;
+    }
+    if (pthread_mutex_init(&map->write_lock, NULL) != 0) {
+        free(table);
+        free(map);
+        return NULL;
+    }
+
+    for (size_t parity = 0; parity < 2; parity++) {
+        for (size_t i = 0; i < HASHMAP_RCU_READER_SLOTS; i++) {
+            atomic_init(&map->readers[parity][i].active, 0);
+        }
+    }
+    atomic_init(&map->table, table);
+    atomic_init(&map->epoch, 0);
+    atomic_init(&map->size, 0);
+    map->retired = NULL;
+    map->retired_count = 0;
+    map->value_free = options->value_free;
+    map->hash_func = options->hash_func;
+    map->max_load_factor = hashmap_options_load_factor(options, HASHMAP_DEFAULT_MAX_LOAD_FACTOR);
+    map->max_entries = hashmap_load_threshold(initial_capacity, map->max_load_factor);
+    map->growth_shift = hashmap_options_growth_shift(options);
+
+    return map;
+}
+
+// Create a new read-mostly hashmap
+static inline hashmap_rcu_t *hashmap_rcu_create(
+    size_t initial_capacity,
+    key_free_func_t key_free,
+    value_free_func_t value_free
+) {
+    hashmap_options_t options = {0};
+    options.initial_capacity = initial_capacity;
+    options.key_free = key_free;
+    options.value_free = value_free;
+    return hashmap_rcu_create_ex(&options);
+}
+
+// Destroy the hashmap and free all resources (no other thread may use it)
+static inline void hashmap_rcu_destroy(hashmap_rcu_t *map) {
+    if (!map) {
+        return;
+    }
+
+    hashmap_rcu_free_retired(map);
+    hashmap_rcu_table_free(map, atomic_load(&map->table), true);
+    pthread_mutex_destroy(&map->write_lock);
+    free(map);
+}
+
+// Find key's entry in a table, or NULL; safe for readers (internal function)
+static inline hashmap_rcu_entry_t *hashmap_rcu_find_entry(hashmap_rcu_table_t *table, const void *key,
+                                                         size_t key_size, size_t hash) {
+    hashmap_rcu_entry_t *entry = atomic_load_explicit(
+        &table->buckets[hashmap_bucket_index(hash, table->capacity)], memory_order_acquire);
+    for (; entry; entry = atomic_load_explicit(&entry->next, memory_order_acquire)) {
+        if (entry->hash == hash && entry->key_size == key_size &&
+            hashmap_key_equal(entry->key, key, key_size)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Locate the link pointing at key's entry in a table, or NULL; writers only,
+// since a link's target can change under a reader (internal function)
+static inline _Atomic(hashmap_rcu_entry_t *) *hashmap_rcu_find_link(hashmap_rcu_table_t *table, const void *key,
+                                                                    size_t key_size, size_t hash) {
+    _Atomic(hashmap_rcu_entry_t *) *link = &table->buckets[hashmap_bucket_index(hash, table->capacity)];
+    hashmap_rcu_entry_t *entry;
+    while ((entry = atomic_load_explicit(link, memory_order_acquire)) != NULL) {
+        if (entry->hash == hash && entry->key_size == key_size &&
+            hashmap_key_equal(entry->key, key, key_size)) {
+            return link;
+        }
+        link = &entry->next;
+    }
+    return NULL;
+}
+
+// Insert or update a key-value pair (serialized with other writers)
+static inline bool hashmap_rcu_put(hashmap_rcu_t *map, const void *key, size_t key_size, void *value) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_rcu_entry_t *entry = hashmap_rcu_entry_create(key, key_size, hash, value);
+    if (!entry) {
+        return false;
+    }
+
+    pthread_mutex_lock(&map->write_lock);
+    hashmap_rcu_table_t *table = atomic_load_explicit(&map->table, memory_order_relaxed);
+
+    // Update by swapping in the new entry; readers see either the old or the new one
+    _Atomic(hashmap_rcu_entry_t *) *link = hashmap_rcu_find_link(table, key, key_size, hash);
+    if (link) {
+        hashmap_rcu_entry_t *old = atomic_load_explicit(link, memory_order_relaxed);
+        atomic_init(&entry->next, atomic_load_explicit(&old->next, memory_order_relaxed));
+        atomic_store_explicit(link, entry, memory_order_release);
+        hashmap_rcu_retire(map, old, old->value != value);
+        pthread_mutex_unlock(&map->write_lock);
+        return true;
+    }
+
+    // Resize once the load factor threshold is reached
+    size_t size = atomic_load_explicit(&map->size, memory_order_relaxed);
+    if (size >= map->max_entries) {
+        if (table->capacity > (SIZE_MAX >> map->growth_shift) ||
+            !hashmap_rcu_resize(map, table->capacity << map->growth_shift)) {
+            pthread_mutex_unlock(&map->write_lock);
+            free(entry);
+            return false;
+        }
+        table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    }
+
+    _Atomic(hashmap_rcu_entry_t *) *bucket = &table->buckets[hashmap_bucket_index(hash, table->capacity)];
+    atomic_init(&entry->next, atomic_load_explicit(bucket, memory_order_relaxed));
+    atomic_store_explicit(bucket, entry, memory_order_release);
+    atomic_store_explicit(&map->size, size + 1, memory_order_relaxed);
+
+    pthread_mutex_unlock(&map->write_lock);
+    return true;
+}
+
+// Get the value associated with a key without taking a lock. The value stays
+// valid only while the caller holds a read section around the call and its use.
+static inline void *hashmap_rcu_get(hashmap_rcu_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    size_t token = hashmap_rcu_read_lock(map);
+    hashmap_rcu_table_t *table = atomic_load_explicit(&map->table, memory_order_acquire);
+    hashmap_rcu_entry_t *entry = hashmap_rcu_find_entry(table, key, key_size, hash);
+    void *value = entry ? entry->value : NULL;
+    hashmap_rcu_read_unlock(map, token);
+    return value;
+}
+
+// Remove a key-value pair (serialized with other writers)
+static inline bool hashmap_rcu_remove(hashmap_rcu_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    pthread_mutex_lock(&map->write_lock);
+    hashmap_rcu_table_t *table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    _Atomic(hashmap_rcu_entry_t *) *link = hashmap_rcu_find_link(table, key, key_size, hash);
+    if (!link) {
+        pthread_mutex_unlock(&map->write_lock);
+        return false;
+    }
+
+    // Readers already on the entry can still follow its next pointer
+    hashmap_rcu_entry_t *entry = atomic_load_explicit(link, memory_order_relaxed);
+    atomic_store_explicit(link, atomic_load_explicit(&entry->next, memory_order_relaxed), memory_order_release);
+    atomic_store_explicit(&map->size, atomic_load_explicit(&map->size, memory_order_relaxed) - 1,
+                          memory_order_relaxed);
+    hashmap_rcu_retire(map, entry, true);
+
+    pthread_mutex_unlock(&map->write_lock);
+    return true;
+}
+
+// Check if a key exists in the hashmap
+static inline bool hashmap_rcu_contains(hashmap_rcu_t *map, const void *key, size_t key_size) {
+    return hashmap_rcu_get(map, key, key_size) != NULL;
+}
+
+// Get the number of key-value pairs
+static inline size_t hashmap_rcu_size(const hashmap_rcu_t *map) {
+    return map ? atomic_load_explicit(&map->size, memory_order_relaxed) : 0;
+}
+
+// Check if the hashmap is empty
+static inline bool hashmap_rcu_is_empty(const hashmap_rcu_t *map) {
+    return hashmap_rcu_size(map) == 0;
+}
+
+// Free retired entries now instead of at the next batch boundary
+static inline void hashmap_rcu_synchronize(hashmap_rcu_t *map) {
+    if (!map) {
+        return;
+    }
+
+    pthread_mutex_lock(&map->write_lock);
+    hashmap_rcu_reclaim(map);
+    pthread_mutex_unlock(&map->write_lock);
+}
+
+// Clear all entries; concurrent readers see either the old or the empty table
+static inline void hashmap_rcu_clear(hashmap_rcu_t *map) {
+    if (!map) {
+        return;
+    }
+
+    pthread_mutex_lock(&map->write_lock);
+    hashmap_rcu_table_t *old_table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    hashmap_rcu_table_t *empty = hashmap_rcu_table_alloc(old_table->capacity);
+    if (empty) {
+        atomic_store_explicit(&map->table, empty, memory_order_release);
+        atomic_store_explicit(&map->size, 0, memory_order_relaxed);
+        hashmap_rcu_wait_readers(map);
+        hashmap_rcu_table_free(map, old_table, true);
+    } else {
+        // No memory for a fresh table: unlink chains one bucket at a time
+        for (size_t i = 0; i < old_table->capacity; i++) {
+            hashmap_rcu_entry_t *entry = atomic_exchange(&old_table->buckets[i], NULL);
+            while (entry) {
+                hashmap_rcu_entry_t *next = atomic_load_explicit(&entry->next, memory_order_relaxed);
+                entry->owns_value = true;
+                entry->retired_next = map->retired;
+                map->retired = entry;
+                entry = next;
+            }
+        }
+        atomic_store_explicit(&map->size, 0, memory_order_relaxed);
+    }
+    hashmap_rcu_reclaim(map);
+    pthread_mutex_unlock(&map->write_lock);
+}
+
+#endif // HASHMAP_RCU_H
@@ -0,0 +1,200 @@
+#ifndef HASHMAP_SHARDED_H
+#define HASHMAP_SHARDED_H
+
+#include "hashmap.h"
+
+// Sharded hashmap front-end
+//
+// Owns N independent hashmap_t shards (N a power of two). A key is routed to
+// a shard by the top bits of its table hash (hashmap_generic_hash unless a
+// custom hash is configured). Within the shard, the low bits of the same hash
+// select the bucket, so each key is hashed once. Each shard grows on its own,
+// so a resize rehashes only about 1/N of the keys.
+//
+// The front-end itself takes no locks. Callers that share it between threads
+// pair each shard with their own lock: hashmap_sharded_index names the shard
+// a key belongs to, and hashmap_sharded_shard exposes that shard so it can be
+// used directly while its lock is held. In cache mode (options.cache_capacity,
+// split across the shards) hashmap_sharded_get marks the entry it finds, so
+// it writes to the shard and needs that lock exclusively.
+
+// Sharded hashmap structure
+typedef struct hashmap_sharded {
+    hashmap_t **shards;
+    size_t shard_count;             // Always a power of two
+    unsigned shard_bits;            // log2(shard_count)
+    hash_func_t hash_func;          // NULL for the built-in hash
+} hashmap_sharded_t;
+
+// Destroy the first n shards and the front-end (internal function)
+static inline void hashmap_sharded_release(hashmap_sharded_t *map, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        hashmap_destroy(map->shards[i]);
+    }
+    free(map->shards);
+    free(map);
+}
+
+// Create a new sharded hashmap from an options struct. options->concurrency
+// is the shard count (0 defaults to 64) and initial_capacity the total across
+// all shards.
+static inline hashmap_sharded_t *hashmap_sharded_create_ex(const hashmap_options_t *options) {
+    hashmap_options_t defaults = {0};
+    if (!options) {
+        options = &defaults;
+    }
+
+    size_t shard_count = options->concurrency;
+    if (shard_count == 0) {
+        shard_count = HASHMAP_DEFAULT_PARTITIONS;
+    }
+    shard_count = hashmap_round_capacity(shard_count);
+    if (shard_count > SIZE_MAX / sizeof(hashmap_t *)) {
+        return NULL;
+    }
+
+    hashmap_sharded_t *map = (hashmap_sharded_t *)malloc(sizeof(hashmap_sharded_t));
+    if (!map) {
+        return NULL;
+    }
+    map->shards = (hashmap_t **)malloc(shard_count * sizeof(hashmap_t *));
+    if (!map->shards) {
+        free(map);
+        return NULL;
+    }
+    map->shard_count = shard_count;
+    map->shard_bits = 0;
+    while (((size_t)1 << map->shard_bits) < shard_count) {
+        map->shard_bits++;
+    }
+    map->hash_func = options->hash_func;
+
+    // Spread the requested capacity over the shards
+    hashmap_options_t shard_options = *options;
+    if (options->initial_capacity) {
+        shard_options.initial_capacity = (options->initial_capacity + shard_count - 1) / shard_count;
+    }
+    if (options->cache_capacity) {
+        shard_options.cache_capacity = (options->cache_capacity + shard_count - 1) / shard_count;
+    }
+
+    for (size_t i = 0; i < shard_count; i++) {
+        map->shards[i] = hashmap_create_ex(&shard_options);
+        if (!map->shards[i]) {
+            hashmap_sharded_release(map, i);
+            return NULL;
+        }
+    }
+
+    return map;
+}
+
+// Create a new sharded hashmap with shard_count shards (0 defaults to 64)
+static inline hashmap_sharded_t *hashmap_sharded_create(
+    size_t shard_count,
+    size_t initial_capacity,
+    key_free_func_t key_free,
+    value_free_func_t value_free
+) {
+    hashmap_options_t options = {0};
+    options.concurrency = shard_count;
+    options.initial_capacity = initial_capacity;
+    options.key_free = key_free;
+    options.value_free = value_free;
+    return hashmap_sharded_create_ex(&options);
+}
+
+// Destroy the hashmap and all shards
+static inline void hashmap_sharded_destroy(hashmap_sharded_t *map) {
+    if (!map) {
+        return;
+    }
+    hashmap_sharded_release(map, map->shard_count);
+}
+
+// Index of the shard that owns a key, or SIZE_MAX for invalid arguments
+static inline size_t hashmap_sharded_index(const hashmap_sharded_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return SIZE_MAX;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    return hashmap_partition_index(hash, map->shard_bits);
+}
+
+// Shard at an index from hashmap_sharded_index, or NULL when out of range
+static inline hashmap_t *hashmap_sharded_shard(const hashmap_sharded_t *map, size_t index) {
+    if (!map || index >= map->shard_count) {
+        return NULL;
+    }
+    return map->shards[index];
+}
+
+// Insert or update a key-value pair
+static inline bool hashmap_sharded_put(hashmap_sharded_t *map, const void *key, size_t key_size, void *value) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_t *shard = map->shards[hashmap_partition_index(hash, map->shard_bits)];
+    return hashmap_put_hashed(shard, key, key_size, hash, value);
+}
+
+// Get the value associated with a key
+static inline void *hashmap_sharded_get(const hashmap_sharded_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return NULL;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_t *shard = map->shards[hashmap_partition_index(hash, map->shard_bits)];
+    return hashmap_get_hashed(shard, key, key_size, hash);
+}
+
+// Remove a key-value pair
+static inline bool hashmap_sharded_remove(hashmap_sharded_t *map, const void *key, size_t key_size) {
+    if (!map || !key || key_size == 0) {
+        return false;
+    }
+
+    size_t hash = hashmap_hash_key(map->hash_func, key, key_size);
+    hashmap_t *shard = map->shards[hashmap_partition_index(hash, map->shard_bits)];
+    return hashmap_remove_hashed(shard, key, key_size, hash);
+}
+
+// Check if a key exists in the hashmap
+static inline bool hashmap_sharded_contains(const hashmap_sharded_t *map, const void *key, size_t key_size) {
+    return hashmap_sharded_get(map, key, key_size) != NULL;
+}
+
+// Get the number of key-value pairs across all shards
+static inline size_t hashmap_sharded_size(const hashmap_sharded_t *map) {
+    if (!map) {
+        return 0;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < map->shard_count; i++) {
+        total += map->shards[i]->size;
+    }
+    return total;
+}
+
+// Check if the hashmap is empty
+static inline bool hashmap_sharded_is_empty(const hashmap_sharded_t *map) {
+    return hashmap_sharded_size(map) == 0;
+}
+
+// Clear all entries from every shard
+static inline void hashmap_sharded_clear(hashmap_sharded_t *map) {
+    if (!map) {
+        return;
+    }
+
+    for (size_t i = 0; i < map->shard_count; i++) {
+        hashmap_clear(map->shards[i]);
+    }
+}
+
+#endif // HASHMAP_SHARDED_H
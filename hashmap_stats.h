@@ -0,0 +1,175 @@
+#ifndef HASHMAP_STATS_H
+#define HASHMAP_STATS_H
+
+#include "hashmap.h"
+
+#include <stdio.h>
+
+// Map statistics
+//
+// hashmap_stats reports the shape of a chained map: size, load, bucket use
+// and chain lengths, found by walking every bucket (O(capacity)).
+// hashmap_chain_histogram and hashmap_stats_dump expose the same walk as a
+// bucket-occupancy histogram.
+//
+// Built with HASHMAP_ENABLE_STATS defined, the map also keeps runtime
+// counters: resizes and the time spent in them, entries compared per
+// hashmap_get, and bytes held from the allocator. The define changes the
+// layout of hashmap_t, so every translation unit sharing a map must agree on
+// it. Without it the counter fields read zero and instrumented is false, and
+// the map does no extra work at all.
+
+#define HASHMAP_STATS_HISTOGRAM_BINS 8  // Chain lengths printed by hashmap_stats_dump; the last bin collects longer chains
+
+// Map statistics, filled in by hashmap_stats
+typedef struct hashmap_stats {
+    size_t size;
+    size_t capacity;
+    double load_factor;             // size / capacity
+    size_t used_buckets;            // Non-empty buckets, undrained old ones included
+    size_t max_chain;               // Longest chain
+    double avg_chain;               // Entries per non-empty bucket
+    bool migrating;                 // An incremental resize is still draining
+    bool instrumented;              // The counters below are maintained (HASHMAP_ENABLE_STATS)
+    uint64_t resizes;               // Table reallocations (growth, reserve, shrink)
+    uint64_t resize_ns;             // Time spent allocating and rehashing tables
+    uint64_t lookups;               // hashmap_get/hashmap_get_with_hash calls
+    uint64_t probes;                // Entries compared by those lookups
+    double avg_probe;               // probes / lookups
+    uint64_t max_probe;             // Longest single lookup
+    uint64_t alloc_bytes;           // Bytes currently held from the allocator
+    uint64_t peak_bytes;            // High-water mark of alloc_bytes
+    uint64_t allocations;           // Allocator calls made
+} hashmap_stats_t;
+
+// Length of the chain starting at entry (internal function)
+static inline size_t hashmap_stats_chain(const hashmap_entry_t *entry) {
+    size_t length = 0;
+    for (; entry; entry = entry->next) {
+        length++;
+    }
+    return length;
+}
+
+// Count buckets by chain length: counts[k] is the number of buckets holding
+// k entries, and counts[bins - 1] also takes every longer chain. Buckets of an
+// old table still being drained are included. Returns the longest chain;
+// counts may be NULL to get only that.
+static inline size_t hashmap_chain_histogram(const hashmap_t *map, size_t *counts, size_t bins) {
+    if (!map) {
+        return 0;
+    }
+    if (counts) {
+        memset(counts, 0, bins * sizeof(*counts));
+    }
+
+    size_t longest = 0;
+    for (size_t table = 0; table < 2; table++) {
+        hashmap_entry_t **buckets = table == 0 ? map->buckets : map->old_buckets;
+        size_t begin = table == 0 ? 0 : map->migrate_index;
+        size_t end = table == 0 ? map->capacity : map->old_capacity;
+        for (size_t i = begin; buckets && i < end; i++) {
+            size_t length = hashmap_stats_chain(buckets[i]);
+            if (length > longest) {
+                longest = length;
+            }
+            if (counts && bins) {
+                counts[length < bins ? length : bins - 1]++;
+            }
+        }
+    }
+    return longest;
+}
+
+// Fill out with the map's current statistics
+static inline bool hashmap_stats(const hashmap_t *map, hashmap_stats_t *out) {
+    if (!map || !out) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+
+    out->size = map->size;
+    out->capacity = map->capacity;
+    out->load_factor = (double)map->size / (double)map->capacity;
+    out->migrating = map->old_buckets != NULL;
+
+    // Two bins split the buckets into empty and occupied
+    size_t occupancy[2];
+    out->max_chain = hashmap_chain_histogram(map, occupancy, 2);
+    out->used_buckets = occupancy[1];
+    out->avg_chain = out->used_buckets ? (double)map->size / (double)out->used_buckets : 0.0;
+
+#ifdef HASHMAP_ENABLE_STATS
+    const hashmap_counters_t *counters = &map->counters;
+    out->instrumented = true;
+    out->resizes = atomic_load_explicit(&counters->resizes, memory_order_relaxed);
+    out->resize_ns = atomic_load_explicit(&counters->resize_ns, memory_order_relaxed);
+    out->lookups = atomic_load_explicit(&counters->lookups, memory_order_relaxed);
+    out->probes = atomic_load_explicit(&counters->probes, memory_order_relaxed);
+    out->max_probe = atomic_load_explicit(&counters->max_probe, memory_order_relaxed);
+    out->alloc_bytes = atomic_load_explicit(&counters->alloc_bytes, memory_order_relaxed);
+    out->peak_bytes = atomic_load_explicit(&counters->peak_bytes, memory_order_relaxed);
+    out->allocations = atomic_load_explicit(&counters->allocations, memory_order_relaxed);
+    out->avg_probe = out->lookups ? (double)out->probes / (double)out->lookups : 0.0;
+#endif
+    return true;
+}
+
+// Zero the event counters and restart the peak from the current footprint;
+// alloc_bytes keeps tracking what is held. No-op without HASHMAP_ENABLE_STATS.
+static inline void hashmap_stats_reset(hashmap_t *map) {
+#ifdef HASHMAP_ENABLE_STATS
+    if (!map) {
+        return;
+    }
+    hashmap_counters_t *counters = &map->counters;
+    atomic_store_explicit(&counters->resizes, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->resize_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->lookups, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->probes, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->max_probe, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->allocations, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->peak_bytes,
+                          atomic_load_explicit(&counters->alloc_bytes, memory_order_relaxed), memory_order_relaxed);
+#else
+    (void)map;
+#endif
+}
+
+// Print the statistics and a bucket-occupancy histogram to out
+static inline bool hashmap_stats_dump(const hashmap_t *map, FILE *out) {
+    hashmap_stats_t stats;
+    if (!out || !hashmap_stats(map, &stats)) {
+        return false;
+    }
+
+    fprintf(out, "size %zu, capacity %zu, load %.3f%s\n", stats.size, stats.capacity, stats.load_factor,
+            stats.migrating ? " (resize in progress)" : "");
+    fprintf(out, "used buckets %zu, avg chain %.3f, max chain %zu\n", stats.used_buckets, stats.avg_chain,
+            stats.max_chain);
+    if (stats.instrumented) {
+        fprintf(out, "resizes %llu, resize time %.3f ms\n", (unsigned long long)stats.resizes,
+                (double)stats.resize_ns / 1e6);
+        fprintf(out, "lookups %llu, avg probe %.3f, max probe %llu\n", (unsigned long long)stats.lookups,
+                stats.avg_probe, (unsigned long long)stats.max_probe);
+        fprintf(out, "allocated %llu bytes (peak %llu) in %llu allocations\n",
+                (unsigned long long)stats.alloc_bytes, (unsigned long long)stats.peak_bytes,
+                (unsigned long long)stats.allocations);
+    }
+
+    size_t counts[HASHMAP_STATS_HISTOGRAM_BINS];
+    hashmap_chain_histogram(map, counts, HASHMAP_STATS_HISTOGRAM_BINS);
+    size_t total = 0;
+    for (size_t i = 0; i < HASHMAP_STATS_HISTOGRAM_BINS; i++) {
+        total += counts[i];
+    }
+    for (size_t i = 0; i < HASHMAP_STATS_HISTOGRAM_BINS; i++) {
+        double share = total ? (double)counts[i] / (double)total : 0.0;
+        int bar = (int)(share * 50.0 + 0.5);
+        fprintf(out, "chain %zu%s %10zu %6.2f%% %.*s\n", i, i + 1 == HASHMAP_STATS_HISTOGRAM_BINS ? "+" : " ",
+                counts[i], share * 100.0, bar, "##################################################");
+    }
+    return true;
+}
+
+#endif // HASHMAP_STATS_H
@@ -0,0 +1,298 @@
+#ifndef HASHMAP_TYPED_H
+#define HASHMAP_TYPED_H
+
+#include "hashmap_flat.h"
+
+// Compile-time specialized maps
+//
+// HASHMAP_DECLARE(name, key_type, value_type, hash_fn, eq_fn) defines a map
+// type name_t and its functions (name_create, name_put, name_get, ...). Keys
+// and values are stored by value in the slots of an open-addressing table
+// that uses the flat engine's control bytes and group probing. Because the
+// key type is known at compile time, each probe compares keys with eq_fn
+// instead of memcmp and hashes them with hash_fn instead of byte-wise FNV.
+// For integer keys the whole lookup inlines into a handful of instructions.
+//
+//   hash_fn(key)  returns size_t; must mix all bits (the low 7 bits form the
+//                 control tag, the bits above pick the group)
+//   eq_fn(a, b)   returns non-zero when two keys are equal
+//
+// Either may be a function or a function-like macro. hashmap_typed_hash_u64
+// and HASHMAP_TYPED_EQ cover the integer case.
+//
+// Entries are copied by value and never freed individually; slots move when
+// the table rehashes, so value pointers are valid only until the next insert.
+
+// Mixes an integer key of up to 64 bits into a full-width hash (the MurmurHash3 finalizer)
+static inline size_t hashmap_typed_hash_u64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
+// Equality for scalar keys
+#define HASHMAP_TYPED_EQ(a, b) ((a) == (b))
+
+#define HASHMAP_DECLARE(name, key_type, value_type, hash_fn, eq_fn)                                   \
+                                                                                                      \
+typedef struct name##_slot {                                                                          \
+    key_type key;                                                                                     \
+    value_type value;                                                                                 \
+} name##_slot_t;                                                                                      \
+                                                                                                      \
+typedef struct name {                                                                                 \
+    int8_t *ctrl;                   /* One control byte per slot */                                   \
+    name##_slot_t *slots;                                                                             \
+    size_t capacity;                /* Power of two, multiple of the group width */                   \
+    size_t size;                                                                                      \
+    size_t growth_left;             /* Inserts into EMPTY slots allowed before rehash */              \
+} name##_t;                                                                                           \
+                                                                                                      \
+/* Find the slot holding key, or SIZE_MAX (internal function) */                                      \
+static inline size_t name##_find(const name##_t *map, key_type key, size_t hash) {                   \
+    size_t group_mask = map->capacity / HASHMAP_FLAT_GROUP_WIDTH - 1;                                 \
+    size_t group = (hash >> 7) & group_mask;                                                          \
+    int8_t tag = hashmap_flat_tag(hash);                                                              \
+                                                                                                      \
+    for (size_t step = 1; step <= group_mask + 1; step++) {                                           \
+        const int8_t *ctrl = map->ctrl + group * HASHMAP_FLAT_GROUP_WIDTH;                            \
+        uint32_t match = hashmap_flat_match(ctrl, tag);                                               \
+        while (match) {                                                                               \
+            size_t index = group * HASHMAP_FLAT_GROUP_WIDTH + hashmap_flat_ctz(match);                \
+            if (eq_fn(map->slots[index].key, key)) {                                                  \
+                return index;                                                                         \
+            }                                                                                         \
+            match &= match - 1;                                                                       \
+        }                                                                                             \
+        if (hashmap_flat_match(ctrl, HASHMAP_FLAT_CTRL_EMPTY)) {                                      \
+            return SIZE_MAX;                                                                          \
+        }                                                                                             \
+        group = (group + step) & group_mask;                                                          \
+    }                                                                                                 \
+                                                                                                      \
+    return SIZE_MAX;                                                                                  \
+}                                                                                                     \
+                                                                                                      \
+/* Rebuild the table with new_capacity slots, rehashing every key (internal function) */             \
+static inline bool name##_resize(name##_t *map, size_t new_capacity) {                               \
+    if (new_capacity > SIZE_MAX / sizeof(name##_slot_t)) {                                            \
+        return false;                                                                                 \
+    }                                                                                                 \
+    int8_t *new_ctrl = (int8_t *)malloc(new_capacity);                                                \
+    name##_slot_t *new_slots = (name##_slot_t *)malloc(new_capacity * sizeof(name##_slot_t));         \
+    if (!new_ctrl || !new_slots) {                                                                    \
+        free(new_ctrl);                                                                               \
+        free(new_slots);                                                                              \
+        return false;                                                                                 \
+    }                                                                                                 \
+    memset(new_ctrl, (unsigned char)HASHMAP_FLAT_CTRL_EMPTY, new_capacity);                           \
+                                                                                                      \
+    for (size_t i = 0; i < map->capacity; i++) {                                                      \
+        if (map->ctrl[i] < 0) {                                                                       \
+            continue;                                                                                 \
+        }                                                                                             \
+        size_t hash = hash_fn(map->slots[i].key);                                                     \
+        size_t index = hashmap_flat_probe_free(new_ctrl, new_capacity, hash);                         \
+        new_ctrl[index] = map->ctrl[i];                                                               \
+        new_slots[index] = map->slots[i];                                                             \
+    }                                                                                                 \
+                                                                                                      \
+    free(map->ctrl);                                                                                  \
+    free(map->slots);                                                                                 \
+    map->ctrl = new_ctrl;                                                                             \
+    map->slots = new_slots;                                                                           \
+    map->capacity = new_capacity;                                                                     \
+    map->growth_left = hashmap_flat_load_limit(new_capacity, HASHMAP_FLAT_MAX_LOAD_FACTOR) - map->size; \
+    return true;                                                                                      \
+}                                                                                                     \
+                                                                                                      \
+/* Create a new typed map (0 defaults to 16 slots) */                                                 \
+static inline name##_t *name##_create(size_t initial_capacity) {                                      \
+    if (initial_capacity == 0) {                                                                      \
+        initial_capacity = HASHMAP_DEFAULT_CAPACITY;                                                  \
+    }                                                                                                 \
+    name##_t *map = (name##_t *)malloc(sizeof(name##_t));                                             \
+    if (!map) {                                                                                       \
+        return NULL;                                                                                  \
+    }                                                                                                 \
+    map->capacity = hashmap_flat_round_capacity(initial_capacity);                                    \
+    map->ctrl = NULL;                                                                                 \
+    map->slots = NULL;                                                                                \
+    if (map->capacity <= SIZE_MAX / sizeof(name##_slot_t)) {                                          \
+        map->ctrl = (int8_t *)malloc(map->capacity);                                                  \
+        map->slots = (name##_slot_t *)malloc(map->capacity * sizeof(name##_slot_t));                  \
+    }                                                                                                 \
+    if (!map->ctrl || !map->slots) {                                                                  \
+        free(map->ctrl);                                                                              \
+        free(map->slots);                                                                             \
+        free(map);                                                                                    \
+        return NULL;                                                                                  \
+    }                                                                                                 \
+    memset(map->ctrl, (unsigned char)HASHMAP_FLAT_CTRL_EMPTY, map->capacity);                         \
+    map->size = 0;                                                                                    \
+    map->growth_left = hashmap_flat_load_limit(map->capacity, HASHMAP_FLAT_MAX_LOAD_FACTOR);          \
+    return map;                                                                                       \
+}                                                                                                     \
+                                                                                                      \
+/* Destroy the map and free all resources */                                                          \
+static inline void name##_destroy(name##_t *map) {                                                    \
+    if (!map) {                                                                                       \
+        return;                                                                                       \
+    }                                                                                                 \
+    free(map->ctrl);                                                                                  \
+    free(map->slots);                                                                                 \
+    free(map);                                                                                        \
+}                                                                                                     \
+                                                                                                      \
+/* Clear all entries from the map */                                                                  \
+static inline void name##_clear(name##_t *map) {                                                      \
+    if (!map) {                                                                                       \
+        return;                                                                                       \
+    }                                                                                                 \
+    memset(map->ctrl, (unsigned char)HASHMAP_FLAT_CTRL_EMPTY, map->capacity);                         \
+    map->size = 0;                                                                                    \
+    map->growth_left = hashmap_flat_load_limit(map->capacity, HASHMAP_FLAT_MAX_LOAD_FACTOR);          \
+}                                                                                                     \
+                                                                                                      \
+/* Return the value slot for key, inserting it zero-filled when missing.                              \
+   *inserted (may be NULL) reports whether the key was added; NULL on failure */                      \
+static inline value_type *name##_get_or_insert(name##_t *map, key_type key, bool *inserted) {        \
+    if (inserted) {                                                                                   \
+        *inserted = false;                                                                            \
+    }                                                                                                 \
+    if (!map) {                                                                                       \
+        return NULL;                                                                                  \
+    }                                                                                                 \
+                                                                                                      \
+    size_t hash = hash_fn(key);                                                                       \
+    size_t index = name##_find(map, key, hash);                                                       \
+    if (index != SIZE_MAX) {                                                                          \
+        return &map->slots[index].value;                                                              \
+    }                                                                                                 \
+                                                                                                      \
+    index = hashmap_flat_probe_free(map->ctrl, map->capacity, hash);                                  \
+    if (map->ctrl[index] == HASHMAP_FLAT_CTRL_EMPTY && map->growth_left == 0) {                       \
+        /* Grow when genuinely full; otherwise just purge tombstones in place */                      \
+        size_t new_capacity = map->capacity;                                                          \
+        if (map->size >= hashmap_flat_load_limit(map->capacity, HASHMAP_FLAT_MAX_LOAD_FACTOR) / 2) {  \
+            if (map->capacity > SIZE_MAX / 2) {                                                       \
+                return NULL;                                                                          \
+            }                                                                                         \
+            new_capacity = map->capacity * 2;                                                         \
+        }                                                                                             \
+        if (!name##_resize(map, new_capacity)) {                                                      \
+            return NULL;                                                                              \
+        }                                                                                             \
+        index = hashmap_flat_probe_free(map->ctrl, map->capacity, hash);                              \
+    }                                                                                                 \
+                                                                                                      \
+    name##_slot_t *slot = &map->slots[index];                                                         \
+    slot->key = key;                                                                                  \
+    memset(&slot->value, 0, sizeof(value_type));                                                      \
+    if (map->ctrl[index] == HASHMAP_FLAT_CTRL_EMPTY) {                                                \
+        map->growth_left--;                                                                           \
+    }                                                                                                 \
+    map->ctrl[index] = hashmap_flat_tag(hash);                                                        \
+    map->size++;                                                                                      \
+    if (inserted) {                                                                                   \
+        *inserted = true;                                                                             \
+    }                                                                                                 \
+    return &slot->value;                                                                              \
+}                                                                                                     \
+                                                                                                      \
+/* Insert or update a key-value pair */                                                               \
+static inline bool name##_put(name##_t *map, key_type key, value_type value) {                        \
+    value_type *slot = name##_get_or_insert(map, key, NULL);                                          \
+    if (!slot) {                                                                                      \
+        return false;                                                                                 \
+    }                                                                                                 \
+    *slot = value;                                                                                    \
+    return true;                                                                                      \
+}                                                                                                     \
+                                                                                                      \
+/* Pointer to the value stored for key, or NULL when absent */                                        \
+static inline value_type *name##_get(const name##_t *map, key_type key) {                            \
+    if (!map) {                                                                                       \
+        return NULL;                                                                                  \
+    }                                                                                                 \
+    size_t index = name##_find(map, key, hash_fn(key));                                               \
+    return index != SIZE_MAX ? &map->slots[index].value : NULL;                                       \
+}                                                                                                     \
+                                                                                                      \
+/* Remove a key-value pair */                                                                         \
+static inline bool name##_remove(name##_t *map, key_type key) {                                       \
+    if (!map) {                                                                                       \
+        return false;                                                                                 \
+    }                                                                                                 \
+    size_t index = name##_find(map, key, hash_fn(key));                                               \
+    if (index == SIZE_MAX) {                                                                          \
+        return false;                                                                                 \
+    }                                                                                                 \
+    if (hashmap_flat_release_ctrl(map->ctrl, index)) {                                                \
+        map->growth_left++;                                                                           \
+    }                                                                                                 \
+    map->size--;                                                                                      \
+    return true;                                                                                      \
+}                                                                                                     \
+                                                                                                      \
+/* Check if a key exists in the map */                                                                \
+static inline bool name##_contains(const name##_t *map, key_type key) {                               \
+    return name##_get(map, key) != NULL;                                                              \
+}                                                                                                     \
+                                                                                                      \
+/* Get the number of key-value pairs in the map */                                                    \
+static inline size_t name##_size(const name##_t *map) {                                               \
+    return map ? map->size : 0;                                                                       \
+}                                                                                                     \
+                                                                                                      \
+/* Check if the map is empty */                                                                       \
+static inline bool name##_is_empty(const name##_t *map) {                                             \
+    return map ? map->size == 0 : true;                                                               \
+}                                                                                                     \
+                                                                                                      \
+/* Grow the slot array once so n_entries fit without further rehashes */                             \
+static inline bool name##_reserve(name##_t *map, size_t n_entries) {                                  \
+    if (!map) {                                                                                       \
+        return false;                                                                                 \
+    }                                                                                                 \
+    size_t capacity = hashmap_capacity_for_load(n_entries, HASHMAP_FLAT_MAX_LOAD_FACTOR);             \
+    if (capacity == SIZE_MAX) {                                                                       \
+        return false;                                                                                 \
+    }                                                                                                 \
+    capacity = hashmap_flat_round_capacity(capacity);                                                 \
+    while (hashmap_flat_load_limit(capacity, HASHMAP_FLAT_MAX_LOAD_FACTOR) < n_entries) {             \
+        if (capacity > SIZE_MAX / 2) {                                                                \
+            return false;                                                                             \
+        }                                                                                             \
+        capacity <<= 1;                                                                               \
+    }                                                                                                 \
+    return capacity <= map->capacity || name##_resize(map, capacity);                                 \
+}                                                                                                     \
+                                                                                                      \
+/* Call visit for every entry until it returns false; returns the number of                           \
+   entries visited. visit may modify the value but not the map */                                     \
+static inline size_t name##_foreach(name##_t *map,                                                    \
+                                    bool (*visit)(key_type key, value_type *value, void *ctx),        \
+                                    void *ctx) {                                                      \
+    if (!map || !visit) {                                                                             \
+        return 0;                                                                                     \
+    }                                                                                                 \
+    size_t visited = 0;                                                                               \
+    for (size_t base = 0; base < map->capacity; base += HASHMAP_FLAT_GROUP_WIDTH) {                   \
+        uint32_t full = hashmap_flat_match_full(map->ctrl + base);                                    \
+        while (full) {                                                                                \
+            name##_slot_t *slot = &map->slots[base + hashmap_flat_ctz(full)];                         \
+            full &= full - 1;                                                                         \
+            visited++;                                                                                \
+            if (!visit(slot->key, &slot->value, ctx)) {                                               \
+                return visited;                                                                       \
+            }                                                                                         \
+        }                                                                                             \
+    }                                                                                                 \
+    return visited;                                                                                   \
+}
+
+#endif // HASHMAP_TYPED_H
@@ -1,4 +1,5 @@
 #define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE  // MAP_ANONYMOUS for mapped tables
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,6 +8,17 @@
 #include <assert.h>
 #include <stdbool.h>
 #include "hashmap.h"
+#include "hashmap_flat.h"
+#include "hashmap_concurrent.h"
+#include "hashmap_rcu.h"
+#include "hashmap_sharded.h"
+#include "hashmap_parallel.h"
+#include "hashmap_typed.h"
+#include "hashmap_mapped.h"
+#include "hashmap_load.h"
+#include "hashmap_stats.h"
+#include "hashmap_compact.h"
+#include "hashmap_cow.h"
 
 // Test statistics
 static int tests_run = 0;
@@ -325,10 +337,11 @@ bool test_resize() {
     
     // Insert enough entries to trigger resize (load factor > 0.75)
     const int N = 20; // 20 > 16 * 0.75 = 12
+    int values[20];       // Values are stored by pointer, so each needs its own object
     for (int i = 0; i < N; i++) {
         int key = i;
-        int value = i;
-        ASSERT(hashmap_put(map, &key, sizeof(int), &value), "Put failed");
+        values[i] = i;
+        ASSERT(hashmap_put(map, &key, sizeof(int), &values[i]), "Put failed");
     }
     
     ASSERT(hashmap_size(map) == N, "Size should be N");
@@ -436,8 +449,10 @@ bool test_key_size_mismatch() {
     
     hashmap_put(map, &key, sizeof(int), &value);
     
-    // Try to get with wrong size
-    int *result = (int *)hashmap_get(map, &key, sizeof(int) + 1);
+    // Try to get with wrong size (the longer read stays inside a real buffer)
+    unsigned char padded[sizeof(int) + 1] = {0};
+    memcpy(padded, &key, sizeof(int));
+    int *result = (int *)hashmap_get(map, padded, sizeof(int) + 1);
     ASSERT(result == NULL, "Should not find key with wrong size");
     
     result = (int *)hashmap_get(map, &key, sizeof(int) - 1);
@@ -481,163 +496,3774 @@ bool test_default_capacity() {
 }
 
 // ============================================================================
-// Performance Tests
+// Flat Engine Tests
 // ============================================================================
 
-static double get_time_ms() {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+// Test 19: Flat engine basic operations
+bool test_flat_basic() {
+    TEST_START("Flat engine: basic operations");
+    
+    hashmap_flat_t *map = hashmap_flat_create(16, NULL, NULL);
+    ASSERT(map != NULL, "hashmap_flat_create failed");
+    ASSERT(hashmap_flat_is_empty(map), "Should be empty");
+    
+    int key = 42;
+    int value1 = 100;
+    int value2 = 200;
+    
+    ASSERT(hashmap_flat_put(map, &key, sizeof(int), &value1), "hashmap_flat_put failed");
+    ASSERT(hashmap_flat_put(map, &key, sizeof(int), &value2), "Update failed");
+    ASSERT(hashmap_flat_size(map) == 1, "Size should still be 1 after update");
+    
+    int *result = (int *)hashmap_flat_get(map, &key, sizeof(int));
+    ASSERT(result != NULL && *result == 200, "Value should be updated");
+    ASSERT(hashmap_flat_contains(map, &key, sizeof(int)), "Should contain key");
+    ASSERT(hashmap_flat_get(map, &key, sizeof(int) - 1) == NULL, "Should not find key with wrong size");
+    
+    ASSERT(hashmap_flat_remove(map, &key, sizeof(int)), "hashmap_flat_remove failed");
+    ASSERT(!hashmap_flat_remove(map, &key, sizeof(int)), "Second remove should fail");
+    ASSERT(hashmap_flat_get(map, &key, sizeof(int)) == NULL, "Key should not exist after remove");
+    ASSERT(hashmap_flat_size(map) == 0, "Size should be 0 after remove");
+    
+    // Invalid parameters
+    ASSERT(!hashmap_flat_put(NULL, &key, sizeof(int), &value1), "Should fail with NULL map");
+    ASSERT(!hashmap_flat_put(map, NULL, sizeof(int), &value1), "Should fail with NULL key");
+    ASSERT(!hashmap_flat_put(map, &key, 0, &value1), "Should fail with zero key_size");
+    
+    hashmap_flat_destroy(map);
+    hashmap_flat_destroy(NULL);
+    TEST_PASS();
+    return true;
 }
 
-// Performance test: Insert performance
-bool test_perf_insert() {
-    TEST_START("Performance: Insert");
+// Test 20: Flat engine growth and tombstone reuse
+bool test_flat_growth_and_removal() {
+    TEST_START("Flat engine: growth and removal");
     
-    hashmap_t *map = hashmap_create(16, NULL, NULL);
-    const int N = 100000;
+    hashmap_flat_t *map = hashmap_flat_create(4, NULL, NULL);
+    const int N = 10000;
+    
+    int *values = malloc(N * sizeof(int));
+    ASSERT(values != NULL, "Memory allocation failed");
     
-    double start = get_time_ms();
     for (int i = 0; i < N; i++) {
-        int key = i;
-        int value = i;
-        hashmap_put(map, &key, sizeof(int), &value);
+        values[i] = i * 3;
+        ASSERT(hashmap_flat_put(map, &i, sizeof(int), &values[i]), "Put failed");
     }
-    double end = get_time_ms();
+    ASSERT(hashmap_flat_size(map) == (size_t)N, "Size should be N");
     
-    double time_ms = end - start;
-    double ops_per_sec = (N / time_ms) * 1000.0;
+    // Remove every other key, then churn to exercise tombstones
+    for (int i = 0; i < N; i += 2) {
+        ASSERT(hashmap_flat_remove(map, &i, sizeof(int)), "Remove failed");
+    }
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < N; i += 2) {
+            ASSERT(hashmap_flat_put(map, &i, sizeof(int), &values[i]), "Reinsert failed");
+        }
+        for (int i = 0; i < N; i += 2) {
+            ASSERT(hashmap_flat_remove(map, &i, sizeof(int)), "Remove failed");
+        }
+    }
+    ASSERT(hashmap_flat_size(map) == (size_t)N / 2, "Size should be N/2");
     
-    printf("  Inserted %d entries in %.2f ms (%.0f ops/sec)\n", 
-           N, time_ms, ops_per_sec);
+    for (int i = 0; i < N; i++) {
+        int *result = (int *)hashmap_flat_get(map, &i, sizeof(int));
+        if (i % 2 == 0) {
+            ASSERT(result == NULL, "Removed key should not exist");
+        } else {
+            ASSERT(result != NULL && *result == i * 3, "Value mismatch");
+        }
+    }
     
-    hashmap_destroy(map);
+    hashmap_flat_destroy(map);
+    free(values);
     TEST_PASS();
     return true;
 }
 
-// Performance test: Lookup performance
-bool test_perf_lookup() {
-    TEST_START("Performance: Lookup");
+// Test 21: Flat engine long keys and value cleanup
+bool test_flat_long_keys_cleanup() {
+    TEST_START("Flat engine: long keys and value_free");
     
-    hashmap_t *map = hashmap_create(16, NULL, NULL);
-    const int N = 100000;
-    const int LOOKUPS = 1000000;
+    hashmap_flat_t *map = hashmap_flat_create(0, NULL, free);
+    
+    char key[64];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "a_rather_long_key_that_is_not_inline_%d", i);
+        ASSERT(hashmap_flat_put(map, key, strlen(key) + 1, strdup(key)), "Put failed");
+    }
+    
+    // Update frees the old value
+    snprintf(key, sizeof(key), "a_rather_long_key_that_is_not_inline_%d", 7);
+    ASSERT(hashmap_flat_put(map, key, strlen(key) + 1, strdup("updated")), "Update failed");
+    ASSERT(strcmp((char *)hashmap_flat_get(map, key, strlen(key) + 1), "updated") == 0,
+           "Value should be updated");
+    
+    snprintf(key, sizeof(key), "a_rather_long_key_that_is_not_inline_%d", 150);
+    char *result = (char *)hashmap_flat_get(map, key, strlen(key) + 1);
+    ASSERT(result != NULL && strcmp(result, key) == 0, "Value mismatch");
+    
+    hashmap_flat_clear(map);
+    ASSERT(hashmap_flat_is_empty(map), "Should be empty after clear");
+    ASSERT(hashmap_flat_get(map, key, strlen(key) + 1) == NULL, "Key should not exist after clear");
+    
+    hashmap_flat_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Test 22: Long keys survive repeated resizes
+bool test_resize_long_keys() {
+    TEST_START("Resize with long string keys");
+    
+    hashmap_t *map = hashmap_create(2, NULL, NULL);
+    const int N = 2000;
+    char key[96];
     
-    // Insert N entries
     for (int i = 0; i < N; i++) {
-        int key = i;
-        int value = i;
-        hashmap_put(map, &key, sizeof(int), &value);
+        snprintf(key, sizeof(key), "session/%08d/a-fairly-long-suffix-to-make-hashing-expensive", i);
+        ASSERT(hashmap_put(map, key, strlen(key) + 1, (void *)(intptr_t)(i + 1)), "Put failed");
     }
+    ASSERT(hashmap_size(map) == (size_t)N, "Size should be N");
     
-    // Perform lookups
-    double start = get_time_ms();
-    int found = 0;
-    for (int i = 0; i < LOOKUPS; i++) {
-        int key = i % N;
-        int *result = (int *)hashmap_get(map, &key, sizeof(int));
-        if (result != NULL) found++;
+    for (int i = 0; i < N; i++) {
+        snprintf(key, sizeof(key), "session/%08d/a-fairly-long-suffix-to-make-hashing-expensive", i);
+        ASSERT((intptr_t)hashmap_get(map, key, strlen(key) + 1) == i + 1, "Value mismatch after resize");
+        if (i % 3 == 0) {
+            ASSERT(hashmap_remove(map, key, strlen(key) + 1), "Remove failed");
+        }
     }
-    double end = get_time_ms();
     
-    double time_ms = end - start;
-    double ops_per_sec = (LOOKUPS / time_ms) * 1000.0;
+    snprintf(key, sizeof(key), "session/%08d/a-fairly-long-suffix-to-make-hashing-expensive", 3);
+    ASSERT(!hashmap_contains(map, key, strlen(key) + 1), "Removed key should not exist");
+    snprintf(key, sizeof(key), "session/%08d/a-fairly-long-suffix-to-make-hashing-expensive", 4);
+    ASSERT(hashmap_contains(map, key, strlen(key) + 1), "Remaining key should exist");
     
-    printf("  Performed %d lookups in %.2f ms (%.0f ops/sec, %d found)\n", 
-           LOOKUPS, time_ms, ops_per_sec, found);
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Test 23: Capacities are rounded to powers of two
+bool test_capacity_rounding() {
+    TEST_START("Power-of-two capacity rounding");
+    
+    hashmap_t *map = hashmap_create(100, NULL, NULL);
+    ASSERT(map != NULL, "hashmap_create failed");
+    ASSERT(map->capacity == 128, "Capacity should round up to 128");
+    hashmap_destroy(map);
+    
+    map = hashmap_create(64, NULL, NULL);
+    ASSERT(map->capacity == 64, "Power-of-two capacity should be kept");
+    
+    // Sequential integer keys must still spread across buckets after masking
+    for (int i = 0; i < 48; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(int), (void *)(intptr_t)(i + 1)), "Put failed");
+    }
+    ASSERT(map->capacity == 64, "Should not have resized yet");
+    size_t used = 0;
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->buckets[i]) used++;
+    }
+    ASSERT(used >= 24, "Keys should spread over many buckets");
+    
+    ASSERT(hashmap_put(map, &(int){48}, sizeof(int), (void *)(intptr_t)49), "Put failed");
+    ASSERT(map->capacity == 128, "Should double to the next power of two");
+    for (int i = 0; i <= 48; i++) {
+        ASSERT((intptr_t)hashmap_get(map, &i, sizeof(int)) == i + 1, "Value mismatch");
+    }
     
     hashmap_destroy(map);
     TEST_PASS();
     return true;
 }
 
-// Performance test: Mixed operations
-bool test_perf_mixed() {
-    TEST_START("Performance: Mixed operations");
+// Degenerate hash used to force every key into one chain / probe sequence
+static size_t constant_hash(const void *key, size_t key_size) {
+    (void)key;
+    (void)key_size;
+    return 7;
+}
+
+// Test 24: Hash function selection
+bool test_hash_selection() {
+    TEST_START("Hash function selection");
+    
+    hashmap_options_t options = {0};
+    options.hash_func = hashmap_fnv1a_hash;
+    hashmap_t *fnv_map = hashmap_create_ex(&options);
+    ASSERT(fnv_map != NULL, "hashmap_create_ex failed");
+    ASSERT(fnv_map->capacity == 16, "Zeroed options should use the default capacity");
+    
+    options.hash_func = constant_hash;
+    hashmap_t *bad_map = hashmap_create_ex(&options);
+    hashmap_flat_t *bad_flat = hashmap_flat_create_ex(&options);
+    hashmap_t *default_map = hashmap_create_ex(NULL);
+    ASSERT(bad_map && bad_flat && default_map, "Creation failed");
+    
+    for (int i = 0; i < 500; i++) {
+        void *value = (void *)(intptr_t)(i + 1);
+        ASSERT(hashmap_put(fnv_map, &i, sizeof(int), value), "FNV put failed");
+        ASSERT(hashmap_put(bad_map, &i, sizeof(int), value), "Colliding put failed");
+        ASSERT(hashmap_flat_put(bad_flat, &i, sizeof(int), value), "Colliding flat put failed");
+        ASSERT(hashmap_put(default_map, &i, sizeof(int), value), "Default put failed");
+    }
+    for (int i = 0; i < 500; i += 2) {
+        ASSERT(hashmap_remove(bad_map, &i, sizeof(int)), "Colliding remove failed");
+        ASSERT(hashmap_flat_remove(bad_flat, &i, sizeof(int)), "Colliding flat remove failed");
+    }
+    for (int i = 0; i < 500; i++) {
+        intptr_t expected = i + 1;
+        ASSERT((intptr_t)hashmap_get(fnv_map, &i, sizeof(int)) == expected, "FNV value mismatch");
+        ASSERT((intptr_t)hashmap_get(default_map, &i, sizeof(int)) == expected, "Default value mismatch");
+        expected = (i % 2) ? i + 1 : 0;
+        ASSERT((intptr_t)hashmap_get(bad_map, &i, sizeof(int)) == expected, "Colliding value mismatch");
+        ASSERT((intptr_t)hashmap_flat_get(bad_flat, &i, sizeof(int)) == expected, "Colliding flat value mismatch");
+    }
+    
+    // Built-in hash: deterministic, length-sensitive, and spreads low bits
+    const char text[] = "the quick brown fox jumps over the lazy dog, twice over";
+    ASSERT(hashmap_generic_hash(text, sizeof(text)) == hashmap_generic_hash(text, sizeof(text)),
+           "Hash should be deterministic");
+    for (size_t len = 1; len < sizeof(text); len++) {
+        ASSERT(hashmap_wyhash(text, len) != hashmap_wyhash(text, len - 1) || len == 1,
+               "Prefixes should hash differently");
+    }
+    size_t low_bits_seen[64] = {0};
+    for (int i = 0; i < 4096; i++) {
+        low_bits_seen[hashmap_generic_hash(&i, sizeof(int)) & 63]++;
+    }
+    for (int i = 0; i < 64; i++) {
+        ASSERT(low_bits_seen[i] > 16 && low_bits_seen[i] < 128, "Low bits should be uniform");
+    }
+    
+    hashmap_destroy(fnv_map);
+    hashmap_destroy(bad_map);
+    hashmap_flat_destroy(bad_flat);
+    hashmap_destroy(default_map);
+    TEST_PASS();
+    return true;
+}
+
+// Test 25: Keys are copied into the entry allocation
+bool test_inline_key_storage() {
+    TEST_START("Inline key storage");
     
     hashmap_t *map = hashmap_create(16, NULL, NULL);
-    const int N = 50000;
-    const int OPS = 200000;
     
-    double start = get_time_ms();
-    for (int i = 0; i < OPS; i++) {
-        int key = i % N;
-        int value = i;
-        
-        if (i % 3 == 0) {
-            // Insert
-            hashmap_put(map, &key, sizeof(int), &value);
-        } else if (i % 3 == 1) {
-            // Lookup
-            hashmap_get(map, &key, sizeof(int));
-        } else {
-            // Remove
-            hashmap_remove(map, &key, sizeof(int));
+    char key[32];
+    snprintf(key, sizeof(key), "user:%d", 1234);
+    size_t key_size = strlen(key) + 1;
+    ASSERT(hashmap_put(map, key, key_size, "alice"), "Put failed");
+    
+    // The map must not depend on the caller's buffer
+    memset(key, 'x', sizeof(key) - 1);
+    ASSERT(hashmap_get(map, key, key_size) == NULL, "Mutated buffer should not match");
+    
+    const char *lookup = "user:1234";
+    char *result = (char *)hashmap_get(map, lookup, strlen(lookup) + 1);
+    ASSERT(result != NULL && strcmp(result, "alice") == 0, "Copied key should still match");
+    
+    // The key bytes live directly after the entry header
+    size_t index = hashmap_bucket_index(hashmap_hash_key(NULL, lookup, strlen(lookup) + 1), map->capacity);
+    hashmap_entry_t *entry = map->buckets[index];
+    ASSERT(entry != NULL, "Entry should be in its bucket");
+    ASSERT((void *)entry->key == (void *)((char *)entry + sizeof(hashmap_entry_t)),
+           "Key should be stored inline");
+    ASSERT(memcmp(entry->key, lookup, entry->key_size) == 0, "Inline key mismatch");
+    
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Allocator hooks that track outstanding allocations
+typedef struct {
+    size_t allocs;
+    size_t frees;
+    size_t live_bytes;
+} alloc_counter_t;
+
+static void *counting_alloc(size_t size, void *ctx) {
+    alloc_counter_t *counter = (alloc_counter_t *)ctx;
+    counter->allocs++;
+    counter->live_bytes += size;
+    return malloc(size);
+}
+
+static void counting_dealloc(void *ptr, size_t size, void *ctx) {
+    alloc_counter_t *counter = (alloc_counter_t *)ctx;
+    counter->frees++;
+    counter->live_bytes -= size;
+    free(ptr);
+}
+
+// Test 26: Custom allocator hooks
+bool test_custom_allocator() {
+    TEST_START("Custom allocator hooks");
+    
+    alloc_counter_t counter = {0, 0, 0};
+    hashmap_options_t options = {0};
+    options.allocator.alloc = counting_alloc;
+    options.allocator.dealloc = counting_dealloc;
+    options.allocator.ctx = &counter;
+    
+    hashmap_t *map = hashmap_create_ex(&options);
+    ASSERT(map != NULL, "hashmap_create_ex failed");
+    ASSERT(counter.allocs == 2, "Map and bucket array should use the hooks");
+    
+    for (int i = 0; i < 1000; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(int), (void *)(intptr_t)(i + 1)), "Put failed");
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        ASSERT(hashmap_remove(map, &i, sizeof(int)), "Remove failed");
+    }
+    ASSERT((intptr_t)hashmap_get(map, &(int){999}, sizeof(int)) == 1000, "Value mismatch");
+    ASSERT(counter.allocs > 1000, "Entries and resized buckets should use the hooks");
+    
+    hashmap_destroy(map);
+    ASSERT(counter.allocs == counter.frees, "Every allocation should be released");
+    ASSERT(counter.live_bytes == 0, "Sizes passed to dealloc should match alloc");
+    
+    // The flat engine takes the same hooks for its map, tables and long keys
+    counter = (alloc_counter_t){0, 0, 0};
+    hashmap_flat_t *flat = hashmap_flat_create_ex(&options);
+    ASSERT(flat != NULL && counter.allocs == 3, "Flat map and both arrays should use the hooks");
+    char long_key[64];
+    memset(long_key, 'k', sizeof(long_key));
+    for (int i = 0; i < 1000; i++) {
+        memcpy(long_key, &i, sizeof(i));
+        ASSERT(hashmap_flat_put(flat, long_key, sizeof(long_key), NULL), "Flat put failed");
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        memcpy(long_key, &i, sizeof(i));
+        ASSERT(hashmap_flat_remove(flat, long_key, sizeof(long_key)), "Flat remove failed");
+    }
+    ASSERT(counter.allocs > 1000, "Long keys and resized tables should use the hooks");
+    hashmap_flat_destroy(flat);
+    ASSERT(counter.allocs == counter.frees && counter.live_bytes == 0, "Flat allocations should all be released");
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 27: Entry pool with free-list reuse
+bool test_entry_pool() {
+    TEST_START("Entry pool");
+    
+    alloc_counter_t counter = {0, 0, 0};
+    hashmap_options_t options = {0};
+    options.initial_capacity = 4096;
+    options.allocator.alloc = counting_alloc;
+    options.allocator.dealloc = counting_dealloc;
+    options.allocator.ctx = &counter;
+    options.entry_pool = true;
+    options.value_free = free;
+    
+    hashmap_t *map = hashmap_create_ex(&options);
+    ASSERT(map != NULL, "hashmap_create_ex failed");
+    
+    const int N = 2000;
+    for (int i = 0; i < N; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(int), strdup("pooled")), "Put failed");
+    }
+    size_t allocs_after_insert = counter.allocs;
+    ASSERT(allocs_after_insert < 2 + (size_t)N / 100, "Entries should come from a few slabs");
+    
+    // Removed slots are reused without touching the allocator
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < N; i += 2) {
+            ASSERT(hashmap_remove(map, &i, sizeof(int)), "Remove failed");
+        }
+        for (int i = 0; i < N; i += 2) {
+            ASSERT(hashmap_put(map, &i, sizeof(int), strdup("again")), "Reinsert failed");
         }
     }
-    double end = get_time_ms();
+    ASSERT(counter.allocs == allocs_after_insert, "Churn should be served by the free list");
     
-    double time_ms = end - start;
-    double ops_per_sec = (OPS / time_ms) * 1000.0;
+    // Keys larger than the pool limit fall back to the allocator
+    char long_key[HASHMAP_POOL_DEFAULT_KEY_SIZE + 16];
+    memset(long_key, 'k', sizeof(long_key));
+    ASSERT(hashmap_put(map, long_key, sizeof(long_key), strdup("large")), "Large key put failed");
+    ASSERT(counter.allocs == allocs_after_insert + 1, "Large key should be allocated separately");
+    ASSERT(strcmp((char *)hashmap_get(map, long_key, sizeof(long_key)), "large") == 0, "Large key mismatch");
+    ASSERT(strcmp((char *)hashmap_get(map, &(int){10}, sizeof(int)), "again") == 0, "Pooled value mismatch");
+    ASSERT(hashmap_size(map) == (size_t)N + 1, "Size mismatch");
     
-    printf("  Performed %d mixed operations in %.2f ms (%.0f ops/sec)\n", 
-           OPS, time_ms, ops_per_sec);
+    // Clear releases slabs in bulk and the pool is usable afterwards
+    hashmap_clear(map);
+    ASSERT(counter.live_bytes == map->capacity * sizeof(hashmap_entry_t *) + sizeof(hashmap_t),
+           "Clear should release every entry and slab");
+    ASSERT(hashmap_put(map, &(int){5}, sizeof(int), strdup("fresh")), "Put after clear failed");
+    ASSERT(strcmp((char *)hashmap_get(map, &(int){5}, sizeof(int)), "fresh") == 0, "Value mismatch");
     
     hashmap_destroy(map);
+    ASSERT(counter.live_bytes == 0 && counter.allocs == counter.frees, "Destroy should release everything");
+    
     TEST_PASS();
     return true;
 }
 
-// Performance test: Resize overhead
-bool test_perf_resize() {
-    TEST_START("Performance: Resize overhead");
+// Test 28: Reserve and shrink_to_fit
+bool test_reserve_and_shrink() {
+    TEST_START("Reserve and shrink_to_fit");
     
     hashmap_t *map = hashmap_create(16, NULL, NULL);
-    const int N = 100000;
+    const int N = 10000;
+    
+    ASSERT(hashmap_reserve(map, N), "hashmap_reserve failed");
+    size_t reserved = map->capacity;
+    ASSERT(reserved == hashmap_capacity_for(N), "Capacity should be sized in one step");
+    ASSERT(reserved * 3 / 4 >= (size_t)N, "Reserved capacity should hold N at 0.75 load");
     
-    double start = get_time_ms();
     for (int i = 0; i < N; i++) {
-        int key = i;
-        int value = i;
-        hashmap_put(map, &key, sizeof(int), &value);
+        ASSERT(hashmap_put(map, &i, sizeof(int), (void *)(intptr_t)(i + 1)), "Put failed");
     }
-    double end = get_time_ms();
+    ASSERT(map->capacity == reserved, "No resize should happen within the reservation");
     
-    double time_ms = end - start;
-    printf("  Inserted %d entries (with resizing) in %.2f ms\n", N, time_ms);
-    printf("  Final size: %zu\n", hashmap_size(map));
+    ASSERT(hashmap_reserve(map, 10), "Smaller reservation should succeed");
+    ASSERT(map->capacity == reserved, "Reserve should never shrink");
+    
+    // Mass removal, then reclaim bucket memory
+    for (int i = 100; i < N; i++) {
+        ASSERT(hashmap_remove(map, &i, sizeof(int)), "Remove failed");
+    }
+    ASSERT(hashmap_shrink_to_fit(map), "hashmap_shrink_to_fit failed");
+    ASSERT(map->capacity == 256, "100 entries should fit in 256 buckets");
+    for (int i = 0; i < 100; i++) {
+        ASSERT((intptr_t)hashmap_get(map, &i, sizeof(int)) == i + 1, "Value mismatch after shrink");
+    }
     
+    hashmap_clear(map);
+    ASSERT(hashmap_shrink_to_fit(map), "Shrinking an empty map failed");
+    ASSERT(map->capacity == HASHMAP_DEFAULT_CAPACITY, "Empty map should shrink to the default capacity");
+    ASSERT(!hashmap_reserve(NULL, 1) && !hashmap_shrink_to_fit(NULL), "NULL map should fail");
     hashmap_destroy(map);
+    
+    // Flat engine counterparts
+    hashmap_flat_t *flat = hashmap_flat_create(16, NULL, NULL);
+    ASSERT(hashmap_flat_reserve(flat, N), "hashmap_flat_reserve failed");
+    reserved = flat->capacity;
+    for (int i = 0; i < N; i++) {
+        ASSERT(hashmap_flat_put(flat, &i, sizeof(int), (void *)(intptr_t)(i + 1)), "Flat put failed");
+    }
+    ASSERT(flat->capacity == reserved, "No flat rehash should happen within the reservation");
+    for (int i = 50; i < N; i++) {
+        ASSERT(hashmap_flat_remove(flat, &i, sizeof(int)), "Flat remove failed");
+    }
+    ASSERT(hashmap_flat_shrink_to_fit(flat), "hashmap_flat_shrink_to_fit failed");
+    ASSERT(flat->capacity == 64, "50 entries should fit in 64 slots");
+    for (int i = 0; i < 50; i++) {
+        ASSERT((intptr_t)hashmap_flat_get(flat, &i, sizeof(int)) == i + 1, "Flat value mismatch after shrink");
+    }
+    hashmap_flat_destroy(flat);
+    
     TEST_PASS();
     return true;
 }
 
-// Performance test: String keys
-bool test_perf_string_keys() {
-    TEST_START("Performance: String keys");
+// Test 29: Incremental resize keeps both tables consistent
+bool test_incremental_resize() {
+    TEST_START("Incremental resize");
+    
+    hashmap_options_t options = {0};
+    options.initial_capacity = 1024;
+    options.incremental_resize = true;
+    hashmap_t *map = hashmap_create_ex(&options);
+    ASSERT(map != NULL, "hashmap_create_ex failed");
+    
+    // Fill to the threshold; the next insert starts a migration
+    int n = 0;
+    for (; n < 768; n++) {
+        ASSERT(hashmap_put(map, &n, sizeof(int), (void *)(intptr_t)(n + 1)), "Put failed");
+    }
+    ASSERT(map->old_buckets == NULL, "No migration before the threshold");
+    ASSERT(hashmap_put(map, &n, sizeof(int), (void *)(intptr_t)(n + 1)), "Put failed");
+    n++;
+    ASSERT(map->old_buckets != NULL, "Growth should start an incremental migration");
+    ASSERT(map->capacity == 2048 && map->old_capacity == 1024, "Capacities mismatch");
+    ASSERT(map->migrate_index == 0, "Migration should not have progressed yet");
+    
+    // Lookups see entries in either table
+    for (int i = 0; i < n; i++) {
+        ASSERT((intptr_t)hashmap_get(map, &i, sizeof(int)) == i + 1, "Lookup during migration failed");
+    }
+    
+    // Updates and removals reach entries that are still in the old table
+    int key = 1000;
+    ASSERT(hashmap_put(map, &(int){700}, sizeof(int), (void *)(intptr_t)7000), "Update failed");
+    ASSERT(hashmap_remove(map, &(int){701}, sizeof(int)), "Remove from old table failed");
+    ASSERT(hashmap_put(map, &key, sizeof(int), (void *)(intptr_t)(key + 1)), "Put during migration failed");
+    ASSERT(map->old_buckets != NULL && map->migrate_index > 0, "Migration should advance per operation");
+    ASSERT(hashmap_size(map) == (size_t)n, "Size should count both tables");
+    
+    // Keep operating until the migration drains
+    int steps = 0;
+    while (map->old_buckets && steps < 1000) {
+        int k = 5000 + steps;
+        ASSERT(hashmap_put(map, &k, sizeof(int), (void *)(intptr_t)(k + 1)), "Put failed");
+        steps++;
+    }
+    ASSERT(map->old_buckets == NULL, "Migration should finish within bounded steps");
+    ASSERT(steps <= 1024 / HASHMAP_MIGRATE_BUCKETS, "Each operation should migrate a fixed batch");
+    
+    ASSERT((intptr_t)hashmap_get(map, &(int){700}, sizeof(int)) == 7000, "Updated value lost");
+    ASSERT(hashmap_get(map, &(int){701}, sizeof(int)) == NULL, "Removed key reappeared");
+    for (int i = 0; i < n; i++) {
+        if (i == 700 || i == 701) continue;
+        ASSERT((intptr_t)hashmap_get(map, &i, sizeof(int)) == i + 1, "Lookup after migration failed");
+    }
+    
+    // Clear and destroy in the middle of a migration
+    for (int i = 0; i < 100000; i++) {
+        hashmap_put(map, &i, sizeof(int), map);
+    }
+    ASSERT(hashmap_size(map) == 100000, "Earlier keys should have been updated, not duplicated");
+    hashmap_clear(map);
+    ASSERT(hashmap_is_empty(map) && map->old_buckets == NULL, "Clear should drop both tables");
+    for (int i = 0; i < 5000; i++) {
+        hashmap_put(map, &i, sizeof(int), map);
+    }
+    hashmap_destroy(map);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 30: Batched lookups and inserts
+bool test_batch_operations() {
+    TEST_START("Batch get and put");
     
     hashmap_t *map = hashmap_create(16, NULL, NULL);
-    const int N = 10000;
+    const int N = 1000;
+    
+    int *keys = malloc((N + 1) * sizeof(int));
+    const void **key_ptrs = malloc((N + 1) * sizeof(void *));
+    size_t *key_sizes = malloc((N + 1) * sizeof(size_t));
+    void **values = malloc((N + 1) * sizeof(void *));
+    ASSERT(keys && key_ptrs && key_sizes && values, "Memory allocation failed");
     
-    char keys[10000][32];
     for (int i = 0; i < N; i++) {
-        snprintf(keys[i], sizeof(keys[i]), "key_%d", i);
+        keys[i] = i;
+        key_ptrs[i] = &keys[i];
+        key_sizes[i] = sizeof(int);
+        values[i] = (void *)(intptr_t)(i + 1);
     }
+    // The final pair duplicates key 0 and must win
+    keys[N] = 0;
+    key_ptrs[N] = &keys[N];
+    key_sizes[N] = sizeof(int);
+    values[N] = (void *)(intptr_t)-1;
     
-    double start = get_time_ms();
+    ASSERT(hashmap_put_batch(map, key_ptrs, key_sizes, (void *const *)values, N + 1), "hashmap_put_batch failed");
+    ASSERT(hashmap_size(map) == (size_t)N, "Duplicates should update, not insert");
+    ASSERT((intptr_t)hashmap_get(map, &(int){0}, sizeof(int)) == -1, "Later duplicate should win");
+    
+    // Mix hits, misses and invalid entries
     for (int i = 0; i < N; i++) {
-        hashmap_put(map, keys[i], strlen(keys[i]) + 1, "value");
+        keys[i] = (i % 4 == 3) ? N + i : i;
     }
-    double end = get_time_ms();
+    key_ptrs[5] = NULL;
+    key_sizes[9] = 0;
+    void **out = malloc(N * sizeof(void *));
+    ASSERT(out != NULL, "Memory allocation failed");
     
-    double time_ms = end - start;
-    double ops_per_sec = (N / time_ms) * 1000.0;
+    size_t found = hashmap_get_batch(map, key_ptrs, key_sizes, N, out);
+    size_t expected_found = 0;
+    for (int i = 0; i < N; i++) {
+        if (i == 5 || i == 9 || i % 4 == 3) {
+            ASSERT(out[i] == NULL, "Misses and invalid keys should yield NULL");
+        } else {
+            intptr_t expected = i == 0 ? -1 : i + 1;
+            ASSERT((intptr_t)out[i] == expected, "Batch lookup value mismatch");
+            expected_found++;
+        }
+    }
+    ASSERT(found == expected_found, "Found count mismatch");
     
-    printf("  Inserted %d string keys in %.2f ms (%.0f ops/sec)\n", 
-           N, time_ms, ops_per_sec);
+    // Invalid entries make put_batch report failure but the rest still land
+    key_ptrs[5] = &keys[5];
+    keys[5] = 123456;
+    ASSERT(!hashmap_put_batch(map, key_ptrs, key_sizes, (void *const *)values, 16), "Zero key_size should fail");
+    ASSERT(hashmap_contains(map, &(int){123456}, sizeof(int)), "Valid pairs should still be inserted");
+    ASSERT(hashmap_get_batch(NULL, key_ptrs, key_sizes, N, out) == 0, "NULL map should find nothing");
+    
+    free(keys);
+    free(key_ptrs);
+    free(key_sizes);
+    free(values);
+    free(out);
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Test 31: Load factor and growth factor options
+bool test_load_and_growth_factor() {
+    TEST_START("Load and growth factor options");
+    
+    // Dense chains: grow at 4 entries per bucket, quadrupling each time
+    hashmap_options_t options = {0};
+    options.initial_capacity = 16;
+    options.max_load_factor = 4.0;
+    options.growth_factor = 4;
+    hashmap_t *map = hashmap_create_ex(&options);
+    ASSERT(map != NULL, "hashmap_create_ex failed");
+    
+    for (int i = 0; i < 63; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(int), (void *)(intptr_t)(i + 1)), "Put failed");
+    }
+    ASSERT(map->capacity == 16, "63 entries should fit 16 buckets at load 4.0");
+    ASSERT(hashmap_put(map, &(int){63}, sizeof(int), (void *)(intptr_t)64), "Put failed");
+    ASSERT(hashmap_put(map, &(int){64}, sizeof(int), (void *)(intptr_t)65), "Put failed");
+    ASSERT(map->capacity == 64, "Growth factor 4 should quadruple the capacity");
+    for (int i = 0; i < 65; i++) {
+        ASSERT((intptr_t)hashmap_get(map, &i, sizeof(int)) == i + 1, "Value mismatch after growth");
+    }
+    
+    // Reserve and shrink honor the configured load factor
+    ASSERT(hashmap_reserve(map, 1000), "hashmap_reserve failed");
+    ASSERT(map->capacity == 256, "1000 entries need 256 buckets at load 4.0");
+    ASSERT(hashmap_shrink_to_fit(map), "hashmap_shrink_to_fit failed");
+    ASSERT(map->capacity == 32, "65 entries need 32 buckets at load 4.0");
+    hashmap_destroy(map);
+    
+    // Sparse table; growth factor 3 rounds up to 4 and invalid load falls back
+    options.max_load_factor = 0.25;
+    options.growth_factor = 3;
+    map = hashmap_create_ex(&options);
+    for (int i = 0; i < 5; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(int), NULL), "Put failed");
+    }
+    ASSERT(map->capacity == 64, "Fifth entry should grow past load 0.25");
+    hashmap_destroy(map);
     
+    options.max_load_factor = -1.0;
+    options.growth_factor = 0;
+    map = hashmap_create_ex(&options);
+    ASSERT(map->max_load_factor == HASHMAP_DEFAULT_MAX_LOAD_FACTOR, "Invalid load factor should use the default");
     hashmap_destroy(map);
+    
+    // Flat engine: lower load grows earlier, higher requests are capped
+    options.max_load_factor = 0.5;
+    options.growth_factor = 2;
+    hashmap_flat_t *flat = hashmap_flat_create_ex(&options);
+    for (int i = 0; i < 9; i++) {
+        ASSERT(hashmap_flat_put(flat, &i, sizeof(int), (void *)(intptr_t)(i + 1)), "Flat put failed");
+    }
+    ASSERT(flat->capacity == 32, "Ninth entry should grow past flat load 0.5");
+    for (int i = 0; i < 9; i++) {
+        ASSERT((intptr_t)hashmap_flat_get(flat, &i, sizeof(int)) == i + 1, "Flat value mismatch");
+    }
+    hashmap_flat_destroy(flat);
+    
+    options.max_load_factor = 1.0;
+    flat = hashmap_flat_create_ex(&options);
+    ASSERT(flat->max_load_factor == HASHMAP_FLAT_MAX_LOAD_FACTOR, "Flat load factor should be capped");
+    hashmap_flat_destroy(flat);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 32: Concurrent hashmap under parallel writers and readers
+typedef struct {
+    hashmap_concurrent_t *map;
+    int first;
+    int count;
+    bool ok;
+} concurrent_worker_t;
+
+static void *concurrent_writer(void *arg) {
+    concurrent_worker_t *w = arg;
+    w->ok = true;
+    for (int i = w->first; i < w->first + w->count; i++) {
+        if (!hashmap_concurrent_put(w->map, &i, sizeof(int), (void *)(intptr_t)(i + 1))) {
+            w->ok = false;
+        }
+    }
+    // Remove every other key again so removals race with inserts elsewhere
+    for (int i = w->first; i < w->first + w->count; i += 2) {
+        if (!hashmap_concurrent_remove(w->map, &i, sizeof(int))) {
+            w->ok = false;
+        }
+    }
+    return NULL;
+}
+
+static void *concurrent_reader(void *arg) {
+    concurrent_worker_t *w = arg;
+    w->ok = true;
+    for (int round = 0; round < 4; round++) {
+        for (int i = w->first; i < w->first + w->count; i++) {
+            void *value = hashmap_concurrent_get(w->map, &i, sizeof(int));
+            if (value && (intptr_t)value != i + 1) {
+                w->ok = false;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Rewrites 16 two-word values whose halves always match, until told to stop
+typedef struct {
+    hashmap_concurrent_t *map;
+    _Atomic bool *stop;
+    bool ok;
+} concurrent_pair_writer_t;
+
+static void *concurrent_pair_writer(void *arg) {
+    concurrent_pair_writer_t *w = arg;
+    w->ok = true;
+    for (uint64_t v = 0; !atomic_load(w->stop); v++) {
+        int key = (int)(v % 16);
+        uint64_t pair[2] = {v, v};
+        if (!hashmap_concurrent_put(w->map, &key, sizeof(key), pair)) {
+            w->ok = false;
+        }
+    }
+    return NULL;
+}
+
+bool test_concurrent_map() {
+    TEST_START("Concurrent hashmap");
+    
+    enum { WRITERS = 4, READERS = 4, PER_WRITER = 20000 };
+    hashmap_options_t options = {0};
+    options.concurrency = 8;
+    hashmap_concurrent_t *map = hashmap_concurrent_create_ex(&options);
+    ASSERT(map != NULL, "hashmap_concurrent_create_ex failed");
+    ASSERT(map->segment_count == 8, "Segment count should follow the options");
+    
+    pthread_t threads[WRITERS + READERS];
+    concurrent_worker_t workers[WRITERS + READERS];
+    for (int t = 0; t < WRITERS + READERS; t++) {
+        workers[t].map = map;
+        workers[t].first = (t % WRITERS) * PER_WRITER;
+        workers[t].count = PER_WRITER;
+        ASSERT(pthread_create(&threads[t], NULL, t < WRITERS ? concurrent_writer : concurrent_reader,
+                              &workers[t]) == 0, "pthread_create failed");
+    }
+    for (int t = 0; t < WRITERS + READERS; t++) {
+        pthread_join(threads[t], NULL);
+        ASSERT(workers[t].ok, t < WRITERS ? "Writer operation failed" : "Reader saw a wrong value");
+    }
+    
+    ASSERT(hashmap_concurrent_size(map) == WRITERS * PER_WRITER / 2, "Size mismatch after concurrent writes");
+    for (int i = 0; i < WRITERS * PER_WRITER; i++) {
+        void *value = hashmap_concurrent_get(map, &i, sizeof(int));
+        if (i % 2 == 0) {
+            ASSERT(value == NULL, "Removed key still present");
+        } else {
+            ASSERT((intptr_t)value == i + 1, "Value mismatch after concurrent writes");
+        }
+    }
+    
+    // Every segment grew independently
+    for (size_t i = 0; i < map->segment_count; i++) {
+        ASSERT(map->segments[i].map->capacity > HASHMAP_DEFAULT_CAPACITY, "Segment should have grown");
+    }
+    
+    hashmap_concurrent_clear(map);
+    ASSERT(hashmap_concurrent_is_empty(map), "Map should be empty after clear");
+    ASSERT(!hashmap_concurrent_put(NULL, &(int){1}, sizeof(int), NULL), "NULL map should fail");
+    ASSERT(hashmap_concurrent_get(map, NULL, sizeof(int)) == NULL, "NULL key should fail");
+    hashmap_concurrent_destroy(map);
+    
+    // Single segment still works
+    options.concurrency = 1;
+    map = hashmap_concurrent_create_ex(&options);
+    ASSERT(map != NULL && map->segment_bits == 0, "Single segment map failed");
+    ASSERT(hashmap_concurrent_put(map, "key", 3, (void *)(intptr_t)7), "Put failed");
+    ASSERT((intptr_t)hashmap_concurrent_get(map, "key", 3) == 7, "Get failed");
+    void *copied = NULL;
+    ASSERT(hashmap_concurrent_get_copy(map, "key", 3, &copied) && (intptr_t)copied == 7, "Pointer copy failed");
+    ASSERT(!hashmap_concurrent_get_copy(map, "nope", 4, &copied), "Copy of a missing key should fail");
+    hashmap_concurrent_destroy(map);
+    
+    // Inline values copied out under the read lock are never torn by a writer
+    options.concurrency = 2;
+    options.value_size = 2 * sizeof(uint64_t);
+    map = hashmap_concurrent_create_ex(&options);
+    _Atomic bool stop = false;
+    concurrent_pair_writer_t pair_writer = {map, &stop, true};
+    pthread_t writer;
+    ASSERT(pthread_create(&writer, NULL, concurrent_pair_writer, &pair_writer) == 0, "pthread_create failed");
+    bool torn = false;
+    for (int round = 0; round < 200000; round++) {
+        int key = round % 16;
+        uint64_t pair[2];
+        if (hashmap_concurrent_get_copy(map, &key, sizeof(key), pair) && pair[0] != pair[1]) {
+            torn = true;
+        }
+    }
+    atomic_store(&stop, true);
+    pthread_join(writer, NULL);
+    ASSERT(pair_writer.ok && !torn, "Copied inline value was torn");
+    hashmap_concurrent_destroy(map);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 33: Lock-free readers racing a writer that updates, removes and resizes
+typedef struct {
+    hashmap_rcu_t *map;
+    int keys;
+    _Atomic bool *stop;
+    bool ok;
+    long lookups;
+} rcu_reader_t;
+
+static void *rcu_reader(void *arg) {
+    rcu_reader_t *r = arg;
+    r->ok = true;
+    r->lookups = 0;
+    while (!atomic_load(r->stop)) {
+        for (int i = 0; i < r->keys; i++) {
+            size_t token = hashmap_rcu_read_lock(r->map);
+            int *value = hashmap_rcu_get(r->map, &i, sizeof(int));
+            // Values are freed by the writer; dereferencing inside the section must be safe
+            if (value && *value % r->keys != i) {
+                r->ok = false;
+            }
+            hashmap_rcu_read_unlock(r->map, token);
+            r->lookups++;
+        }
+    }
+    return NULL;
+}
+
+static int *rcu_value(int v) {
+    int *p = malloc(sizeof(int));
+    *p = v;
+    return p;
+}
+
+bool test_rcu_map() {
+    TEST_START("Read-mostly map with lock-free reads");
+    
+    enum { KEYS = 2000, READERS = 3 };
+    hashmap_rcu_t *map = hashmap_rcu_create(16, NULL, free);
+    ASSERT(map != NULL, "hashmap_rcu_create failed");
+    ASSERT((uintptr_t)&map->readers[0][1] % HASHMAP_CACHE_LINE == 0 &&
+           sizeof(hashmap_rcu_counter_t) == HASHMAP_CACHE_LINE, "Reader counters should own whole cache lines");
+    for (int i = 0; i < KEYS / 2; i++) {
+        ASSERT(hashmap_rcu_put(map, &i, sizeof(int), rcu_value(i)), "Initial put failed");
+    }
+    
+    _Atomic bool stop = false;
+    pthread_t threads[READERS];
+    rcu_reader_t readers[READERS];
+    for (int t = 0; t < READERS; t++) {
+        readers[t] = (rcu_reader_t){map, KEYS, &stop, false, 0};
+        ASSERT(pthread_create(&threads[t], NULL, rcu_reader, &readers[t]) == 0, "pthread_create failed");
+    }
+    
+    // Writer: grow through several resizes, overwrite values, remove and reinsert
+    size_t start_capacity = atomic_load(&map->table)->capacity;
+    for (int i = KEYS / 2; i < KEYS; i++) {
+        ASSERT(hashmap_rcu_put(map, &i, sizeof(int), rcu_value(i)), "Growing put failed");
+    }
+    for (int round = 1; round <= 3; round++) {
+        for (int i = 0; i < KEYS; i++) {
+            ASSERT(hashmap_rcu_put(map, &i, sizeof(int), rcu_value(i + round * KEYS)), "Update failed");
+        }
+        for (int i = 0; i < KEYS; i += 3) {
+            ASSERT(hashmap_rcu_remove(map, &i, sizeof(int)), "Remove failed");
+            ASSERT(hashmap_rcu_put(map, &i, sizeof(int), rcu_value(i)), "Reinsert failed");
+        }
+    }
+    
+    atomic_store(&stop, true);
+    for (int t = 0; t < READERS; t++) {
+        pthread_join(threads[t], NULL);
+        ASSERT(readers[t].ok, "Reader saw a value for the wrong key");
+    }
+    ASSERT(atomic_load(&map->table)->capacity > start_capacity, "Table should have grown during reads");
+    
+    ASSERT(hashmap_rcu_size(map) == KEYS, "Size mismatch");
+    for (int i = 0; i < KEYS; i++) {
+        int *value = hashmap_rcu_get(map, &i, sizeof(int));
+        ASSERT(value != NULL, "Key missing after writes");
+        ASSERT(*value == (i % 3 == 0 ? i : i + 3 * KEYS), "Value mismatch after writes");
+    }
+    
+    hashmap_rcu_synchronize(map);
+    ASSERT(map->retired == NULL && map->retired_count == 0, "Synchronize should drain the retire list");
+    ASSERT(!hashmap_rcu_remove(map, &(int){KEYS}, sizeof(int)), "Missing key should not be removed");
+    ASSERT(!hashmap_rcu_put(NULL, &(int){1}, sizeof(int), NULL), "NULL map should fail");
+    
+    hashmap_rcu_clear(map);
+    ASSERT(hashmap_rcu_is_empty(map), "Map should be empty after clear");
+    ASSERT(!hashmap_rcu_contains(map, &(int){1}, sizeof(int)), "Cleared key still present");
+    hashmap_rcu_destroy(map);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 34: Sharded front-end routing and per-shard growth
+bool test_sharded_map() {
+    TEST_START("Sharded hashmap");
+    
+    hashmap_sharded_t *map = hashmap_sharded_create(8, 0, NULL, NULL);
+    ASSERT(map != NULL, "hashmap_sharded_create failed");
+    ASSERT(map->shard_count == 8 && map->shard_bits == 3, "Shard count mismatch");
+    
+    const int N = 20000;
+    for (int i = 0; i < N; i++) {
+        ASSERT(hashmap_sharded_put(map, &i, sizeof(int), (void *)(intptr_t)(i + 1)), "Put failed");
+    }
+    ASSERT(hashmap_sharded_size(map) == (size_t)N, "Size mismatch");
+    
+    // Routing follows the top bits of the default hash, and each key lives in its shard
+    for (int i = 0; i < N; i++) {
+        size_t index = hashmap_sharded_index(map, &i, sizeof(int));
+        ASSERT(index == hashmap_generic_hash(&i, sizeof(int)) >> (sizeof(size_t) * 8 - 3), "Routing mismatch");
+        hashmap_t *shard = hashmap_sharded_shard(map, index);
+        ASSERT((intptr_t)hashmap_get(shard, &i, sizeof(int)) == i + 1, "Key not in its shard");
+    }
+    
+    // Shards are balanced and grow independently of each other
+    for (size_t i = 0; i < map->shard_count; i++) {
+        size_t shard_size = map->shards[i]->size;
+        ASSERT(shard_size > (size_t)N / 16 && shard_size < (size_t)N / 4, "Shards should be roughly balanced");
+        ASSERT(map->shards[i]->capacity >= hashmap_capacity_for(shard_size), "Shard should have grown");
+    }
+    hashmap_t *first = map->shards[0];
+    size_t first_capacity = first->capacity;
+    size_t other_capacity = map->shards[1]->capacity;
+    int grown = 0;
+    for (int i = N; grown < 20000; i++) {
+        if (hashmap_sharded_index(map, &i, sizeof(int)) == 0) {
+            ASSERT(hashmap_sharded_put(map, &i, sizeof(int), NULL), "Put into shard 0 failed");
+            grown++;
+        }
+    }
+    ASSERT(first->capacity > first_capacity, "Shard 0 should have resized");
+    ASSERT(map->shards[1]->capacity == other_capacity, "Other shards should be untouched");
+    
+    ASSERT(hashmap_sharded_remove(map, &(int){5}, sizeof(int)), "Remove failed");
+    ASSERT(!hashmap_sharded_contains(map, &(int){5}, sizeof(int)), "Removed key still present");
+    ASSERT(hashmap_sharded_index(map, NULL, 4) == SIZE_MAX, "NULL key should have no shard");
+    ASSERT(hashmap_sharded_shard(map, 8) == NULL, "Out of range shard should be NULL");
+    
+    hashmap_sharded_clear(map);
+    ASSERT(hashmap_sharded_is_empty(map), "Map should be empty after clear");
+    hashmap_sharded_destroy(map);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 35: Iterators and foreach visit every entry exactly once
+typedef struct {
+    unsigned char *seen;
+    int limit;
+    size_t calls;
+    intptr_t value_sum;
+} visit_state_t;
+
+static bool visit_record(const void *key, size_t key_size, void *value, void *ctx) {
+    visit_state_t *state = ctx;
+    int k;
+    if (key_size == sizeof(int)) {
+        memcpy(&k, key, sizeof(int));
+        state->seen[k]++;
+    }
+    state->value_sum += (intptr_t)value;
+    state->calls++;
+    return state->limit == 0 || state->calls < (size_t)state->limit;
+}
+
+bool test_iteration() {
+    TEST_START("Iteration and foreach");
+    
+    const int N = 5000;
+    unsigned char *seen = calloc(N, 1);
+    ASSERT(seen != NULL, "Memory allocation failed");
+    visit_state_t state = {seen, 0, 0, 0};
+    
+    hashmap_t *empty = hashmap_create(16, NULL, NULL);
+    hashmap_iter_t iter;
+    hashmap_iter_init(&iter, empty);
+    ASSERT(!hashmap_iter_next(&iter, NULL, NULL, NULL), "Empty map should yield nothing");
+    ASSERT(hashmap_foreach(empty, visit_record, &state) == 0, "Empty foreach should visit nothing");
+    hashmap_destroy(empty);
+    
+    // Iterate in the middle of an incremental migration to cover both tables
+    hashmap_options_t options = {0};
+    options.incremental_resize = true;
+    hashmap_t *map = hashmap_create_ex(&options);
+    int inserted = 0;
+    while (inserted < N && !(map->old_buckets && map->migrate_index > 0)) {
+        hashmap_put(map, &inserted, sizeof(int), (void *)(intptr_t)(inserted + 1));
+        inserted++;
+    }
+    ASSERT(map->old_buckets != NULL, "Expected a migration in progress");
+    
+    const void *key;
+    size_t key_size;
+    void *value;
+    size_t count = 0;
+    hashmap_iter_init(&iter, map);
+    while (hashmap_iter_next(&iter, &key, &key_size, &value)) {
+        int k;
+        ASSERT(key_size == sizeof(int), "Key size mismatch");
+        memcpy(&k, key, sizeof(int));
+        ASSERT(k >= 0 && k < inserted, "Unexpected key");
+        ASSERT((intptr_t)value == k + 1, "Value mismatch");
+        seen[k]++;
+        count++;
+    }
+    ASSERT(count == (size_t)inserted, "Iterator count mismatch during migration");
+    for (int i = 0; i < inserted; i++) {
+        ASSERT(seen[i] == 1, "Every key should be seen exactly once");
+    }
+    ASSERT(!hashmap_iter_next(&iter, NULL, NULL, NULL), "Exhausted iterator should stay exhausted");
+    
+    // Foreach over the same map, then with an early stop
+    memset(seen, 0, N);
+    ASSERT(hashmap_foreach(map, visit_record, &state) == (size_t)inserted, "Foreach count mismatch");
+    for (int i = 0; i < inserted; i++) {
+        ASSERT(seen[i] == 1, "Foreach should see every key once");
+    }
+    state.calls = 0;
+    state.limit = 10;
+    ASSERT(hashmap_foreach(map, visit_record, &state) == 10, "Foreach should stop when the visitor says so");
+    ASSERT(hashmap_foreach(NULL, visit_record, &state) == 0, "NULL map should visit nothing");
+    hashmap_destroy(map);
+    
+    // Flat engine, including tombstones left by removals
+    hashmap_flat_t *flat = hashmap_flat_create(16, NULL, NULL);
+    for (int i = 0; i < N; i++) {
+        hashmap_flat_put(flat, &i, sizeof(int), (void *)(intptr_t)(i + 1));
+    }
+    for (int i = 0; i < N; i += 2) {
+        hashmap_flat_remove(flat, &i, sizeof(int));
+    }
+    memset(seen, 0, N);
+    count = 0;
+    hashmap_flat_iter_t flat_iter;
+    hashmap_flat_iter_init(&flat_iter, flat);
+    while (hashmap_flat_iter_next(&flat_iter, &key, NULL, &value)) {
+        int k;
+        memcpy(&k, key, sizeof(int));
+        ASSERT(k % 2 == 1 && (intptr_t)value == k + 1, "Flat iterator returned a removed or wrong entry");
+        seen[k]++;
+        count++;
+    }
+    ASSERT(count == (size_t)N / 2, "Flat iterator count mismatch");
+    state.calls = 0;
+    state.limit = 0;
+    state.value_sum = 0;
+    ASSERT(hashmap_flat_foreach(flat, visit_record, &state) == (size_t)N / 2, "Flat foreach count mismatch");
+    for (int i = 1; i < N; i += 2) {
+        ASSERT(seen[i] == 2, "Flat iterator and foreach should each see every key once");
+    }
+    hashmap_flat_destroy(flat);
+    
+    free(seen);
+    TEST_PASS();
+    return true;
+}
+
+// Test 36: Parallel build, foreach and clear
+static _Atomic size_t parallel_freed = 0;
+
+static void parallel_value_free(void *value) {
+    free(value);
+    atomic_fetch_add(&parallel_freed, 1);
+}
+
+static bool visit_count_atomic(const void *key, size_t key_size, void *value, void *ctx) {
+    (void)key;
+    (void)key_size;
+    (void)value;
+    atomic_fetch_add((_Atomic size_t *)ctx, 1);
+    return true;
+}
+
+static bool visit_stop_early(const void *key, size_t key_size, void *value, void *ctx) {
+    (void)key;
+    (void)key_size;
+    (void)value;
+    return atomic_fetch_add((_Atomic size_t *)ctx, 1) < 100;
+}
+
+bool test_parallel_operations() {
+    TEST_START("Parallel build, foreach and clear");
+    
+    const int N = 100000;
+    int *keys = malloc(N * sizeof(int));
+    const void **key_ptrs = malloc(N * sizeof(void *));
+    size_t *key_sizes = malloc(N * sizeof(size_t));
+    void **values = malloc(N * sizeof(void *));
+    ASSERT(keys && key_ptrs && key_sizes && values, "Memory allocation failed");
+    
+    // Every key appears twice; the second occurrence must win
+    for (int i = 0; i < N; i++) {
+        keys[i] = i % (N / 2);
+        key_ptrs[i] = &keys[i];
+        key_sizes[i] = sizeof(int);
+        values[i] = (void *)(intptr_t)(i + 1);
+    }
+    
+    for (int pooled = 0; pooled < 2; pooled++) {
+        hashmap_options_t options = {0};
+        options.entry_pool = pooled != 0;
+        hashmap_t *map = hashmap_create_ex(&options);
+        hashmap_put(map, &(int){-1}, sizeof(int), (void *)(intptr_t)-1);  // Pre-existing entry survives
+        
+        ASSERT(hashmap_parallel_build(map, key_ptrs, key_sizes, (void *const *)values, N, 4), "Parallel build failed");
+        ASSERT(hashmap_size(map) == (size_t)N / 2 + 1, "Duplicates should update, not insert");
+        for (int k = 0; k < N / 2; k++) {
+            ASSERT((intptr_t)hashmap_get(map, &k, sizeof(int)) == k + N / 2 + 1, "Later duplicate should win");
+        }
+        ASSERT((intptr_t)hashmap_get(map, &(int){-1}, sizeof(int)) == -1, "Existing entry lost");
+        
+        _Atomic size_t visited = 0;
+        ASSERT(hashmap_parallel_foreach(map, visit_count_atomic, &visited, 4) == (size_t)N / 2 + 1,
+               "Parallel foreach count mismatch");
+        ASSERT(atomic_load(&visited) == (size_t)N / 2 + 1, "Visitor call count mismatch");
+        
+        atomic_store(&visited, 0);
+        size_t partial = hashmap_parallel_foreach(map, visit_stop_early, &visited, 4);
+        ASSERT(partial >= 101 && partial < (size_t)N / 2, "Early stop should halt all workers");
+        
+        hashmap_parallel_destroy(map, 4);
+    }
+    
+    // Invalid rows are skipped and reported
+    key_ptrs[7] = NULL;
+    key_sizes[9] = 0;
+    hashmap_t *map = hashmap_create(16, NULL, NULL);
+    ASSERT(!hashmap_parallel_build(map, key_ptrs, key_sizes, (void *const *)values, N, 3), "Invalid rows should fail");
+    ASSERT(hashmap_size(map) == (size_t)N / 2, "Valid rows should still be inserted");
+    hashmap_destroy(map);
+    
+    // Parallel clear calls value_free for every entry exactly once
+    map = hashmap_create(16, NULL, parallel_value_free);
+    for (int i = 0; i < N; i++) {
+        int *value = malloc(sizeof(int));
+        *value = i;
+        hashmap_put(map, &i, sizeof(int), value);
+    }
+    atomic_store(&parallel_freed, 0);
+    hashmap_parallel_clear(map, 4);
+    ASSERT(atomic_load(&parallel_freed) == (size_t)N, "value_free count mismatch");
+    ASSERT(hashmap_is_empty(map) && !hashmap_contains(map, &(int){1}, sizeof(int)), "Map should be empty");
+    ASSERT(hashmap_put(map, &(int){1}, sizeof(int), malloc(1)), "Map should be reusable after clear");
+    hashmap_destroy(map);
+    
+    ASSERT(hashmap_parallel_build(NULL, key_ptrs, key_sizes, (void *const *)values, N, 2) == false, "NULL map should fail");
+    
+    free(keys);
+    free(key_ptrs);
+    free(key_sizes);
+    free(values);
+    TEST_PASS();
+    return true;
+}
+
+// Test 37: Fixed-size values copied into the entry
+typedef struct {
+    uint64_t hits;
+    double total;
+} value_stats_t;
+
+bool test_inline_values() {
+    TEST_START("Inline fixed-size values");
+    
+    for (int pooled = 0; pooled < 2; pooled++) {
+        hashmap_options_t options = {0};
+        options.value_size = sizeof(value_stats_t);
+        options.value_free = free;  // Ignored: inline values are owned by the map
+        options.entry_pool = pooled != 0;
+        hashmap_t *map = hashmap_create_ex(&options);
+        ASSERT(map != NULL && map->value_free == NULL, "value_free should be ignored in value_size mode");
+        
+        const int N = 5000;
+        for (int i = 0; i < N; i++) {
+            value_stats_t stats = {(uint64_t)i, i * 0.5};
+            ASSERT(hashmap_put(map, &i, sizeof(int), &stats), "Put failed");
+        }
+        value_stats_t *first = hashmap_get(map, &(int){0}, sizeof(int));
+        ASSERT(first != NULL, "Get failed");
+        ASSERT((uintptr_t)first % _Alignof(value_stats_t) == 0, "Inline value misaligned");
+        
+        // Values are copies: changing the source after put has no effect
+        value_stats_t source = {42, 4.2};
+        ASSERT(hashmap_put(map, &(int){N}, sizeof(int), &source), "Put failed");
+        source.hits = 7;
+        ASSERT(((value_stats_t *)hashmap_get(map, &(int){N}, sizeof(int)))->hits == 42, "Value should be copied");
+        
+        // Updates in place through the returned pointer, and via put
+        for (int i = 0; i < N; i++) {
+            value_stats_t *stats = hashmap_get(map, &i, sizeof(int));
+            ASSERT(stats && stats->hits == (uint64_t)i && stats->total == i * 0.5, "Inline value mismatch");
+            stats->hits++;
+        }
+        value_stats_t replacement = {1000, 1.0};
+        ASSERT(hashmap_put(map, &(int){1}, sizeof(int), &replacement), "Update failed");
+        ASSERT(((value_stats_t *)hashmap_get(map, &(int){1}, sizeof(int)))->hits == 1000, "Update should copy");
+        ASSERT(((value_stats_t *)hashmap_get(map, &(int){2}, sizeof(int)))->hits == 3, "In-place increment lost");
+        
+        // Entries never move on resize, so pointers stay valid
+        ASSERT(hashmap_get(map, &(int){0}, sizeof(int)) == first, "Inline value moved");
+        
+        // NULL stores zeros
+        ASSERT(hashmap_put(map, &(int){-1}, sizeof(int), NULL), "Put of NULL value failed");
+        value_stats_t *zero = hashmap_get(map, &(int){-1}, sizeof(int));
+        ASSERT(zero && zero->hits == 0 && zero->total == 0.0, "NULL should zero-fill");
+        ASSERT(hashmap_get(map, &(int){-2}, sizeof(int)) == NULL, "Missing key should return NULL");
+        
+        ASSERT(hashmap_remove(map, &(int){3}, sizeof(int)), "Remove failed");
+        ASSERT(hashmap_size(map) == (size_t)N + 1, "Size mismatch");
+        hashmap_destroy(map);
+    }
+    
+    // Odd value sizes keep their natural alignment and work with long keys
+    hashmap_options_t options = {0};
+    options.value_size = 3;
+    hashmap_t *map = hashmap_create_ex(&options);
+    const char *long_key = "a key that is definitely longer than the pooled limit";
+    ASSERT(hashmap_put(map, long_key, strlen(long_key), "xyz"), "Long key put failed");
+    ASSERT(memcmp(hashmap_get(map, long_key, strlen(long_key)), "xyz", 3) == 0, "Odd-size value mismatch");
+    hashmap_destroy(map);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 38: Find-or-insert and precomputed-hash access
+bool test_get_or_insert() {
+    TEST_START("Get-or-insert and precomputed hashes");
+    
+    // Pointer mode: the slot is the stored void *
+    hashmap_t *map = hashmap_create(0, NULL, NULL);
+    bool inserted = false;
+    void **slot = hashmap_get_or_insert(map, "apple", 5, &inserted);
+    ASSERT(slot != NULL && inserted && *slot == NULL, "First get_or_insert should insert NULL");
+    *slot = "red";
+    slot = hashmap_get_or_insert(map, "apple", 5, &inserted);
+    ASSERT(slot != NULL && !inserted && strcmp(*slot, "red") == 0, "Second call should find the slot");
+    ASSERT(strcmp(hashmap_get(map, "apple", 5), "red") == 0, "Value set through slot not visible");
+    ASSERT(hashmap_get_or_insert(map, "pear", 4, NULL) != NULL, "inserted may be NULL");
+    ASSERT(hashmap_size(map) == 2, "Size mismatch");
+    ASSERT(hashmap_get_or_insert(NULL, "x", 1, &inserted) == NULL && !inserted, "NULL map should fail");
+    ASSERT(hashmap_get_or_insert(map, "x", 0, &inserted) == NULL, "Zero key size should fail");
+    
+    // Precomputed hashes agree with the plain API
+    size_t hash = hashmap_hash(map, "apple", 5);
+    ASSERT(hash == hashmap_generic_hash("apple", 5), "Table hash should be the generic hash");
+    ASSERT(strcmp(hashmap_get_with_hash(map, "apple", 5, hash), "red") == 0, "get_with_hash mismatch");
+    ASSERT(hashmap_put_with_hash(map, "apple", 5, hash, "green"), "put_with_hash failed");
+    ASSERT(strcmp(hashmap_get(map, "apple", 5), "green") == 0, "put_with_hash should update");
+    ASSERT(hashmap_remove_with_hash(map, "apple", 5, hash), "remove_with_hash failed");
+    ASSERT(!hashmap_contains(map, "apple", 5), "Key should be removed");
+    hashmap_destroy(map);
+    
+    // Counting with inline values, across incremental resizes
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    options.incremental_resize = true;
+    map = hashmap_create_ex(&options);
+    const int N = 3000;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < N; i++) {
+            uint64_t *count = hashmap_get_or_insert(map, &i, sizeof(int), &inserted);
+            ASSERT(count != NULL, "get_or_insert failed");
+            ASSERT(inserted == (round == 0), "inserted flag wrong");
+            ASSERT(*count == (uint64_t)round, "Counter mismatch");
+            (*count)++;
+        }
+    }
+    for (int i = 0; i < N; i++) {
+        size_t h = hashmap_hash(map, &i, sizeof(int));
+        uint64_t *count = hashmap_get_with_hash(map, &i, sizeof(int), h);
+        ASSERT(count && *count == 3, "Final count mismatch");
+    }
+    ASSERT(hashmap_size(map) == (size_t)N, "Size mismatch");
+    hashmap_destroy(map);
+    
+    // Open-addressing engine mirrors the API
+    hashmap_flat_t *flat = hashmap_flat_create(0, NULL, NULL);
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < N; i++) {
+            void **value = hashmap_flat_get_or_insert(flat, &i, sizeof(int), &inserted);
+            ASSERT(value != NULL && inserted == (round == 0), "Flat get_or_insert failed");
+            *value = (void *)(uintptr_t)((uintptr_t)*value + 1);
+        }
+    }
+    for (int i = 0; i < N; i++) {
+        size_t h = hashmap_flat_hash(flat, &i, sizeof(int));
+        ASSERT((uintptr_t)hashmap_flat_get_with_hash(flat, &i, sizeof(int), h) == 2, "Flat count mismatch");
+    }
+    size_t h = hashmap_flat_hash(flat, &(int){0}, sizeof(int));
+    ASSERT(hashmap_flat_put_with_hash(flat, &(int){0}, sizeof(int), h, (void *)(uintptr_t)9), "Flat put_with_hash failed");
+    ASSERT((uintptr_t)hashmap_flat_get(flat, &(int){0}, sizeof(int)) == 9, "Flat put_with_hash mismatch");
+    ASSERT(hashmap_flat_size(flat) == (size_t)N, "Flat size mismatch");
+    hashmap_flat_destroy(flat);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 39: Macro-generated maps with fixed key types
+typedef struct {
+    int32_t x;
+    int32_t y;
+} grid_point_t;
+
+static inline size_t grid_point_hash(grid_point_t p) {
+    return hashmap_typed_hash_u64(((uint64_t)(uint32_t)p.x << 32) | (uint32_t)p.y);
+}
+
+static inline bool grid_point_eq(grid_point_t a, grid_point_t b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+HASHMAP_DECLARE(u64_map, uint64_t, uint64_t, hashmap_typed_hash_u64, HASHMAP_TYPED_EQ)
+HASHMAP_DECLARE(grid_map, grid_point_t, double, grid_point_hash, grid_point_eq)
+
+static bool sum_u64_values(uint64_t key, uint64_t *value, void *ctx) {
+    (void)key;
+    *(uint64_t *)ctx += *value;
+    return true;
+}
+
+bool test_typed_map() {
+    TEST_START("Typed maps via HASHMAP_DECLARE");
+    
+    u64_map_t *map = u64_map_create(0);
+    ASSERT(map != NULL && u64_map_is_empty(map), "Create failed");
+    const uint64_t N = 10000;
+    for (uint64_t i = 0; i < N; i++) {
+        ASSERT(u64_map_put(map, i * 7919, i), "Put failed");
+    }
+    ASSERT(u64_map_size(map) == N, "Size mismatch after inserts");
+    for (uint64_t i = 0; i < N; i++) {
+        uint64_t *value = u64_map_get(map, i * 7919);
+        ASSERT(value && *value == i, "Value mismatch");
+    }
+    ASSERT(u64_map_get(map, 1) == NULL, "Missing key should return NULL");
+    
+    // Update, get_or_insert and in-place writes
+    ASSERT(u64_map_put(map, 0, 42) && *u64_map_get(map, 0) == 42, "Update failed");
+    bool inserted = true;
+    uint64_t *count = u64_map_get_or_insert(map, 0, &inserted);
+    ASSERT(count && !inserted && *count == 42, "get_or_insert should find existing key");
+    count = u64_map_get_or_insert(map, 3, &inserted);
+    ASSERT(count && inserted && *count == 0, "get_or_insert should insert zeroed value");
+    (*count)++;
+    ASSERT(*u64_map_get(map, 3) == 1, "In-place write lost");
+    ASSERT(u64_map_remove(map, 3) && !u64_map_remove(map, 3), "Remove failed");
+    
+    // Remove/reinsert churn reuses tombstones without growing
+    size_t capacity = map->capacity;
+    for (int round = 0; round < 20; round++) {
+        for (uint64_t i = 0; i < N / 2; i++) {
+            ASSERT(u64_map_remove(map, i * 7919), "Churn remove failed");
+        }
+        for (uint64_t i = 0; i < N / 2; i++) {
+            ASSERT(u64_map_put(map, i * 7919, i), "Churn put failed");
+        }
+    }
+    ASSERT(map->capacity == capacity, "Churn should not grow the table");
+    *u64_map_get(map, 0) = 0;
+    
+    uint64_t total = 0;
+    ASSERT(u64_map_foreach(map, sum_u64_values, &total) == N, "foreach visit count mismatch");
+    ASSERT(total == N * (N - 1) / 2, "foreach sum mismatch");
+    
+    ASSERT(u64_map_reserve(map, 4 * N) && map->capacity > capacity, "Reserve failed");
+    capacity = map->capacity;
+    for (uint64_t i = N; i < 4 * N; i++) {
+        ASSERT(u64_map_put(map, i * 7919, i), "Put after reserve failed");
+    }
+    ASSERT(map->capacity == capacity, "Reserve should avoid rehashing");
+    ASSERT(*u64_map_get(map, 5 * 7919) == 5, "Value lost across reserve");
+    
+    u64_map_clear(map);
+    ASSERT(u64_map_is_empty(map) && !u64_map_contains(map, 7919), "Clear failed");
+    ASSERT(u64_map_get(NULL, 1) == NULL && !u64_map_put(NULL, 1, 1), "NULL map should fail");
+    u64_map_destroy(map);
+    u64_map_destroy(NULL);
+    
+    // Struct keys with a custom hash and equality
+    grid_map_t *grid = grid_map_create(4);
+    for (int32_t x = -50; x < 50; x++) {
+        for (int32_t y = -50; y < 50; y++) {
+            ASSERT(grid_map_put(grid, (grid_point_t){x, y}, x * 0.5 + y), "Grid put failed");
+        }
+    }
+    ASSERT(grid_map_size(grid) == 10000, "Grid size mismatch");
+    double *cell = grid_map_get(grid, (grid_point_t){-3, 7});
+    ASSERT(cell && *cell == 5.5, "Grid value mismatch");
+    ASSERT(!grid_map_contains(grid, (grid_point_t){50, 0}), "Grid key should be absent");
+    grid_map_destroy(grid);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Manually advanced clock for the TTL tests
+static uint64_t fake_clock(void *ctx) {
+    return *(uint64_t *)ctx;
+}
+
+// Test 40: Snapshots saved to disk and served from a read-only mapping
+// Write header over the start of the snapshot at path and report whether it still opens
+static bool snapshot_opens_with(const char *path, const hashmap_snapshot_header_t *header) {
+    FILE *file = fopen(path, "r+b");
+    if (!file) {
+        return false;
+    }
+    fwrite(header, sizeof(*header), 1, file);
+    fclose(file);
+    hashmap_mapped_t *mapped = hashmap_open_mapped(path);
+    hashmap_mapped_close(mapped);
+    return mapped != NULL;
+}
+
+bool test_mapped_snapshot() {
+    TEST_START("Memory-mapped snapshots");
+    
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/hashmap_test_snapshot.%ld", (long)getpid());
+    
+    // Save in the middle of an incremental migration, with mixed key lengths
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(value_stats_t);
+    options.incremental_resize = true;
+    hashmap_t *map = hashmap_create_ex(&options);
+    const int N = 12500;  // Just past the 16384-bucket growth threshold
+    for (int i = 0; i < N; i++) {
+        char key[48];
+        int len = snprintf(key, sizeof(key), "row-%d%s", i, i % 7 == 0 ? "-with-a-longer-suffix" : "");
+        value_stats_t stats = {(uint64_t)i, i * 0.25};
+        ASSERT(hashmap_put(map, key, (size_t)len, &stats), "Put failed");
+    }
+    ASSERT(map->old_buckets != NULL, "Expected a pending migration");
+    ASSERT(hashmap_save(map, path), "Save failed");
+    ASSERT(map->old_buckets == NULL, "Save should finish the migration");
+    
+    hashmap_mapped_t *mapped = hashmap_open_mapped(path);
+    ASSERT(mapped != NULL, "Open failed");
+    ASSERT(hashmap_mapped_size(mapped) == (size_t)N, "Size mismatch");
+    ASSERT(hashmap_mapped_value_size(mapped) == sizeof(value_stats_t), "Value size mismatch");
+    for (int i = 0; i < N; i++) {
+        char key[48];
+        int len = snprintf(key, sizeof(key), "row-%d%s", i, i % 7 == 0 ? "-with-a-longer-suffix" : "");
+        const value_stats_t *stats = hashmap_mapped_get(mapped, key, (size_t)len);
+        ASSERT(stats != NULL, "Mapped get failed");
+        ASSERT((uintptr_t)stats % _Alignof(value_stats_t) == 0, "Mapped value misaligned");
+        ASSERT(stats->hits == (uint64_t)i && stats->total == i * 0.25, "Mapped value mismatch");
+    }
+    ASSERT(!hashmap_mapped_contains(mapped, "row-", 4), "Missing key should not be found");
+    ASSERT(hashmap_mapped_get(mapped, NULL, 4) == NULL, "NULL key should fail");
+    
+    // Saving over an open snapshot replaces the file; the old mapping stays intact
+    ASSERT(hashmap_remove(map, "row-1", 5), "Remove failed");
+    ASSERT(hashmap_save(map, path), "Resave failed");
+    ASSERT(hashmap_mapped_contains(mapped, "row-1", 5), "Old mapping should be unchanged");
+    hashmap_mapped_close(mapped);
+    mapped = hashmap_open_mapped(path);
+    ASSERT(mapped && hashmap_mapped_size(mapped) == (size_t)N - 1, "Resaved size mismatch");
+    ASSERT(!hashmap_mapped_contains(mapped, "row-1", 5), "Removed key should be gone");
+    hashmap_mapped_close(mapped);
+    hashmap_destroy(map);
+    
+    // Empty maps round-trip
+    map = hashmap_create_ex(&options);
+    ASSERT(hashmap_save(map, path), "Empty save failed");
+    mapped = hashmap_open_mapped(path);
+    ASSERT(mapped && hashmap_mapped_size(mapped) == 0 && !hashmap_mapped_contains(mapped, "x", 1),
+           "Empty snapshot mismatch");
+    hashmap_mapped_close(mapped);
+    hashmap_destroy(map);
+    
+    // Expired entries not yet reclaimed stay out of the snapshot
+    uint64_t now = 1000;
+    hashmap_options_t timed = {0};
+    timed.value_size = sizeof(uint64_t);
+    timed.expiry = true;
+    timed.clock = fake_clock;
+    timed.clock_ctx = &now;
+    map = hashmap_create_ex(&timed);
+    for (uint64_t i = 0; i < 20; i++) {
+        ASSERT(hashmap_put_ttl(map, &i, sizeof(i), &i, i < 10 ? 10 : HASHMAP_TTL_NEVER), "put_ttl failed");
+    }
+    now += 10;
+    ASSERT(hashmap_size(map) == 20 && hashmap_save(map, path), "Save with expired entries failed");
+    mapped = hashmap_open_mapped(path);
+    ASSERT(mapped && hashmap_mapped_size(mapped) == 10, "Expired entries were saved");
+    for (uint64_t i = 0; i < 20; i++) {
+        const uint64_t *value = hashmap_mapped_get(mapped, &i, sizeof(i));
+        ASSERT(i < 10 ? value == NULL : value && *value == i, "Mapped TTL entry mismatch");
+    }
+    hashmap_mapped_close(mapped);
+    hashmap_destroy(map);
+    
+    // Pointer values and custom hashes cannot be saved
+    map = hashmap_create(0, NULL, NULL);
+    ASSERT(!hashmap_save(map, path), "Pointer-mode save should fail");
+    hashmap_destroy(map);
+    options.hash_func = hashmap_fnv1a_hash;
+    map = hashmap_create_ex(&options);
+    ASSERT(!hashmap_save(map, path), "Custom hash save should fail");
+    ASSERT(!hashmap_save(NULL, path) && !hashmap_save(map, NULL), "NULL arguments should fail");
+    hashmap_destroy(map);
+    
+    // Headers whose regions wrap around or leave the file are rejected
+    hashmap_snapshot_header_t header;
+    FILE *file = fopen(path, "rb");
+    ASSERT(file && fread(&header, sizeof(header), 1, file) == 1, "Reading the header failed");
+    fclose(file);
+    hashmap_snapshot_header_t crafted = header;
+    crafted.count = 1;
+    crafted.records_offset = UINT64_MAX - 15;
+    ASSERT(!snapshot_opens_with(path, &crafted), "Wrapping records region accepted");
+    crafted = header;
+    crafted.count = UINT64_MAX / sizeof(hashmap_snapshot_record_t);
+    ASSERT(!snapshot_opens_with(path, &crafted), "Oversized record count accepted");
+    crafted = header;
+    crafted.capacity = (uint64_t)1 << 62;
+    ASSERT(!snapshot_opens_with(path, &crafted), "Oversized capacity accepted");
+    crafted = header;
+    crafted.buckets_offset = UINT64_MAX - 7;
+    ASSERT(!snapshot_opens_with(path, &crafted), "Bucket offset past the file accepted");
+    ASSERT(snapshot_opens_with(path, &header), "Restored header should open");
+    
+    // Truncated, corrupt and missing files are rejected
+    file = fopen(path, "r+b");
+    ASSERT(file != NULL, "Reopen for corruption failed");
+    fseek(file, 0, SEEK_END);
+    long full_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    fputc('X', file);
+    fclose(file);
+    ASSERT(hashmap_open_mapped(path) == NULL, "Bad magic should be rejected");
+    ASSERT(truncate(path, full_size / 2) == 0, "Truncate failed");
+    ASSERT(hashmap_open_mapped(path) == NULL, "Truncated file should be rejected");
+    remove(path);
+    ASSERT(hashmap_open_mapped(path) == NULL, "Missing file should fail");
+    ASSERT(hashmap_open_mapped(NULL) == NULL, "NULL path should fail");
+    hashmap_mapped_close(NULL);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 41: Streaming bulk load from row files
+bool test_bulk_load() {
+    TEST_START("Streaming bulk loader");
+    
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/hashmap_test_rows.%ld", (long)getpid());
+    
+    // Mixed key lengths, one row larger than a read chunk, and a duplicate
+    const int N = 50000;
+    size_t big_size = HASHMAP_LOAD_CHUNK_BYTES + 12345;
+    unsigned char *big_key = malloc(big_size);
+    ASSERT(big_key != NULL, "Allocation failed");
+    for (size_t i = 0; i < big_size; i++) {
+        big_key[i] = (unsigned char)(i * 13);
+    }
+    FILE *file = fopen(path, "wb");
+    ASSERT(file != NULL, "Create failed");
+    ASSERT(hashmap_rows_write_header(file, (uint64_t)N + 2, sizeof(uint64_t)), "Header write failed");
+    for (int i = 0; i < N; i++) {
+        char key[48];
+        int len = snprintf(key, sizeof(key), "user:%d%s", i, i % 5 == 0 ? ":profile" : "");
+        uint64_t value = (uint64_t)i * 10;
+        ASSERT(hashmap_rows_write_row(file, key, (size_t)len, &value, sizeof(value)), "Row write failed");
+        if (i == N / 2) {
+            uint64_t big_value = 77;
+            ASSERT(hashmap_rows_write_row(file, big_key, big_size, &big_value, sizeof(big_value)), "Big row write failed");
+        }
+    }
+    uint64_t dup = 1;
+    ASSERT(hashmap_rows_write_row(file, "user:0:profile", 14, &dup, sizeof(dup)), "Duplicate write failed");
+    ASSERT(!hashmap_rows_write_row(file, "", 0, &dup, sizeof(dup)), "Empty key should be rejected");
+    long file_size = ftell(file);
+    fclose(file);
+    
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    options.entry_pool = true;
+    hashmap_t *map = hashmap_create_ex(&options);
+    hashmap_load_stats_t stats;
+    ASSERT(hashmap_load_file(map, path, &stats), "Load failed");
+    ASSERT(stats.rows == (size_t)N + 2, "Row count mismatch");
+    ASSERT(stats.bytes == (uint64_t)file_size, "Byte count mismatch");
+    ASSERT(stats.seconds >= 0.0, "Elapsed time should be set");
+    ASSERT(hashmap_size(map) == (size_t)N + 1, "Size mismatch (duplicate counts once)");
+    ASSERT(map->capacity >= hashmap_capacity_for((size_t)N + 2), "Table should be pre-sized");
+    for (int i = 1; i < N; i++) {
+        char key[48];
+        int len = snprintf(key, sizeof(key), "user:%d%s", i, i % 5 == 0 ? ":profile" : "");
+        uint64_t *value = hashmap_get(map, key, (size_t)len);
+        ASSERT(value && *value == (uint64_t)i * 10, "Loaded value mismatch");
+    }
+    ASSERT(*(uint64_t *)hashmap_get(map, "user:0:profile", 14) == 1, "Later duplicate should win");
+    uint64_t *big = hashmap_get(map, big_key, big_size);
+    ASSERT(big && *big == 77, "Row larger than a chunk lost");
+    
+    // Loading a second partition adds to the map without rehashing below the reserve
+    ASSERT(hashmap_load_file(map, path, NULL), "Reload failed");
+    ASSERT(hashmap_size(map) == (size_t)N + 1, "Reload should only update");
+    hashmap_destroy(map);
+    
+    // Value size must match the map
+    map = hashmap_create(0, NULL, NULL);
+    ASSERT(!hashmap_load_file(map, path, &stats) && stats.rows == 0, "Value size mismatch should fail");
+    hashmap_destroy(map);
+    
+    // Truncated files fail but keep the rows read so far
+    ASSERT(truncate(path, file_size / 4) == 0, "Truncate failed");
+    map = hashmap_create_ex(&options);
+    ASSERT(!hashmap_load_file(map, path, &stats), "Truncated file should fail");
+    ASSERT(stats.rows > 0 && stats.rows < (size_t)N && hashmap_size(map) == stats.rows, "Partial load mismatch");
+    hashmap_destroy(map);
+    
+    // Keys-only files load into pointer-mode maps
+    file = fopen(path, "wb");
+    ASSERT(hashmap_rows_write_header(file, 3, 0), "Header write failed");
+    ASSERT(hashmap_rows_write_row(file, "a", 1, NULL, 0) && hashmap_rows_write_row(file, "bb", 2, NULL, 0) &&
+           hashmap_rows_write_row(file, "ccc", 3, NULL, 0), "Keys-only write failed");
+    fclose(file);
+    map = hashmap_create(0, NULL, NULL);
+    ASSERT(hashmap_load_file(map, path, NULL), "Keys-only load failed");
+    ASSERT(hashmap_size(map) == 3 && hashmap_contains(map, "a", 1) && hashmap_contains(map, "bb", 2) &&
+           hashmap_contains(map, "ccc", 3), "Keys-only keys should be present");
+    ASSERT(hashmap_get(map, "bb", 2) == hashmap_rows_present(), "Keys-only value should be the marker");
+    hashmap_iter_t iter;
+    hashmap_iter_init(&iter, map);
+    size_t seen = 0;
+    while (hashmap_iter_next(&iter, NULL, NULL, NULL)) {
+        seen++;
+    }
+    ASSERT(seen == 3, "Keys-only rows missing");
+    ASSERT(!hashmap_load_file(map, "/nonexistent/rows", NULL), "Missing file should fail");
+    ASSERT(!hashmap_load_file(NULL, path, NULL) && !hashmap_load_stream(map, NULL, NULL), "NULL arguments should fail");
+    hashmap_destroy(map);
+    map = hashmap_create(0, NULL, free);
+    ASSERT(!hashmap_load_file(map, path, NULL) && hashmap_size(map) == 0, "Keys-only load with value_free should fail");
+    hashmap_destroy(map);
+    
+    remove(path);
+    free(big_key);
+    TEST_PASS();
+    return true;
+}
+
+// Test 42: Statistics and bucket-occupancy histogram
+bool test_map_stats() {
+    TEST_START("Map statistics");
+    
+    alloc_counter_t counter = {0, 0, 0};
+    hashmap_options_t options = {0};
+    options.allocator.alloc = counting_alloc;
+    options.allocator.dealloc = counting_dealloc;
+    options.allocator.ctx = &counter;
+    options.incremental_resize = true;
+    hashmap_t *map = hashmap_create_ex(&options);
+    
+    hashmap_stats_t stats;
+    ASSERT(hashmap_stats(map, &stats), "Stats failed");
+    ASSERT(stats.size == 0 && stats.capacity == HASHMAP_DEFAULT_CAPACITY && stats.used_buckets == 0 &&
+           stats.max_chain == 0 && stats.load_factor == 0.0, "Empty map stats mismatch");
+    
+    const int N = 3000;
+    for (int i = 0; i < N; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(i), (void *)(intptr_t)(i + 1)), "Put failed");
+    }
+    ASSERT(hashmap_stats(map, &stats), "Stats failed");
+    ASSERT(stats.size == (size_t)N && stats.capacity == map->capacity, "Size or capacity mismatch");
+    ASSERT(stats.load_factor > 0.0 && stats.load_factor <= HASHMAP_DEFAULT_MAX_LOAD_FACTOR, "Load factor mismatch");
+    ASSERT(stats.migrating == (map->old_buckets != NULL), "Migration flag mismatch");
+    ASSERT(stats.used_buckets > 0 && stats.max_chain >= 1 && stats.avg_chain >= 1.0, "Chain stats mismatch");
+    
+    // Histogram bins cover every bucket of both tables and every entry
+    size_t counts[HASHMAP_STATS_HISTOGRAM_BINS];
+    size_t longest = hashmap_chain_histogram(map, counts, HASHMAP_STATS_HISTOGRAM_BINS);
+    size_t buckets = 0, entries = 0;
+    for (size_t i = 0; i < HASHMAP_STATS_HISTOGRAM_BINS; i++) {
+        buckets += counts[i];
+        entries += counts[i] * i;
+    }
+    size_t old_pending = map->old_buckets ? map->old_capacity - map->migrate_index : 0;
+    ASSERT(longest == stats.max_chain, "Histogram max mismatch");
+    ASSERT(buckets == map->capacity + old_pending, "Histogram should cover every bucket");
+    ASSERT(buckets - counts[0] == stats.used_buckets, "Used buckets mismatch");
+    ASSERT(longest >= HASHMAP_STATS_HISTOGRAM_BINS || entries == (size_t)N, "Histogram entry count mismatch");
+    ASSERT(hashmap_chain_histogram(map, NULL, 0) == longest, "Max-only query mismatch");
+    
+    for (int i = 0; i < N; i++) {
+        ASSERT(hashmap_get(map, &i, sizeof(i)) == (void *)(intptr_t)(i + 1), "Get failed");
+    }
+    int missing = -1;
+    ASSERT(hashmap_get(map, &missing, sizeof(missing)) == NULL, "Missing key found");
+    ASSERT(hashmap_stats(map, &stats), "Stats failed");
+#ifdef HASHMAP_ENABLE_STATS
+    ASSERT(stats.instrumented, "Instrumented build should say so");
+    ASSERT(stats.lookups == (uint64_t)N + 1, "Lookup count mismatch");
+    ASSERT(stats.probes >= (uint64_t)N && stats.max_probe >= 1 && stats.max_probe <= stats.max_chain * 2 + 2,
+           "Probe count mismatch");
+    ASSERT(stats.avg_probe >= 1.0, "Average probe mismatch");
+    ASSERT(stats.resizes >= 1, "Growth should count as a resize");
+    ASSERT(stats.alloc_bytes == counter.live_bytes && stats.allocations == counter.allocs, "Allocation bytes mismatch");
+    ASSERT(stats.peak_bytes >= stats.alloc_bytes, "Peak below current");
+    
+    hashmap_stats_reset(map);
+    ASSERT(hashmap_stats(map, &stats), "Stats failed");
+    ASSERT(stats.lookups == 0 && stats.probes == 0 && stats.resizes == 0 && stats.resize_ns == 0,
+           "Reset should zero counters");
+    ASSERT(stats.alloc_bytes == counter.live_bytes && stats.peak_bytes == stats.alloc_bytes,
+           "Reset keeps the live footprint");
+    
+    for (int i = 0; i < N; i++) {
+        hashmap_remove(map, &i, sizeof(i));
+    }
+    ASSERT(hashmap_shrink_to_fit(map), "Shrink failed");
+    ASSERT(hashmap_stats(map, &stats), "Stats failed");
+    ASSERT(stats.resizes == 1 && stats.alloc_bytes == counter.live_bytes, "Shrink should be tracked");
+#else
+    ASSERT(!stats.instrumented && stats.lookups == 0 && stats.alloc_bytes == 0, "Counters should be off");
+#endif
+    
+    // Dump writes the summary and one line per histogram bin
+    FILE *out = tmpfile();
+    ASSERT(out != NULL, "tmpfile failed");
+    ASSERT(hashmap_stats_dump(map, out), "Dump failed");
+    rewind(out);
+    char line[256];
+    int lines = 0;
+    bool saw_summary = false;
+    while (fgets(line, sizeof(line), out)) {
+        saw_summary |= strncmp(line, "size ", 5) == 0;
+        lines += strncmp(line, "chain ", 6) == 0;
+    }
+    fclose(out);
+    ASSERT(saw_summary && lines == HASHMAP_STATS_HISTOGRAM_BINS, "Dump output mismatch");
+    ASSERT(!hashmap_stats(NULL, &stats) && !hashmap_stats(map, NULL) && !hashmap_stats_dump(map, NULL),
+           "NULL arguments should fail");
+    
+    hashmap_destroy(map);
+    ASSERT(counter.live_bytes == 0, "Map leaked memory");
+    TEST_PASS();
+    return true;
+}
+
+// Eviction callback for the cache tests: counts evictions, remembers the last key
+typedef struct {
+    size_t evicted;
+    int last_key;
+} evict_log_t;
+
+static void log_eviction(const void *key, size_t key_size, void *value, void *ctx) {
+    evict_log_t *log = (evict_log_t *)ctx;
+    (void)value;
+    log->evicted++;
+    if (key_size == sizeof(int)) {
+        memcpy(&log->last_key, key, sizeof(int));
+    }
+}
+
+// Test 43: Bounded cache mode with CLOCK eviction
+bool test_cache_mode() {
+    TEST_START("Bounded cache mode");
+    
+    // Referenced entries survive the first eviction
+    evict_log_t log = {0, -1};
+    hashmap_options_t options = {0};
+    options.cache_capacity = 4;
+    options.on_evict = log_eviction;
+    options.evict_ctx = &log;
+    hashmap_t *map = hashmap_create_ex(&options);
+    ASSERT(map != NULL, "Create failed");
+    for (int i = 1; i <= 4; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(i), (void *)(intptr_t)i), "Put failed");
+    }
+    ASSERT(log.evicted == 0 && hashmap_size(map) == 4, "No eviction below the bound");
+    ASSERT(hashmap_get(map, &(int){1}, sizeof(int)) && hashmap_get(map, &(int){2}, sizeof(int)), "Get failed");
+    ASSERT(hashmap_put(map, &(int){5}, sizeof(int), (void *)5), "Put failed");
+    ASSERT(log.evicted == 1 && (log.last_key == 3 || log.last_key == 4), "An unreferenced key should go first");
+    ASSERT(hashmap_size(map) == 4 && !hashmap_contains(map, &log.last_key, sizeof(int)), "Victim still present");
+    ASSERT(hashmap_contains(map, &(int){5}, sizeof(int)), "New key missing");
+    
+    // Updates do not evict
+    ASSERT(hashmap_put(map, &(int){5}, sizeof(int), (void *)50) && log.evicted == 1, "Update should not evict");
+    hashmap_destroy(map);
+    
+    // A hot set touched between cold inserts stays resident under an unbounded stream
+    alloc_counter_t counter = {0, 0, 0};
+    memset(&options, 0, sizeof(options));
+    options.cache_capacity = 1000;
+    options.value_free = free;
+    options.allocator.alloc = counting_alloc;
+    options.allocator.dealloc = counting_dealloc;
+    options.allocator.ctx = &counter;
+    map = hashmap_create_ex(&options);
+    size_t capacity = map->capacity;
+    ASSERT(capacity >= hashmap_capacity_for(1000), "Cache should be sized for its bound");
+    const int HOT = 100;
+    for (int i = 0; i < HOT; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(i), malloc(16)), "Put failed");
+    }
+    size_t settled_bytes = 0;
+    for (int round = 0; round < 400; round++) {
+        for (int i = 0; i < HOT; i++) {
+            ASSERT(hashmap_get(map, &i, sizeof(i)) != NULL, "Hot key evicted");
+        }
+        for (int j = 0; j < 50; j++) {
+            int key = 1000000 + round * 50 + j;
+            ASSERT(hashmap_put(map, &key, sizeof(key), malloc(16)), "Put failed");
+        }
+        ASSERT(hashmap_size(map) <= 1000, "Cache exceeded its bound");
+        if (round == 100) {
+            settled_bytes = counter.live_bytes;
+        }
+    }
+    ASSERT(hashmap_size(map) == 1000 && map->capacity == capacity, "Cache table should not grow");
+    ASSERT(counter.live_bytes == settled_bytes, "Footprint should stay fixed once full");
+    
+    // reserve is capped at the bound; get_or_insert and batches respect it
+    ASSERT(hashmap_reserve(map, 1000000) && map->capacity == capacity, "Reserve should stop at the bound");
+    bool inserted;
+    void **slot = hashmap_get_or_insert(map, &(int){-1}, sizeof(int), &inserted);
+    ASSERT(slot && inserted && hashmap_size(map) == 1000, "get_or_insert should evict");
+    *slot = malloc(16);
+    hashmap_destroy(map);
+    ASSERT(counter.live_bytes == 0, "Evicted values or entries leaked");
+    
+    // Inline values with the pool, eviction callback sees the inline copy
+    memset(&options, 0, sizeof(options));
+    memset(&log, 0, sizeof(log));
+    options.cache_capacity = 64;
+    options.value_size = sizeof(uint64_t);
+    options.entry_pool = true;
+    options.incremental_resize = true;
+    options.on_evict = log_eviction;
+    options.evict_ctx = &log;
+    map = hashmap_create_ex(&options);
+    for (uint64_t i = 0; i < 10000; i++) {
+        int key = (int)i;
+        ASSERT(hashmap_put(map, &key, sizeof(key), &i), "Put failed");
+        uint64_t *value = hashmap_get(map, &key, sizeof(key));
+        ASSERT(value && *value == i, "Inline value mismatch");
+    }
+    ASSERT(hashmap_size(map) == 64 && log.evicted == 10000 - 64, "Eviction count mismatch");
+    hashmap_destroy(map);
+    
+    // Eviction during a staged resize takes victims from either table and
+    // leaves the migration to its bounded per-operation steps
+    memset(&options, 0, sizeof(options));
+    memset(&log, 0, sizeof(log));
+    options.cache_capacity = 256;
+    options.deferred_resize = true;
+    options.on_evict = log_eviction;
+    options.evict_ctx = &log;
+    map = hashmap_create_ex(&options);
+    for (int i = 0; i < 256; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(i), (void *)(intptr_t)(i + 1)), "Put failed");
+    }
+    ASSERT(hashmap_resize_begin(map, map->capacity * 2), "Staging a resize failed");
+    for (int i = 256; i < 512; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(i), (void *)(intptr_t)(i + 1)), "Put failed");
+        ASSERT(hashmap_resize_pending(map), "Eviction should not finish the migration");
+    }
+    ASSERT(hashmap_size(map) == 256 && log.evicted == 256, "Eviction count mismatch during resize");
+    ASSERT(hashmap_resize_step(map, SIZE_MAX) == 0 && hashmap_size(map) == 256, "Drained map lost entries");
+    hashmap_destroy(map);
+    
+    // Sharded caches split the bound
+    memset(&options, 0, sizeof(options));
+    options.cache_capacity = 64;
+    options.concurrency = 4;
+    hashmap_sharded_t *sharded = hashmap_sharded_create_ex(&options);
+    for (int i = 0; i < 5000; i++) {
+        ASSERT(hashmap_sharded_put(sharded, &i, sizeof(i), (void *)(intptr_t)(i + 1)), "Sharded put failed");
+    }
+    ASSERT(hashmap_sharded_size(sharded) <= 64, "Sharded cache exceeded its bound");
+    hashmap_sharded_destroy(sharded);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 44: Per-entry TTL with lazy and stepped reclamation
+bool test_ttl_expiry() {
+    TEST_START("TTL expiry");
+    
+    uint64_t now = 1000;
+    evict_log_t log = {0, -1};
+    alloc_counter_t counter = {0, 0, 0};
+    hashmap_options_t options = {0};
+    options.expiry = true;
+    options.clock = fake_clock;
+    options.clock_ctx = &now;
+    options.value_free = free;
+    options.on_evict = log_eviction;
+    options.evict_ctx = &log;
+    options.allocator.alloc = counting_alloc;
+    options.allocator.dealloc = counting_dealloc;
+    options.allocator.ctx = &counter;
+    hashmap_t *map = hashmap_create_ex(&options);
+    
+    // Lookups skip expired entries; the next write reclaims them
+    ASSERT(hashmap_put_ttl(map, &(int){1}, sizeof(int), malloc(8), 500), "put_ttl failed");
+    ASSERT(hashmap_put(map, &(int){2}, sizeof(int), malloc(8)), "Put failed");
+    now += 499;
+    ASSERT(hashmap_get(map, &(int){1}, sizeof(int)) != NULL, "Key expired early");
+    now += 1;
+    ASSERT(hashmap_size(map) == 2, "Expired entries count until reclaimed");
+    ASSERT(hashmap_get(map, &(int){1}, sizeof(int)) == NULL, "Expired key should read as absent");
+    ASSERT(hashmap_size(map) == 2 && log.evicted == 0, "Lookup should not free the entry");
+    ASSERT(!hashmap_remove(map, &(int){1}, sizeof(int)), "Removing an expired key should report absent");
+    ASSERT(hashmap_size(map) == 1 && log.evicted == 1 && log.last_key == 1, "Write should reclaim the entry");
+    ASSERT(hashmap_get(map, &(int){2}, sizeof(int)) != NULL, "Key without TTL expired");
+    
+    // Refresh, clear and re-store
+    ASSERT(hashmap_put_ttl(map, &(int){3}, sizeof(int), malloc(8), 100), "put_ttl failed");
+    now += 90;
+    ASSERT(hashmap_set_ttl(map, &(int){3}, sizeof(int), 100), "set_ttl failed");
+    now += 90;
+    ASSERT(hashmap_contains(map, &(int){3}, sizeof(int)), "Refreshed key expired");
+    ASSERT(hashmap_put(map, &(int){3}, sizeof(int), malloc(8)), "Put failed");
+    now += 1000000;
+    ASSERT(hashmap_contains(map, &(int){3}, sizeof(int)), "Plain put should clear the TTL");
+    ASSERT(!hashmap_set_ttl(map, &(int){99}, sizeof(int), 10), "set_ttl on a missing key should fail");
+    ASSERT(hashmap_put_ttl(map, &(int){4}, sizeof(int), malloc(8), 0), "put_ttl failed");
+    ASSERT(!hashmap_contains(map, &(int){4}, sizeof(int)), "Zero TTL expires at once");
+    ASSERT(!hashmap_remove(map, &(int){4}, sizeof(int)), "Removing an expired key should report absent");
+    ASSERT(hashmap_put_ttl(map, &(int){5}, sizeof(int), malloc(8), HASHMAP_TTL_NEVER), "put_ttl failed");
+    now += 1000000;
+    ASSERT(hashmap_contains(map, &(int){5}, sizeof(int)), "Saturated TTL should never expire");
+    
+    // Writes treat expired keys as absent
+    ASSERT(hashmap_put_ttl(map, &(int){6}, sizeof(int), malloc(8), 10), "put_ttl failed");
+    ASSERT(hashmap_put_ttl(map, &(int){7}, sizeof(int), malloc(8), 10), "put_ttl failed");
+    now += 10;
+    ASSERT(!hashmap_remove(map, &(int){6}, sizeof(int)), "Removing an expired key should report absent");
+    ASSERT(!hashmap_set_ttl(map, &(int){7}, sizeof(int), 10), "set_ttl on an expired key should fail");
+    ASSERT(hashmap_put_ttl(map, &(int){8}, sizeof(int), malloc(8), 10), "put_ttl failed");
+    now += 10;
+    bool inserted = false;
+    void **slot = hashmap_get_or_insert(map, &(int){8}, sizeof(int), &inserted);
+    ASSERT(slot && inserted && *slot == NULL, "get_or_insert should replace an expired key");
+    *slot = malloc(8);
+    
+    // Stepped sweep: bounded work per call, every expired key reclaimed after one revolution
+    const int N = 5000;
+    for (int i = 100; i < 100 + N; i++) {
+        ASSERT(hashmap_put_ttl(map, &i, sizeof(i), malloc(8), i % 2 ? 50 : 5000), "put_ttl failed");
+    }
+    size_t before = hashmap_size(map);
+    now += 50;
+    size_t reclaimed = 0;
+    size_t steps = 0;
+    for (size_t swept = 0; swept < map->capacity; swept += 64) {
+        size_t got = hashmap_expire_step(map, 64);
+        ASSERT(got <= 64 * 8, "Step did more than its share");
+        reclaimed += got;
+        steps++;
+    }
+    ASSERT(reclaimed == (size_t)N / 2 && hashmap_size(map) == before - reclaimed, "Sweep missed expired keys");
+    ASSERT(steps > 1, "Sweep should take several steps");
+    ASSERT(hashmap_expire_step(map, SIZE_MAX) == 0, "Nothing left to expire");
+    now += 5000;
+    ASSERT(hashmap_expire_step(map, SIZE_MAX) == (size_t)N / 2, "Full pass should reclaim the rest");
+    for (int i = 100; i < 100 + N; i++) {
+        ASSERT(!hashmap_contains(map, &i, sizeof(i)), "Expired key still present");
+    }
+    
+    // Cache mode and expiry share the entry tail
+    hashmap_options_t both = {0};
+    both.expiry = true;
+    both.cache_capacity = 8;
+    both.value_size = sizeof(uint64_t);
+    both.clock = fake_clock;
+    both.clock_ctx = &now;
+    hashmap_t *cache = hashmap_create_ex(&both);
+    for (uint64_t i = 0; i < 32; i++) {
+        ASSERT(hashmap_put_ttl(cache, &i, sizeof(i), &i, i < 28 ? 10 : 1000), "put_ttl failed");
+        ASSERT(*(uint64_t *)hashmap_get(cache, &i, sizeof(i)) == i, "Value mismatch");
+    }
+    now += 10;
+    ASSERT(hashmap_size(cache) == 8 && hashmap_expire_step(cache, SIZE_MAX) == 4, "Cache expiry mismatch");
+    hashmap_destroy(cache);
+    
+    // Parallel build stores entries without a deadline, like hashmap_put
+    hashmap_options_t built = {0};
+    built.expiry = true;
+    built.value_size = sizeof(uint64_t);
+    built.clock = fake_clock;
+    built.clock_ctx = &now;
+    hashmap_t *bulk = hashmap_create_ex(&built);
+    const size_t ROWS = 100000;
+    uint64_t *row_keys = malloc(ROWS * sizeof(uint64_t));
+    const void **row_ptrs = malloc(ROWS * sizeof(void *));
+    size_t *row_sizes = malloc(ROWS * sizeof(size_t));
+    ASSERT(row_keys && row_ptrs && row_sizes, "Memory allocation failed");
+    for (size_t i = 0; i < ROWS; i++) {
+        row_keys[i] = i;
+        row_ptrs[i] = &row_keys[i];
+        row_sizes[i] = sizeof(uint64_t);
+    }
+    ASSERT(hashmap_put_ttl(bulk, &row_keys[7], sizeof(uint64_t), &row_keys[0], 10), "put_ttl failed");
+    ASSERT(hashmap_parallel_build(bulk, row_ptrs, row_sizes, (void *const *)row_ptrs, ROWS, 4), "Build failed");
+    now += 1000;
+    ASSERT(hashmap_size(bulk) == ROWS, "Built entries were reclaimed");
+    for (size_t i = 0; i < ROWS; i++) {
+        uint64_t *value = hashmap_get(bulk, &row_keys[i], sizeof(uint64_t));
+        ASSERT(value && *value == i, "Built key read as expired");
+    }
+    free(row_keys);
+    free(row_ptrs);
+    free(row_sizes);
+    hashmap_destroy(bulk);
+    
+    // Without options.expiry the TTL calls are refused
+    hashmap_t *plain = hashmap_create(0, NULL, NULL);
+    ASSERT(!hashmap_put_ttl(plain, &(int){1}, sizeof(int), NULL, 10) && hashmap_expire_step(plain, 16) == 0,
+           "TTL needs options.expiry");
+    hashmap_destroy(plain);
+    
+    hashmap_destroy(map);
+    ASSERT(counter.live_bytes == 0, "Expired entries leaked");
+    TEST_PASS();
+    return true;
+}
+
+// Test 45: Compact engine with 32-bit indices and a key slab
+static bool count_compact_entry(const void *key, size_t key_size, void *value, void *ctx) {
+    (void)key;
+    (void)key_size;
+    *(uint64_t *)ctx += *(uint64_t *)value;
+    return true;
+}
+
+bool test_compact_map() {
+    TEST_START("Compact engine");
+    
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    hashmap_compact_t *map = hashmap_compact_create_ex(&options);
+    ASSERT(map != NULL, "Failed to create compact map");
+    
+    // Variable-length keys through several resizes
+    const int N = 20000;
+    char key[32];
+    uint64_t expected = 0;
+    for (int i = 0; i < N; i++) {
+        int len = snprintf(key, sizeof(key), "key-%d", i);
+        uint64_t value = (uint64_t)i * 7;
+        ASSERT(hashmap_compact_put(map, key, (size_t)len, &value), "Put failed");
+        expected += value;
+    }
+    ASSERT(hashmap_compact_size(map) == (size_t)N, "Size mismatch");
+    uint64_t update = 1;
+    ASSERT(hashmap_compact_put(map, "key-0", 5, &update), "Update failed");
+    ASSERT(*(uint64_t *)hashmap_compact_get(map, "key-0", 5) == 1, "Update not visible");
+    ASSERT(hashmap_compact_size(map) == (size_t)N, "Update changed the size");
+    expected += 1;
+    
+    uint64_t sum = 0;
+    ASSERT(hashmap_compact_foreach(map, count_compact_entry, &sum) == (size_t)N, "foreach count mismatch");
+    ASSERT(sum == expected, "foreach saw wrong values");
+    
+    // Removing every other key moves entries and eventually compacts the slab
+    for (int i = 0; i < N; i += 2) {
+        int len = snprintf(key, sizeof(key), "key-%d", i);
+        ASSERT(hashmap_compact_remove(map, key, (size_t)len), "Remove failed");
+        ASSERT(!hashmap_compact_remove(map, key, (size_t)len), "Double remove succeeded");
+    }
+    ASSERT(hashmap_compact_size(map) == (size_t)N / 2, "Size after removal mismatch");
+    for (int i = 0; i < N; i++) {
+        int len = snprintf(key, sizeof(key), "key-%d", i);
+        uint64_t *value = hashmap_compact_get(map, key, (size_t)len);
+        if (i % 2) {
+            ASSERT(value && *value == (uint64_t)i * 7, "Moved entry lost its value");
+        } else {
+            ASSERT(value == NULL, "Removed key still present");
+        }
+    }
+    
+    hashmap_compact_usage_t usage;
+    ASSERT(hashmap_compact_memory(map, &usage), "memory failed");
+    ASSERT(usage.key_garbage * 2 <= usage.key_bytes + HASHMAP_COMPACT_MIN_GARBAGE, "Slab garbage not bounded");
+    ASSERT(hashmap_compact_shrink_to_fit(map), "shrink_to_fit failed");
+    ASSERT(hashmap_compact_memory(map, &usage), "memory failed");
+    ASSERT(usage.key_garbage == 0 && usage.entry_bytes == (size_t)N / 2 * sizeof(hashmap_compact_entry_t),
+           "shrink_to_fit left slack");
+    ASSERT(usage.bytes_per_entry > 0.0, "bytes_per_entry not reported");
+    ASSERT(hashmap_compact_contains(map, "key-1", 5), "Key lost by shrink_to_fit");
+    
+    // Invalid parameters and clear
+    ASSERT(!hashmap_compact_put(map, NULL, 4, NULL), "NULL key accepted");
+    ASSERT(!hashmap_compact_put(map, key, 0, NULL), "Empty key accepted");
+    ASSERT(hashmap_compact_get(NULL, key, 4) == NULL, "NULL map lookup");
+    hashmap_compact_clear(map);
+    ASSERT(hashmap_compact_is_empty(map) && !hashmap_compact_contains(map, "key-1", 5), "Clear failed");
+    ASSERT(hashmap_compact_put(map, "again", 5, NULL), "Put after clear failed");
+    ASSERT(*(uint64_t *)hashmap_compact_get(map, "again", 5) == 0, "NULL should store zeros");
+    hashmap_compact_destroy(map);
+    
+    // Pointer values are owned through value_free, as in hashmap_t
+    hashmap_compact_t *owned = hashmap_compact_create(0, free);
+    ASSERT(hashmap_compact_reserve(owned, 1000, 8000), "Reserve failed");
+    for (int i = 0; i < 1000; i++) {
+        ASSERT(hashmap_compact_put(owned, &i, sizeof(i), malloc(16)), "Put failed");
+    }
+    ASSERT(hashmap_compact_put(owned, &(int){5}, sizeof(int), malloc(16)), "Replace failed");
+    ASSERT(hashmap_compact_remove(owned, &(int){6}, sizeof(int)), "Remove failed");
+    hashmap_compact_destroy(owned);
+    hashmap_compact_destroy(NULL);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 46: Bucket and slot arrays mapped with huge-page and NUMA policies
+bool test_table_memory() {
+    TEST_START("Mapped table memory");
+    
+    // Tables from 4 KiB up are mapped, so they bypass the allocator hooks
+    alloc_counter_t counter = {0, 0, 0};
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    options.initial_capacity = 1 << 12;
+    options.allocator.alloc = counting_alloc;
+    options.allocator.dealloc = counting_dealloc;
+    options.allocator.ctx = &counter;
+    options.table_memory.huge_pages = HASHMAP_HUGE_TRANSPARENT;
+    options.table_memory.numa_policy = HASHMAP_NUMA_INTERLEAVE;
+    options.table_memory.min_bytes = 4096;
+    hashmap_t *map = hashmap_create_ex(&options);
+    ASSERT(map != NULL, "Failed to create mapped map");
+    ASSERT(counter.live_bytes == sizeof(hashmap_t), "Mapped buckets should bypass the allocator");
+    ASSERT(((uintptr_t)map->buckets & (HASHMAP_HUGE_PAGE_SIZE - 1)) == 0, "Buckets not huge-page aligned");
+    
+    // Growth, shrinking and an incremental migration move between mapped tables
+    const int N = 100000;
+    for (int i = 0; i < N; i++) {
+        uint64_t value = (uint64_t)i * 5;
+        ASSERT(hashmap_put(map, &i, sizeof(i), &value), "Put failed");
+    }
+    for (int i = 0; i < N; i += 2) {
+        ASSERT(hashmap_remove(map, &i, sizeof(i)), "Remove failed");
+    }
+    ASSERT(hashmap_shrink_to_fit(map), "shrink_to_fit failed");
+    for (int i = 0; i < N; i++) {
+        uint64_t *value = hashmap_get(map, &i, sizeof(i));
+        ASSERT(i % 2 ? value && *value == (uint64_t)i * 5 : value == NULL, "Lookup after resize mismatch");
+    }
+    hashmap_destroy(map);
+    ASSERT(counter.live_bytes == 0, "Allocator-backed memory leaked");
+    
+    // Explicit huge pages fall back when none are reserved; small tables stay on the allocator
+    options.initial_capacity = 16;
+    options.table_memory.huge_pages = HASHMAP_HUGE_EXPLICIT;
+    options.table_memory.numa_policy = HASHMAP_NUMA_BIND;
+    options.table_memory.numa_nodes = 1;
+    options.table_memory.min_bytes = 0;
+    map = hashmap_create_ex(&options);
+    ASSERT(map && counter.live_bytes > sizeof(hashmap_t), "Small buckets should use the allocator");
+    for (int i = 0; i < N; i++) {
+        ASSERT(hashmap_put(map, &i, sizeof(i), NULL), "Put failed");
+    }
+    ASSERT(hashmap_size(map) == (size_t)N && hashmap_contains(map, &(int){N - 1}, sizeof(int)), "Contents mismatch");
+    hashmap_destroy(map);
+    ASSERT(counter.live_bytes == 0, "Allocator-backed memory leaked");
+    
+    // Flat engine control and slot arrays
+    hashmap_options_t flat_options = {0};
+    flat_options.table_memory.mapped = true;
+    flat_options.table_memory.min_bytes = 4096;
+    hashmap_flat_t *flat = hashmap_flat_create_ex(&flat_options);
+    for (int i = 0; i < N; i++) {
+        ASSERT(hashmap_flat_put(flat, &i, sizeof(i), (void *)(uintptr_t)(i + 1)), "Flat put failed");
+    }
+    for (int i = 0; i < N; i++) {
+        ASSERT((uintptr_t)hashmap_flat_get(flat, &i, sizeof(i)) == (uintptr_t)(i + 1), "Flat lookup mismatch");
+    }
+    hashmap_flat_destroy(flat);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 47: Vector kernels agree with memcmp and the portable tag matchers
+bool test_simd_kernels() {
+    TEST_START("SIMD kernels (" HASHMAP_SIMD ")");
+    
+    // Every key size up to 64, equal and with one byte flipped at each position
+    unsigned char a[64], b[64];
+    for (size_t i = 0; i < sizeof(a); i++) {
+        a[i] = (unsigned char)(i * 37 + 11);
+    }
+    for (size_t size = 1; size <= sizeof(a); size++) {
+        memcpy(b, a, size);
+        ASSERT(hashmap_key_equal(a, b, size), "Equal keys compare unequal");
+        for (size_t pos = 0; pos < size; pos++) {
+            b[pos] ^= 0x40;
+            ASSERT(!hashmap_key_equal(a, b, size), "Differing byte missed");
+            b[pos] ^= 0x40;
+        }
+        // Bytes past the key never take part
+        if (size < sizeof(b)) {
+            b[size] = (unsigned char)~a[size];
+            ASSERT(hashmap_key_equal(a, b, size), "Compared past the key");
+        }
+    }
+    
+    // Tag and free matchers on random groups, including every special control value
+    int8_t group[HASHMAP_FLAT_GROUP_WIDTH];
+    unsigned x = 12345;
+    for (int round = 0; round < 20000; round++) {
+        for (int i = 0; i < HASHMAP_FLAT_GROUP_WIDTH; i++) {
+            x = x * 1103515245u + 12345u;
+            unsigned pick = (x >> 16) % 8;
+            group[i] = pick == 0 ? HASHMAP_FLAT_CTRL_EMPTY : pick == 1 ? HASHMAP_FLAT_CTRL_DELETED
+                                                                          : (int8_t)((x >> 8) & 0x7F);
+        }
+        int8_t tag = round % 3 == 0 ? HASHMAP_FLAT_CTRL_EMPTY : (int8_t)((x >> 24) & 0x7F);
+        ASSERT(hashmap_flat_match(group, tag) == hashmap_flat_match_portable(group, tag), "Tag match mismatch");
+        ASSERT(hashmap_flat_match_free(group) == hashmap_flat_match_free_portable(group), "Free match mismatch");
+    }
+    memset(group, 0x05, sizeof(group));
+    ASSERT(hashmap_flat_match_portable(group, 0x05) == 0xFFFF && hashmap_flat_match_free_portable(group) == 0,
+           "Portable matcher wrong on a full group");
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 48: Copy-on-write snapshots stay consistent while the map is written
+static bool sum_cow_values(const void *key, size_t key_size, void *value, void *ctx) {
+    (void)key;
+    (void)key_size;
+    *(uint64_t *)ctx += *(uint64_t *)value;
+    return true;
+}
+
+typedef struct {
+    const hashmap_cow_snapshot_t *snapshot;
+    uint64_t expected;
+    _Atomic bool *stop;
+    bool ok;
+    int walks;
+} cow_reader_t;
+
+static void *cow_reader(void *arg) {
+    cow_reader_t *r = arg;
+    r->ok = true;
+    do {
+        uint64_t sum = 0;
+        size_t seen = hashmap_cow_snapshot_foreach(r->snapshot, sum_cow_values, &sum);
+        if (sum != r->expected || seen != hashmap_cow_snapshot_size(r->snapshot)) {
+            r->ok = false;
+        }
+        r->walks++;
+    } while (!atomic_load(r->stop));
+    return NULL;
+}
+
+bool test_cow_snapshot() {
+    TEST_START("Copy-on-write snapshots");
+    
+    const uint64_t N = 20000;
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    options.initial_capacity = 32768;
+    hashmap_cow_t *map = hashmap_cow_create_ex(&options);
+    ASSERT(map != NULL, "Failed to create COW map");
+    uint64_t expected = 0;
+    for (uint64_t i = 0; i < N; i++) {
+        uint64_t value = i * 3;
+        ASSERT(hashmap_cow_put(map, &i, sizeof(i), &value), "Put failed");
+        expected += value;
+    }
+    ASSERT(map->segment_copies == 0, "Writes without snapshots copied segments");
+    
+    // A reader walks the snapshot on its own thread while this one writes
+    hashmap_cow_snapshot_t *snapshot = hashmap_cow_snapshot(map);
+    ASSERT(snapshot && hashmap_cow_snapshot_size(snapshot) == N, "Snapshot failed");
+    _Atomic bool stop = false;
+    cow_reader_t reader = {snapshot, expected, &stop, false, 0};
+    pthread_t thread;
+    ASSERT(pthread_create(&thread, NULL, cow_reader, &reader) == 0, "pthread_create failed");
+    
+    // Touch a few keys: only their segments are copied
+    for (uint64_t i = 0; i < 50; i++) {
+        uint64_t value = 1;
+        ASSERT(hashmap_cow_put(map, &i, sizeof(i), &value), "Update failed");
+        uint64_t removed = N - 1 - i;
+        ASSERT(hashmap_cow_remove(map, &removed, sizeof(removed)), "Remove failed");
+    }
+    ASSERT(!hashmap_cow_remove(map, &(uint64_t){N + 5}, sizeof(uint64_t)), "Removed an absent key");
+    size_t segments = map->capacity / HASHMAP_COW_SEGMENT_BUCKETS;
+    ASSERT(map->segment_copies > 0 && map->segment_copies <= 100, "Copies not bounded by the touched segments");
+    size_t copies = map->segment_copies;
+    for (uint64_t i = 0; i < 50; i++) {
+        ASSERT(hashmap_cow_put(map, &i, sizeof(i), &(uint64_t){2}), "Second update failed");
+    }
+    ASSERT(map->segment_copies == copies, "Already private segments were copied again");
+    
+    // Growth while the snapshot is held
+    for (uint64_t i = N; i < 4 * N; i++) {
+        ASSERT(hashmap_cow_put(map, &i, sizeof(i), &i), "Put during growth failed");
+    }
+    ASSERT(map->capacity / HASHMAP_COW_SEGMENT_BUCKETS > segments, "Map should have grown");
+    atomic_store(&stop, true);
+    pthread_join(thread, NULL);
+    ASSERT(reader.ok && reader.walks > 0, "Reader saw an inconsistent snapshot");
+    
+    // The snapshot still shows the map as it was
+    for (uint64_t i = 0; i < N; i++) {
+        uint64_t *value = hashmap_cow_snapshot_get(snapshot, &i, sizeof(i));
+        ASSERT(value && *value == i * 3, "Snapshot value changed");
+    }
+    ASSERT(!hashmap_cow_snapshot_contains(snapshot, &(uint64_t){N}, sizeof(uint64_t)), "Snapshot saw a later insert");
+    ASSERT(*(uint64_t *)hashmap_cow_get(map, &(uint64_t){0}, sizeof(uint64_t)) == 2, "Live map lost an update");
+    ASSERT(!hashmap_cow_contains(map, &(uint64_t){N - 1}, sizeof(uint64_t)), "Live map kept a removed key");
+    ASSERT(hashmap_cow_size(map) == 4 * N - 50, "Live size mismatch");
+    
+    // A second snapshot outlives both the first and the map
+    hashmap_cow_snapshot_t *later = hashmap_cow_snapshot(map);
+    hashmap_cow_snapshot_release(snapshot);
+    hashmap_cow_clear(map);
+    ASSERT(hashmap_cow_is_empty(map) && hashmap_cow_snapshot_size(later) == 4 * N - 50, "Clear reached the snapshot");
+    ASSERT(hashmap_cow_put(map, &(uint64_t){7}, sizeof(uint64_t), NULL), "Put after clear failed");
+    hashmap_cow_destroy(map);
+    ASSERT(*(uint64_t *)hashmap_cow_snapshot_get(later, &(uint64_t){N}, sizeof(uint64_t)) == N,
+           "Snapshot invalid after destroy");
+    hashmap_cow_snapshot_release(later);
+    hashmap_cow_snapshot_release(NULL);
+    
+    // Pointer values
+    hashmap_cow_t *pointers = hashmap_cow_create(0);
+    int a = 1, b = 2;
+    ASSERT(hashmap_cow_put(pointers, "k", 1, &a), "Put failed");
+    hashmap_cow_snapshot_t *view = hashmap_cow_snapshot(pointers);
+    ASSERT(hashmap_cow_put(pointers, "k", 1, &b), "Update failed");
+    ASSERT(hashmap_cow_snapshot_get(view, "k", 1) == &a && hashmap_cow_get(pointers, "k", 1) == &b,
+           "Pointer values not isolated");
+    hashmap_cow_snapshot_release(view);
+    hashmap_cow_destroy(pointers);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 49: Merge, intersection and difference with cached hashes and moved entries
+static void *sum_merged_values(const void *key, size_t key_size, void *dst_value, void *src_value, void *ctx) {
+    (void)key;
+    (void)key_size;
+    ++*(int *)ctx;
+    *(uint64_t *)dst_value += *(uint64_t *)src_value;
+    return dst_value;
+}
+
+bool test_set_operations() {
+    TEST_START("Merge, intersect and difference");
+    
+    // Per-thread partial counts: keys [0, 1000) and [500, 1500)
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    hashmap_t *dst = hashmap_create_ex(&options);
+    hashmap_t *src = hashmap_create_ex(&options);
+    ASSERT(dst && src, "Failed to create maps");
+    for (uint64_t i = 0; i < 1000; i++) {
+        ASSERT(hashmap_put(dst, &i, sizeof(i), &(uint64_t){1}), "Put failed");
+        uint64_t key = i + 500;
+        ASSERT(hashmap_put(src, &key, sizeof(key), &(uint64_t){2}), "Put failed");
+    }
+    void *moved = hashmap_get(src, &(uint64_t){1400}, sizeof(uint64_t));
+    int combined = 0;
+    ASSERT(hashmap_merge(dst, src, sum_merged_values, &combined), "Merge failed");
+    ASSERT(hashmap_size(dst) == 1500 && hashmap_is_empty(src), "Merge sizes wrong");
+    ASSERT(combined == 500, "Combine not called once per shared key");
+    for (uint64_t i = 0; i < 1500; i++) {
+        uint64_t *value = hashmap_get(dst, &i, sizeof(i));
+        ASSERT(value && *value == (i < 500 ? 1u : i < 1000 ? 3u : 2u), "Merged value wrong");
+    }
+    ASSERT(hashmap_get(dst, &(uint64_t){1400}, sizeof(uint64_t)) == moved, "Entry was copied, not moved");
+    ASSERT(hashmap_put(src, &(uint64_t){1}, sizeof(uint64_t), &(uint64_t){5}), "Put into drained map failed");
+    
+    // Intersection probes the other map; difference walks whichever is smaller
+    hashmap_t *evens = hashmap_create_ex(&options);
+    for (uint64_t i = 0; i < 3000; i += 2) {
+        hashmap_put(evens, &i, sizeof(i), NULL);
+    }
+    ASSERT(hashmap_intersect(dst, evens) == 750 && hashmap_size(dst) == 750, "Intersect count wrong");
+    ASSERT(hashmap_contains(dst, &(uint64_t){1498}, sizeof(uint64_t)) &&
+           !hashmap_contains(dst, &(uint64_t){1499}, sizeof(uint64_t)), "Intersect kept the wrong keys");
+    ASSERT(hashmap_intersect(dst, dst) == 0, "Self-intersection removed keys");
+    ASSERT(hashmap_difference(dst, src) == 0, "Difference removed a key it should keep");
+    ASSERT(hashmap_difference(src, dst) == 0 && hashmap_size(src) == 1, "Difference removed an absent key");
+    hashmap_put(src, &(uint64_t){2}, sizeof(uint64_t), NULL);
+    ASSERT(hashmap_difference(dst, src) == 1 && !hashmap_contains(dst, &(uint64_t){2}, sizeof(uint64_t)),
+           "Difference through the smaller map failed");
+    ASSERT(hashmap_difference(evens, dst) == 749 && hashmap_size(evens) == 751, "Difference count wrong");
+    ASSERT(hashmap_difference(dst, dst) == 749 && hashmap_is_empty(dst), "Self-difference left keys");
+    
+    // Mismatched layouts and invalid arguments
+    hashmap_t *pointers = hashmap_create(0, NULL, NULL);
+    ASSERT(!hashmap_merge(pointers, src, NULL, NULL), "Merged maps of different value sizes");
+    ASSERT(!hashmap_merge(src, src, NULL, NULL) && !hashmap_merge(NULL, src, NULL, NULL), "Accepted bad arguments");
+    ASSERT(hashmap_intersect(NULL, src) == 0 && hashmap_difference(src, NULL) == 0, "NULL map not rejected");
+    hashmap_destroy(pointers);
+    hashmap_destroy(evens);
+    hashmap_destroy(src);
+    hashmap_destroy(dst);
+    
+    // Pointer values: the value not kept goes to value_free; a pooled source,
+    // a different hash and a pending migration force copies and rehashing
+    hashmap_options_t owned = {0};
+    owned.value_free = free;
+    hashmap_t *into = hashmap_create_ex(&owned);
+    owned.entry_pool = true;
+    owned.incremental_resize = true;
+    owned.hash_func = hashmap_fnv1a_hash;
+    hashmap_t *from = hashmap_create_ex(&owned);
+    for (int i = 0; i < 300; i++) {
+        char key[16];
+        int length = snprintf(key, sizeof(key), "key-%d", i);
+        int *value = malloc(sizeof(int));
+        *value = i;
+        ASSERT(hashmap_put(i < 200 ? into : from, key, (size_t)length, value), "Put failed");
+        if (i >= 100 && i < 200) {
+            value = malloc(sizeof(int));
+            *value = -i;
+            ASSERT(hashmap_put(from, key, (size_t)length, value), "Put failed");
+        }
+    }
+    ASSERT(from->old_buckets != NULL, "Source should be mid-migration");
+    ASSERT(hashmap_merge(into, from, NULL, NULL), "Pointer merge failed");
+    ASSERT(hashmap_size(into) == 300 && hashmap_is_empty(from), "Pointer merge sizes wrong");
+    for (int i = 0; i < 300; i++) {
+        char key[16];
+        int length = snprintf(key, sizeof(key), "key-%d", i);
+        int *value = hashmap_get(into, key, (size_t)length);
+        ASSERT(value && *value == (i >= 100 && i < 200 ? -i : i), "Source value did not win");
+    }
+    hashmap_destroy(from);
+    hashmap_destroy(into);
+    
+    // Expired entries on either side are reclaimed, not merged; deadlines move along
+    uint64_t now = 1000;
+    hashmap_options_t timed = {0};
+    timed.expiry = true;
+    timed.clock = fake_clock;
+    timed.clock_ctx = &now;
+    hashmap_t *live = hashmap_create_ex(&timed);
+    hashmap_t *aging = hashmap_create_ex(&timed);
+    int x = 1, y = 2;
+    hashmap_put_ttl(live, "a", 1, &x, 10);
+    hashmap_put_ttl(aging, "a", 1, &y, 100);
+    hashmap_put_ttl(aging, "b", 1, &y, 10);
+    hashmap_put_ttl(aging, "c", 1, &y, 100);
+    now += 50;
+    ASSERT(hashmap_merge(live, aging, NULL, NULL), "Timed merge failed");
+    ASSERT(hashmap_size(live) == 2 && hashmap_get(live, "a", 1) == &y && hashmap_get(live, "c", 1) == &y,
+           "Expired entries were merged");
+    now += 100;
+    ASSERT(!hashmap_contains(live, "a", 1) && !hashmap_contains(live, "c", 1), "Deadline lost in the move");
+    hashmap_destroy(aging);
+    hashmap_destroy(live);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Test 50: Deferred resizes drained by hashmap_resize_step or a resizer thread
+bool test_deferred_resize() {
+    TEST_START("Deferred resize");
+    
+    hashmap_options_t options = {0};
+    options.deferred_resize = true;
+    options.value_size = sizeof(uint64_t);
+    hashmap_t *map = hashmap_create_ex(&options);
+    ASSERT(map != NULL, "Failed to create map");
+    uint64_t key = 0;
+    while (!hashmap_resize_pending(map)) {
+        ASSERT(hashmap_put(map, &key, sizeof(key), &key), "Put failed");
+        key++;
+    }
+    
+    // Writes leave the migration to the caller until the new table fills up
+    size_t old_capacity = map->old_capacity;
+    for (; map->size + 1 < map->max_entries; key++) {
+        ASSERT(hashmap_put(map, &key, sizeof(key), &key), "Put failed");
+        ASSERT(hashmap_remove(map, &(uint64_t){key / 2}, sizeof(uint64_t)) &&
+               hashmap_put(map, &(uint64_t){key / 2}, sizeof(uint64_t), &(uint64_t){key / 2}), "Churn failed");
+    }
+    ASSERT(map->migrate_index == 0, "A foreground write migrated buckets");
+    for (uint64_t i = 0; i < key; i++) {
+        uint64_t *value = hashmap_get(map, &i, sizeof(i));
+        ASSERT(value && *value == i, "Lookup across both tables failed");
+    }
+    ASSERT(hashmap_resize_step(map, 4) == old_capacity - 4, "Step did not migrate 4 buckets");
+    ASSERT(hashmap_resize_step(map, SIZE_MAX) == 0 && !hashmap_resize_pending(map), "Step did not finish");
+    ASSERT(hashmap_resize_step(map, 16) == 0 && hashmap_resize_step(NULL, 16) == 0, "Idle step not a no-op");
+    
+    // Without steps, writers assist a few buckets at a time and never rehash
+    // a whole table inline; growth waits for the migration to finish
+    const uint64_t N = 200000;
+    size_t violations = 0;
+    for (; key < N; key++) {
+        size_t capacity = map->capacity;
+        size_t left = map->old_buckets ? map->old_capacity - map->migrate_index : 0;
+        ASSERT(hashmap_put(map, &key, sizeof(key), &key), "Put failed");
+        size_t now_left = map->old_buckets ? map->old_capacity - map->migrate_index : 0;
+        if (left > HASHMAP_MIGRATE_BUCKETS && (map->capacity != capacity || left - now_left > HASHMAP_MIGRATE_BUCKETS)) {
+            violations++;
+        }
+    }
+    ASSERT(violations == 0, "A put migrated more than its share");
+    ASSERT(hashmap_size(map) == N, "Size mismatch");
+    for (uint64_t i = 0; i < N; i++) {
+        uint64_t *value = hashmap_get(map, &i, sizeof(i));
+        ASSERT(value && *value == i, "Value lost during deferred growth");
+    }
+    hashmap_destroy(map);
+    
+    // Concurrent map with a resizer thread under parallel writers and readers
+    enum { WRITERS = 4, READERS = 4, PER_WRITER = 20000 };
+    hashmap_options_t threaded = {0};
+    threaded.concurrency = 4;
+    threaded.resize_thread = true;
+    hashmap_concurrent_t *shared = hashmap_concurrent_create_ex(&threaded);
+    ASSERT(shared && shared->has_resizer, "Resizer not started");
+    pthread_t threads[WRITERS + READERS];
+    concurrent_worker_t workers[WRITERS + READERS];
+    for (int t = 0; t < WRITERS + READERS; t++) {
+        workers[t].map = shared;
+        workers[t].first = (t % WRITERS) * PER_WRITER;
+        workers[t].count = PER_WRITER;
+        ASSERT(pthread_create(&threads[t], NULL, t < WRITERS ? concurrent_writer : concurrent_reader,
+                              &workers[t]) == 0, "pthread_create failed");
+    }
+    for (int t = 0; t < WRITERS + READERS; t++) {
+        pthread_join(threads[t], NULL);
+        ASSERT(workers[t].ok, t < WRITERS ? "Writer operation failed" : "Reader saw a wrong value");
+    }
+    for (int wait = 0; hashmap_concurrent_resize_step(shared, 0) && wait < 5000; wait++) {
+        nanosleep(&(struct timespec){0, 1000000}, NULL);
+    }
+    ASSERT(hashmap_concurrent_resize_step(shared, 0) == 0, "Resizer left migrations pending");
+    ASSERT(hashmap_concurrent_size(shared) == WRITERS * PER_WRITER / 2, "Size mismatch after concurrent writes");
+    for (int i = 0; i < WRITERS * PER_WRITER; i++) {
+        void *value = hashmap_concurrent_get(shared, &i, sizeof(int));
+        ASSERT(i % 2 == 0 ? value == NULL : (intptr_t)value == i + 1, "Value mismatch after concurrent writes");
+    }
+    hashmap_concurrent_destroy(shared);
+    
+    // Caller-driven steps on a concurrent map, in bounded slices
+    hashmap_options_t stepped = {0};
+    stepped.concurrency = 1;
+    stepped.deferred_resize = true;
+    shared = hashmap_concurrent_create_ex(&stepped);
+    for (int i = 0; i < 1000; i++) {
+        ASSERT(hashmap_concurrent_put(shared, &i, sizeof(i), (void *)(intptr_t)(i + 1)), "Put failed");
+    }
+    size_t pending = hashmap_concurrent_resize_step(shared, 0);
+    ASSERT(pending == 1024, "Expected the 1024-bucket table to be pending");
+    ASSERT(hashmap_concurrent_resize_step(shared, 100) == pending - 100, "Slice not bounded");
+    ASSERT(hashmap_concurrent_resize_step(shared, SIZE_MAX) == 0, "Steps did not finish");
+    ASSERT((intptr_t)hashmap_concurrent_get(shared, &(int){999}, sizeof(int)) == 1000, "Lookup after steps failed");
+    hashmap_concurrent_destroy(shared);
+    ASSERT(hashmap_concurrent_resize_step(NULL, 1) == 0, "NULL map not rejected");
+    
+    TEST_PASS();
+    return true;
+}
+
+// ============================================================================
+// Performance Tests
+// ============================================================================
+
+static double get_time_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Performance test: Insert performance
+bool test_perf_insert() {
+    TEST_START("Performance: Insert");
+    
+    hashmap_t *map = hashmap_create(16, NULL, NULL);
+    const int N = 100000;
+    
+    double start = get_time_ms();
+    for (int i = 0; i < N; i++) {
+        int key = i;
+        int value = i;
+        hashmap_put(map, &key, sizeof(int), &value);
+    }
+    double end = get_time_ms();
+    
+    double time_ms = end - start;
+    double ops_per_sec = (N / time_ms) * 1000.0;
+    
+    printf("  Inserted %d entries in %.2f ms (%.0f ops/sec)\n", 
+           N, time_ms, ops_per_sec);
+    
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Lookup performance
+bool test_perf_lookup() {
+    TEST_START("Performance: Lookup");
+    
+    hashmap_t *map = hashmap_create(16, NULL, NULL);
+    const int N = 100000;
+    const int LOOKUPS = 1000000;
+    
+    // Insert N entries
+    for (int i = 0; i < N; i++) {
+        int key = i;
+        int value = i;
+        hashmap_put(map, &key, sizeof(int), &value);
+    }
+    
+    // Perform lookups
+    double start = get_time_ms();
+    int found = 0;
+    for (int i = 0; i < LOOKUPS; i++) {
+        int key = i % N;
+        int *result = (int *)hashmap_get(map, &key, sizeof(int));
+        if (result != NULL) found++;
+    }
+    double end = get_time_ms();
+    
+    double time_ms = end - start;
+    double ops_per_sec = (LOOKUPS / time_ms) * 1000.0;
+    
+    printf("  Performed %d lookups in %.2f ms (%.0f ops/sec, %d found)\n", 
+           LOOKUPS, time_ms, ops_per_sec, found);
+    
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Mixed operations
+bool test_perf_mixed() {
+    TEST_START("Performance: Mixed operations");
+    
+    hashmap_t *map = hashmap_create(16, NULL, NULL);
+    const int N = 50000;
+    const int OPS = 200000;
+    
+    double start = get_time_ms();
+    for (int i = 0; i < OPS; i++) {
+        int key = i % N;
+        int value = i;
+        
+        if (i % 3 == 0) {
+            // Insert
+            hashmap_put(map, &key, sizeof(int), &value);
+        } else if (i % 3 == 1) {
+            // Lookup
+            hashmap_get(map, &key, sizeof(int));
+        } else {
+            // Remove
+            hashmap_remove(map, &key, sizeof(int));
+        }
+    }
+    double end = get_time_ms();
+    
+    double time_ms = end - start;
+    double ops_per_sec = (OPS / time_ms) * 1000.0;
+    
+    printf("  Performed %d mixed operations in %.2f ms (%.0f ops/sec)\n", 
+           OPS, time_ms, ops_per_sec);
+    
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Resize overhead
+bool test_perf_resize() {
+    TEST_START("Performance: Resize overhead");
+    
+    hashmap_t *map = hashmap_create(16, NULL, NULL);
+    const int N = 100000;
+    
+    double start = get_time_ms();
+    for (int i = 0; i < N; i++) {
+        int key = i;
+        int value = i;
+        hashmap_put(map, &key, sizeof(int), &value);
+    }
+    double end = get_time_ms();
+    
+    double time_ms = end - start;
+    printf("  Inserted %d entries (with resizing) in %.2f ms\n", N, time_ms);
+    printf("  Final size: %zu\n", hashmap_size(map));
+    
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: String keys
+bool test_perf_string_keys() {
+    TEST_START("Performance: String keys");
+    
+    hashmap_t *map = hashmap_create(16, NULL, NULL);
+    const int N = 10000;
+    
+    char keys[10000][32];
+    for (int i = 0; i < N; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key_%d", i);
+    }
+    
+    double start = get_time_ms();
+    for (int i = 0; i < N; i++) {
+        hashmap_put(map, keys[i], strlen(keys[i]) + 1, "value");
+    }
+    double end = get_time_ms();
+    
+    double time_ms = end - start;
+    double ops_per_sec = (N / time_ms) * 1000.0;
+    
+    printf("  Inserted %d string keys in %.2f ms (%.0f ops/sec)\n", 
+           N, time_ms, ops_per_sec);
+    
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Flat engine lookup performance
+bool test_perf_flat_lookup() {
+    TEST_START("Performance: Flat engine lookup");
+    
+    hashmap_flat_t *map = hashmap_flat_create(16, NULL, NULL);
+    const int N = 100000;
+    const int LOOKUPS = 1000000;
+    
+    // Insert N entries
+    for (int i = 0; i < N; i++) {
+        int key = i;
+        int value = i;
+        hashmap_flat_put(map, &key, sizeof(int), &value);
+    }
+    
+    // Perform lookups
+    double start = get_time_ms();
+    int found = 0;
+    for (int i = 0; i < LOOKUPS; i++) {
+        int key = i % N;
+        int *result = (int *)hashmap_flat_get(map, &key, sizeof(int));
+        if (result != NULL) found++;
+    }
+    double end = get_time_ms();
+    
+    double time_ms = end - start;
+    double ops_per_sec = (LOOKUPS / time_ms) * 1000.0;
+    
+    printf("  Performed %d lookups in %.2f ms (%.0f ops/sec, %d found)\n", 
+           LOOKUPS, time_ms, ops_per_sec, found);
+    
+    hashmap_flat_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Hash throughput on long keys
+bool test_perf_hash_long_keys() {
+    TEST_START("Performance: Hash throughput (64-byte keys)");
+    
+    const int N = 1000000;
+    uint8_t key[64];
+    for (size_t i = 0; i < sizeof(key); i++) {
+        key[i] = (uint8_t)(i * 31 + 7);
+    }
+    
+    size_t sink = 0;
+    double start = get_time_ms();
+    for (int i = 0; i < N; i++) {
+        key[0] = (uint8_t)i;
+        sink ^= hashmap_fnv1a_hash(key, sizeof(key));
+    }
+    double fnv_ms = get_time_ms() - start;
+    
+    start = get_time_ms();
+    for (int i = 0; i < N; i++) {
+        key[0] = (uint8_t)i;
+        sink ^= hashmap_generic_hash(key, sizeof(key));
+    }
+    double wide_ms = get_time_ms() - start;
+    
+    printf("  FNV-1a: %.2f ms, wide-word: %.2f ms for %d hashes (%.1fx, checksum %zx)\n",
+           fnv_ms, wide_ms, N, fnv_ms / wide_ms, sink & 0xFF);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Insert/remove churn with and without the entry pool
+bool test_perf_pool_churn() {
+    TEST_START("Performance: Entry pool churn");
+    
+    const int N = 50000;
+    const int ROUNDS = 10;
+    double times[2];
+    
+    for (int pooled = 0; pooled < 2; pooled++) {
+        hashmap_options_t options = {0};
+        options.initial_capacity = 2 * N;
+        options.entry_pool = pooled != 0;
+        hashmap_t *map = hashmap_create_ex(&options);
+        
+        double start = get_time_ms();
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int i = 0; i < N; i++) {
+                hashmap_put(map, &i, sizeof(int), map);
+            }
+            for (int i = 0; i < N; i++) {
+                hashmap_remove(map, &i, sizeof(int));
+            }
+        }
+        times[pooled] = get_time_ms() - start;
+        hashmap_destroy(map);
+    }
+    
+    printf("  %d put/remove pairs: malloc %.2f ms, pool %.2f ms\n",
+           N * ROUNDS, times[0], times[1]);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Bulk load with and without a reservation
+bool test_perf_reserve() {
+    TEST_START("Performance: Bulk load with reserve");
+    
+    const int N = 100000;
+    double times[2];
+    
+    for (int reserve = 0; reserve < 2; reserve++) {
+        hashmap_t *map = hashmap_create(16, NULL, NULL);
+        double start = get_time_ms();
+        if (reserve) {
+            hashmap_reserve(map, N);
+        }
+        for (int i = 0; i < N; i++) {
+            hashmap_put(map, &i, sizeof(int), map);
+        }
+        times[reserve] = get_time_ms() - start;
+        hashmap_destroy(map);
+    }
+    
+    printf("  Inserted %d entries: incremental growth %.2f ms, reserved %.2f ms\n",
+           N, times[0], times[1]);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Worst-case single insert latency
+bool test_perf_incremental_latency() {
+    TEST_START("Performance: Worst-case insert latency");
+    
+    const int N = 1000000;
+    double worst[2];
+    double total[2];
+    
+    for (int incremental = 0; incremental < 2; incremental++) {
+        hashmap_options_t options = {0};
+        options.incremental_resize = incremental != 0;
+        options.entry_pool = true;
+        hashmap_t *map = hashmap_create_ex(&options);
+        
+        worst[incremental] = 0.0;
+        double begin = get_time_ms();
+        for (int i = 0; i < N; i++) {
+            double start = get_time_ms();
+            hashmap_put(map, &i, sizeof(int), map);
+            double elapsed = get_time_ms() - start;
+            if (elapsed > worst[incremental]) {
+                worst[incremental] = elapsed;
+            }
+        }
+        total[incremental] = get_time_ms() - begin;
+        hashmap_destroy(map);
+    }
+    
+    printf("  %d inserts: stop-the-world worst %.3f ms (total %.1f ms), incremental worst %.3f ms (total %.1f ms)\n",
+           N, worst[0], total[0], worst[1], total[1]);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Batched vs single random lookups on a large table
+bool test_perf_batch_lookup() {
+    TEST_START("Performance: Batch lookup");
+    
+    const int N = 500000;
+    const int LOOKUPS = 1000000;
+    
+    hashmap_t *map = hashmap_create(16, NULL, NULL);
+    hashmap_reserve(map, N);
+    for (int i = 0; i < N; i++) {
+        hashmap_put(map, &i, sizeof(int), map);
+    }
+    
+    // Random probe order so neither path benefits from allocation order
+    int *keys = malloc(LOOKUPS * sizeof(int));
+    const void **key_ptrs = malloc(LOOKUPS * sizeof(void *));
+    size_t *key_sizes = malloc(LOOKUPS * sizeof(size_t));
+    void **out = malloc(LOOKUPS * sizeof(void *));
+    uint32_t state = 12345;
+    for (int i = 0; i < LOOKUPS; i++) {
+        state = state * 1664525u + 1013904223u;
+        keys[i] = (int)(state % (uint32_t)N);
+        key_ptrs[i] = &keys[i];
+        key_sizes[i] = sizeof(int);
+    }
+    
+    double start = get_time_ms();
+    size_t found_single = 0;
+    for (int i = 0; i < LOOKUPS; i++) {
+        if (hashmap_get(map, &keys[i], sizeof(int))) found_single++;
+    }
+    double single_ms = get_time_ms() - start;
+    
+    start = get_time_ms();
+    size_t found_batch = hashmap_get_batch(map, key_ptrs, key_sizes, LOOKUPS, out);
+    double batch_ms = get_time_ms() - start;
+    
+    printf("  %d random lookups: single %.2f ms, batch %.2f ms (%zu/%zu found)\n",
+           LOOKUPS, single_ms, batch_ms, found_single, found_batch);
+    
+    free(keys);
+    free(key_ptrs);
+    free(key_sizes);
+    free(out);
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Read-mostly throughput, global mutex vs lock striping
+typedef struct {
+    hashmap_t *plain;
+    pthread_mutex_t *mutex;
+    hashmap_concurrent_t *striped;
+    int keys;
+    int ops;
+    unsigned seed;
+} perf_router_t;
+
+static void *perf_router_worker(void *arg) {
+    perf_router_t *w = arg;
+    unsigned x = w->seed;
+    for (int i = 0; i < w->ops; i++) {
+        x = x * 1103515245u + 12345u;
+        int key = (int)((x >> 8) % (unsigned)w->keys);
+        bool write = (x & 0xFF) < 13;  // ~5% writes
+        if (w->striped) {
+            if (write) {
+                hashmap_concurrent_put(w->striped, &key, sizeof(int), (void *)(intptr_t)(key + 1));
+            } else {
+                hashmap_concurrent_get(w->striped, &key, sizeof(int));
+            }
+        } else {
+            pthread_mutex_lock(w->mutex);
+            if (write) {
+                hashmap_put(w->plain, &key, sizeof(int), (void *)(intptr_t)(key + 1));
+            } else {
+                hashmap_get(w->plain, &key, sizeof(int));
+            }
+            pthread_mutex_unlock(w->mutex);
+        }
+    }
+    return NULL;
+}
+
+bool test_perf_concurrent_read_mostly() {
+    TEST_START("Performance: Concurrent read-mostly throughput");
+    
+    enum { KEYS = 100000, OPS = 200000, MAX_THREADS = 8 };
+    hashmap_t *plain = hashmap_create(16, NULL, NULL);
+    hashmap_concurrent_t *striped = hashmap_concurrent_create(16, NULL, NULL);
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    for (int i = 0; i < KEYS; i++) {
+        hashmap_put(plain, &i, sizeof(int), (void *)(intptr_t)(i + 1));
+        hashmap_concurrent_put(striped, &i, sizeof(int), (void *)(intptr_t)(i + 1));
+    }
+    
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        double rate[2];
+        for (int variant = 0; variant < 2; variant++) {
+            pthread_t tid[MAX_THREADS];
+            perf_router_t workers[MAX_THREADS];
+            double start = get_time_ms();
+            for (int t = 0; t < threads; t++) {
+                workers[t] = (perf_router_t){plain, &mutex, variant ? striped : NULL, KEYS, OPS, (unsigned)t + 1};
+                pthread_create(&tid[t], NULL, perf_router_worker, &workers[t]);
+            }
+            for (int t = 0; t < threads; t++) {
+                pthread_join(tid[t], NULL);
+            }
+            rate[variant] = (double)threads * OPS / (get_time_ms() - start);
+        }
+        printf("  %d thread(s): global mutex %.0f ops/ms, striped %.0f ops/ms\n",
+               threads, rate[0], rate[1]);
+    }
+    
+    hashmap_destroy(plain);
+    hashmap_concurrent_destroy(striped);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Lookup throughput, read-write locks vs lock-free reads
+typedef struct {
+    hashmap_concurrent_t *striped;
+    hashmap_rcu_t *rcu;
+    int keys;
+    int ops;
+} perf_reader_t;
+
+static void *perf_reader_worker(void *arg) {
+    perf_reader_t *w = arg;
+    unsigned x = 12345u;
+    for (int i = 0; i < w->ops; i++) {
+        x = x * 1103515245u + 12345u;
+        int key = (int)((x >> 8) % (unsigned)w->keys);
+        if (w->rcu) {
+            hashmap_rcu_get(w->rcu, &key, sizeof(int));
+        } else {
+            hashmap_concurrent_get(w->striped, &key, sizeof(int));
+        }
+    }
+    return NULL;
+}
+
+bool test_perf_rcu_reads() {
+    TEST_START("Performance: Lock-free read throughput");
+    
+    enum { KEYS = 100000, OPS = 500000, THREADS = 4 };
+    hashmap_concurrent_t *striped = hashmap_concurrent_create(16, NULL, NULL);
+    hashmap_rcu_t *rcu = hashmap_rcu_create(16, NULL, NULL);
+    for (int i = 0; i < KEYS; i++) {
+        hashmap_concurrent_put(striped, &i, sizeof(int), (void *)(intptr_t)(i + 1));
+        hashmap_rcu_put(rcu, &i, sizeof(int), (void *)(intptr_t)(i + 1));
+    }
+    
+    double rate[2];
+    for (int variant = 0; variant < 2; variant++) {
+        pthread_t tid[THREADS];
+        perf_reader_t workers[THREADS];
+        double start = get_time_ms();
+        for (int t = 0; t < THREADS; t++) {
+            workers[t] = (perf_reader_t){striped, variant ? rcu : NULL, KEYS, OPS};
+            pthread_create(&tid[t], NULL, perf_reader_worker, &workers[t]);
+        }
+        for (int t = 0; t < THREADS; t++) {
+            pthread_join(tid[t], NULL);
+        }
+        rate[variant] = (double)THREADS * OPS / (get_time_ms() - start);
+    }
+    printf("  %d threads: rwlock stripes %.0f lookups/ms, lock-free %.0f lookups/ms\n",
+           THREADS, rate[0], rate[1]);
+    
+    hashmap_concurrent_destroy(striped);
+    hashmap_rcu_destroy(rcu);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Full scan, chained foreach vs flat foreach
+static bool visit_sum(const void *key, size_t key_size, void *value, void *ctx) {
+    (void)key;
+    (void)key_size;
+    *(intptr_t *)ctx += (intptr_t)value;
+    return true;
+}
+
+bool test_perf_full_scan() {
+    TEST_START("Performance: Full scan");
+    
+    const int N = 1000000;
+    const int ROUNDS = 5;
+    hashmap_t *map = hashmap_create(16, NULL, NULL);
+    hashmap_flat_t *flat = hashmap_flat_create(16, NULL, NULL);
+    for (int i = 0; i < N; i++) {
+        hashmap_put(map, &i, sizeof(int), (void *)(intptr_t)1);
+        hashmap_flat_put(flat, &i, sizeof(int), (void *)(intptr_t)1);
+    }
+    
+    intptr_t sums[2] = {0, 0};
+    double start = get_time_ms();
+    for (int r = 0; r < ROUNDS; r++) {
+        hashmap_foreach(map, visit_sum, &sums[0]);
+    }
+    double chained = get_time_ms() - start;
+    start = get_time_ms();
+    for (int r = 0; r < ROUNDS; r++) {
+        hashmap_flat_foreach(flat, visit_sum, &sums[1]);
+    }
+    double dense = get_time_ms() - start;
+    
+    printf("  %d scans of %d entries: chained %.2f ms, flat %.2f ms\n", ROUNDS, N, chained, dense);
+    ASSERT(sums[0] == (intptr_t)N * ROUNDS && sums[1] == sums[0], "Scans should visit every entry");
+    
+    hashmap_destroy(map);
+    hashmap_flat_destroy(flat);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Bulk build and clear, sequential vs parallel
+bool test_perf_parallel_build() {
+    TEST_START("Performance: Parallel build and clear");
+    
+    const int N = 1000000;
+    const size_t THREADS = 4;
+    int *keys = malloc(N * sizeof(int));
+    const void **key_ptrs = malloc(N * sizeof(void *));
+    size_t *key_sizes = malloc(N * sizeof(size_t));
+    void **values = malloc(N * sizeof(void *));
+    ASSERT(keys && key_ptrs && key_sizes && values, "Memory allocation failed");
+    for (int i = 0; i < N; i++) {
+        keys[i] = i;
+        key_ptrs[i] = &keys[i];
+        key_sizes[i] = sizeof(int);
+        values[i] = &keys[i];
+    }
+    
+    double build[2], clear[2];
+    for (int parallel = 0; parallel < 2; parallel++) {
+        hashmap_t *map = hashmap_create(16, NULL, NULL);
+        double start = get_time_ms();
+        if (parallel) {
+            hashmap_parallel_build(map, key_ptrs, key_sizes, (void *const *)values, N, THREADS);
+        } else {
+            hashmap_put_batch(map, key_ptrs, key_sizes, (void *const *)values, N);
+        }
+        build[parallel] = get_time_ms() - start;
+        ASSERT(hashmap_size(map) == (size_t)N, "Build size mismatch");
+        
+        start = get_time_ms();
+        if (parallel) {
+            hashmap_parallel_clear(map, THREADS);
+        } else {
+            hashmap_clear(map);
+        }
+        clear[parallel] = get_time_ms() - start;
+        hashmap_destroy(map);
+    }
+    
+    printf("  %d rows: build %.2f ms -> %.2f ms, clear %.2f ms -> %.2f ms (%zu threads)\n",
+           N, build[0], build[1], clear[0], clear[1], THREADS);
+    
+    free(keys);
+    free(key_ptrs);
+    free(key_sizes);
+    free(values);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Counter updates, pointer values vs inline values
+bool test_perf_inline_values() {
+    TEST_START("Performance: Inline value counters");
+    
+    const int KEYS = 200000;
+    const int OPS = 2000000;
+    double times[2];
+    
+    for (int inline_values = 0; inline_values < 2; inline_values++) {
+        hashmap_options_t options = {0};
+        options.value_size = inline_values ? sizeof(uint64_t) : 0;
+        options.value_free = inline_values ? NULL : free;
+        hashmap_t *map = hashmap_create_ex(&options);
+        
+        double start = get_time_ms();
+        unsigned x = 1;
+        for (int i = 0; i < OPS; i++) {
+            x = x * 1103515245u + 12345u;
+            int key = (int)((x >> 8) % (unsigned)KEYS);
+            uint64_t *counter = hashmap_get(map, &key, sizeof(int));
+            if (counter) {
+                (*counter)++;
+            } else if (inline_values) {
+                hashmap_put(map, &key, sizeof(int), &(uint64_t){1});
+            } else {
+                counter = malloc(sizeof(uint64_t));
+                *counter = 1;
+                hashmap_put(map, &key, sizeof(int), counter);
+            }
+        }
+        times[inline_values] = get_time_ms() - start;
+        hashmap_destroy(map);
+    }
+    
+    printf("  %d counter updates over %d keys: pointer values %.2f ms, inline %.2f ms\n",
+           OPS, KEYS, times[0], times[1]);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Counting with get+put vs get_or_insert
+bool test_perf_get_or_insert() {
+    TEST_START("Performance: Get-or-insert counting");
+    
+    const int KEYS = 1000000;
+    const int OPS = 2000000;
+    double times[2];
+    
+    for (int upsert = 0; upsert < 2; upsert++) {
+        hashmap_options_t options = {0};
+        options.value_size = sizeof(uint64_t);
+        hashmap_t *map = hashmap_create_ex(&options);
+        
+        double start = get_time_ms();
+        unsigned x = 1;
+        for (int i = 0; i < OPS; i++) {
+            x = x * 1103515245u + 12345u;
+            int key = (int)((x >> 8) % (unsigned)KEYS);
+            if (upsert) {
+                uint64_t *counter = hashmap_get_or_insert(map, &key, sizeof(int), NULL);
+                (*counter)++;
+            } else {
+                uint64_t *counter = hashmap_get(map, &key, sizeof(int));
+                if (counter) {
+                    (*counter)++;
+                } else {
+                    hashmap_put(map, &key, sizeof(int), &(uint64_t){1});
+                }
+            }
+        }
+        times[upsert] = get_time_ms() - start;
+        ASSERT(hashmap_size(map) <= (size_t)KEYS, "Too many keys");
+        hashmap_destroy(map);
+    }
+    
+    printf("  %d counter updates over %d keys: get+put %.2f ms, get_or_insert %.2f ms\n",
+           OPS, KEYS, times[0], times[1]);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Integer-key lookups, generic flat engine vs typed map
+bool test_perf_typed_lookup() {
+    TEST_START("Performance: Typed map lookup");
+    
+    const uint64_t N = 1000000;
+    const int ROUNDS = 5;
+    hashmap_flat_t *flat = hashmap_flat_create(0, NULL, NULL);
+    u64_map_t *typed = u64_map_create(0);
+    for (uint64_t i = 0; i < N; i++) {
+        uint64_t key = i * 2654435761u;
+        hashmap_flat_put(flat, &key, sizeof(key), (void *)(uintptr_t)i);
+        u64_map_put(typed, key, i);
+    }
+    
+    uint64_t sums[2] = {0, 0};
+    double start = get_time_ms();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (uint64_t i = 0; i < N; i++) {
+            uint64_t key = i * 2654435761u;
+            sums[0] += (uintptr_t)hashmap_flat_get(flat, &key, sizeof(key));
+        }
+    }
+    double flat_ms = get_time_ms() - start;
+    
+    start = get_time_ms();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (uint64_t i = 0; i < N; i++) {
+            sums[1] += *u64_map_get(typed, i * 2654435761u);
+        }
+    }
+    double typed_ms = get_time_ms() - start;
+    ASSERT(sums[0] == sums[1], "Engines disagree");
+    
+    printf("  %d x %llu uint64_t lookups: flat %.2f ms, typed %.2f ms\n",
+           ROUNDS, (unsigned long long)N, flat_ms, typed_ms);
+    
+    hashmap_flat_destroy(flat);
+    u64_map_destroy(typed);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Startup by reinserting every row vs opening a snapshot
+bool test_perf_mapped_startup() {
+    TEST_START("Performance: Snapshot startup");
+    
+    const int N = 1000000;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/hashmap_perf_snapshot.%ld", (long)getpid());
+    
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    double start = get_time_ms();
+    hashmap_t *map = hashmap_create_ex(&options);
+    for (int i = 0; i < N; i++) {
+        uint64_t value = (uint64_t)i * 3;
+        hashmap_put(map, &i, sizeof(int), &value);
+    }
+    double rebuild_ms = get_time_ms() - start;
+    
+    start = get_time_ms();
+    ASSERT(hashmap_save(map, path), "Save failed");
+    double save_ms = get_time_ms() - start;
+    
+    start = get_time_ms();
+    hashmap_mapped_t *mapped = hashmap_open_mapped(path);
+    double open_ms = get_time_ms() - start;
+    ASSERT(mapped != NULL, "Open failed");
+    
+    uint64_t sums[2] = {0, 0};
+    start = get_time_ms();
+    for (int i = 0; i < N; i++) {
+        sums[0] += *(uint64_t *)hashmap_get(map, &i, sizeof(int));
+    }
+    double heap_ms = get_time_ms() - start;
+    start = get_time_ms();
+    for (int i = 0; i < N; i++) {
+        sums[1] += *(const uint64_t *)hashmap_mapped_get(mapped, &i, sizeof(int));
+    }
+    double mapped_ms = get_time_ms() - start;
+    ASSERT(sums[0] == sums[1], "Snapshot disagrees with the map");
+    
+    printf("  %d rows: rebuild %.2f ms, save %.2f ms, open %.3f ms\n", N, rebuild_ms, save_ms, open_ms);
+    printf("  %d lookups: heap %.2f ms, mapped %.2f ms (first touch)\n", N, heap_ms, mapped_ms);
+    
+    hashmap_mapped_close(mapped);
+    hashmap_destroy(map);
+    remove(path);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Bulk load throughput from a row file
+bool test_perf_bulk_load() {
+    TEST_START("Performance: Streaming bulk load");
+    
+    const int N = 1000000;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/hashmap_perf_rows.%ld", (long)getpid());
+    FILE *file = fopen(path, "wb");
+    ASSERT(file != NULL, "Create failed");
+    ASSERT(hashmap_rows_write_header(file, (uint64_t)N, sizeof(uint64_t)), "Header write failed");
+    for (int i = 0; i < N; i++) {
+        char key[32];
+        int len = snprintf(key, sizeof(key), "key-%08d", i);
+        uint64_t value = (uint64_t)i;
+        hashmap_rows_write_row(file, key, (size_t)len, &value, sizeof(value));
+    }
+    fclose(file);
+    
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    options.entry_pool = true;
+    hashmap_t *map = hashmap_create_ex(&options);
+    hashmap_load_stats_t stats;
+    ASSERT(hashmap_load_file(map, path, &stats), "Load failed");
+    ASSERT(hashmap_size(map) == (size_t)N, "Size mismatch");
+    
+    printf("  %zu rows, %.1f MB in %.2f ms (%.0f rows/sec, %.0f MB/sec)\n",
+           stats.rows, stats.bytes / 1e6, stats.seconds * 1000.0,
+           stats.rows / stats.seconds, stats.bytes / 1e6 / stats.seconds);
+    
+    hashmap_destroy(map);
+    remove(path);
+    TEST_PASS();
+    return true;
+}
+
+bool test_perf_cache() {
+    TEST_START("Performance: Bounded cache under an unbounded key stream");
+    
+    // 80% of requests hit a hot set smaller than the cache, the rest are new keys
+    const size_t CACHE = 100000;
+    const uint64_t HOT = 80000;
+    const int OPS = 2000000;
+    hashmap_options_t options = {0};
+    options.cache_capacity = CACHE;
+    options.value_size = sizeof(uint64_t);
+    options.entry_pool = true;
+    hashmap_t *map = hashmap_create_ex(&options);
+    
+    uint64_t state = 88172645463325252ULL;
+    uint64_t fresh = HOT;
+    size_t hits = 0;
+    double start = get_time_ms();
+    for (int i = 0; i < OPS; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint64_t key = state % 10 < 8 ? state / 10 % HOT : fresh++;
+        uint64_t *value = hashmap_get(map, &key, sizeof(key));
+        if (value) {
+            hits++;
+        } else {
+            ASSERT(hashmap_put(map, &key, sizeof(key), &key), "Put failed");
+        }
+    }
+    double end = get_time_ms();
+    ASSERT(hashmap_size(map) == CACHE, "Cache should be full");
+    
+    double elapsed = end - start;
+    printf("  %d requests in %.2f ms (%.0f ns/request), hit rate %.1f%% (hot share 80%%)\n",
+           OPS, elapsed, elapsed * 1e6 / OPS, 100.0 * hits / OPS);
+    
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+bool test_perf_expire_sweep() {
+    TEST_START("Performance: Stepped TTL sweep");
+    
+    // Half of 1,000,000 session keys expire; reclaim them 1024 buckets per step
+    const int N = 1000000;
+    uint64_t now = 0;
+    hashmap_options_t options = {0};
+    options.expiry = true;
+    options.clock = fake_clock;
+    options.clock_ctx = &now;
+    options.entry_pool = true;
+    hashmap_t *map = hashmap_create_ex(&options);
+    for (int i = 0; i < N; i++) {
+        hashmap_put_ttl(map, &i, sizeof(i), NULL, i % 2 ? 1000 : 60000);
+    }
+    now = 1000;
+    
+    size_t reclaimed = 0;
+    size_t steps = 0;
+    double worst = 0.0;
+    double start = get_time_ms();
+    for (size_t swept = 0; swept < map->capacity; swept += 1024) {
+        double step_start = get_time_ms();
+        reclaimed += hashmap_expire_step(map, 1024);
+        double step = get_time_ms() - step_start;
+        worst = step > worst ? step : worst;
+        steps++;
+    }
+    double elapsed = get_time_ms() - start;
+    ASSERT(reclaimed == (size_t)N / 2 && hashmap_size(map) == (size_t)N / 2, "Sweep count mismatch");
+    
+    printf("  Reclaimed %zu of %d entries in %zu steps, %.2f ms total, worst step %.1f us\n",
+           reclaimed, N, steps, elapsed, worst * 1000.0);
+    
+    hashmap_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Resident bytes per entry, chained vs compact
+bool test_perf_compact_memory() {
+    TEST_START("Performance: Compact engine memory");
+    
+    // 1,000,000 16-byte keys with 8-byte values; the chained map is measured
+    // through its allocator hooks, so neither side counts malloc headers
+    const int N = 1000000;
+    alloc_counter_t counter = {0, 0, 0};
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    options.allocator.alloc = counting_alloc;
+    options.allocator.dealloc = counting_dealloc;
+    options.allocator.ctx = &counter;
+    hashmap_t *chained = hashmap_create_ex(&options);
+    hashmap_compact_t *compact = hashmap_compact_create_ex(&options);
+    
+    char key[16];
+    double times[2];
+    for (int engine = 0; engine < 2; engine++) {
+        double start = get_time_ms();
+        for (int i = 0; i < N; i++) {
+            uint64_t value = (uint64_t)i;
+            snprintf(key, sizeof(key), "user%011d", i);
+            bool ok = engine ? hashmap_compact_put(compact, key, sizeof(key), &value)
+                             : hashmap_put(chained, key, sizeof(key), &value);
+            ASSERT(ok, "Put failed");
+        }
+        times[engine] = get_time_ms() - start;
+    }
+    hashmap_migrate_step(chained, SIZE_MAX);  // Release any old table still draining
+    
+    hashmap_compact_usage_t usage;
+    ASSERT(hashmap_compact_memory(compact, &usage), "memory failed");
+    double chained_bpe = (double)(counter.live_bytes + sizeof(hashmap_t)) / N;
+    ASSERT(usage.bytes_per_entry < chained_bpe * 0.7, "Compact engine should be substantially smaller");
+    
+    printf("  %d entries: chained %.1f bytes/entry in %zu allocations (%.2f ms), "
+           "compact %.1f bytes/entry (%.2f ms)\n",
+           N, chained_bpe, counter.allocs - counter.frees, times[0], usage.bytes_per_entry, times[1]);
+    
+    hashmap_destroy(chained);
+    hashmap_compact_destroy(compact);
+    TEST_PASS();
+    return true;
+}
+
+// Resident set size in bytes (Linux; 0 elsewhere)
+static size_t resident_bytes() {
+    size_t pages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (fscanf(statm, "%*s %zu", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+    return pages * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// Performance test: Random flat-engine lookups on base pages vs huge pages
+bool test_perf_huge_pages() {
+    TEST_START("Performance: Huge-page tables");
+    
+    const int N = 2000000;
+    const int OPS = 4000000;
+    double times[2];
+    for (int huge = 0; huge < 2; huge++) {
+        hashmap_options_t options = {0};
+        options.table_memory.huge_pages = huge ? HASHMAP_HUGE_TRANSPARENT : HASHMAP_HUGE_NONE;
+        hashmap_flat_t *map = hashmap_flat_create_ex(&options);
+        hashmap_flat_reserve(map, (size_t)N);
+        for (int i = 0; i < N; i++) {
+            hashmap_flat_put(map, &i, sizeof(i), (void *)(uintptr_t)i);
+        }
+        
+        unsigned x = 7;
+        uintptr_t sum = 0;
+        double start = get_time_ms();
+        for (int i = 0; i < OPS; i++) {
+            x = x * 1103515245u + 12345u;
+            int key = (int)((x >> 4) % (unsigned)N);
+            sum += (uintptr_t)hashmap_flat_get(map, &key, sizeof(key));
+        }
+        times[huge] = get_time_ms() - start;
+        ASSERT(sum > 0, "Lookups missed");
+        hashmap_flat_destroy(map);
+    }
+    
+    // Mapped tables fault pages in on first touch, not at creation
+    hashmap_options_t options = {0};
+    options.initial_capacity = (size_t)1 << 24;
+    options.table_memory.mapped = true;
+    size_t before = resident_bytes();
+    double start = get_time_ms();
+    hashmap_t *map = hashmap_create_ex(&options);
+    double create_ms = get_time_ms() - start;
+    size_t grown = resident_bytes() - before;
+    ASSERT(map != NULL, "Failed to create map");
+    ASSERT(grown < ((size_t)1 << 24) * sizeof(hashmap_entry_t *) / 4, "Table was faulted in at creation");
+    hashmap_destroy(map);
+    
+    printf("  %d random lookups over %d keys: base pages %.2f ms, huge pages %.2f ms\n",
+           OPS, N, times[0], times[1]);
+    printf("  128 MiB bucket array created in %.3f ms, %.1f MiB resident\n", create_ms, grown / 1048576.0);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Short-key comparison, memcmp vs hashmap_key_equal
+bool test_perf_key_compare() {
+    TEST_START("Performance: Key comparison kernels");
+    
+    // Sizes are read at run time, as in a probe loop, so memcmp stays a call
+    static volatile size_t sizes[] = {4, 8, 16, 24};
+    const int OPS = 20000000;
+    unsigned char keys[2][64];
+    memset(keys, 0x5A, sizeof(keys));
+    printf("  %d compares per size (%s):", OPS, HASHMAP_SIMD);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t size = sizes[s];
+        double times[2];
+        size_t equal[2] = {0, 0};
+        for (int kernel = 0; kernel < 2; kernel++) {
+            double start = get_time_ms();
+            for (int i = 0; i < OPS; i++) {
+                const unsigned char *probe = keys[1] + (i & 7);
+                equal[kernel] += kernel ? hashmap_key_equal(keys[0], probe, size)
+                                        : memcmp(keys[0], probe, size) == 0;
+            }
+            times[kernel] = get_time_ms() - start;
+        }
+        ASSERT(equal[0] == equal[1] && equal[0] == (size_t)OPS, "Kernels disagree");
+        printf(" %zuB memcmp %.2f ns, kernel %.2f ns;", size, times[0] * 1e6 / OPS, times[1] * 1e6 / OPS);
+    }
+    printf("\n");
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Snapshot cost vs copying the map
+static bool copy_cow_entry(const void *key, size_t key_size, void *value, void *ctx) {
+    return hashmap_cow_put((hashmap_cow_t *)ctx, key, key_size, value);
+}
+
+bool test_perf_cow_snapshot() {
+    TEST_START("Performance: Copy-on-write snapshot");
+    
+    // 1,000,000 entries; then 10,000 updates while a snapshot is held
+    const uint64_t N = 1000000;
+    const uint64_t WRITES = 10000;
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    hashmap_cow_t *map = hashmap_cow_create_ex(&options);
+    for (uint64_t i = 0; i < N; i++) {
+        hashmap_cow_put(map, &i, sizeof(i), &i);
+    }
+    
+    double start = get_time_ms();
+    hashmap_cow_snapshot_t *snapshot = hashmap_cow_snapshot(map);
+    double snapshot_ms = get_time_ms() - start;
+    
+    start = get_time_ms();
+    for (uint64_t i = 0; i < WRITES; i++) {
+        uint64_t key = i * 7919 % N;
+        hashmap_cow_put(map, &key, sizeof(key), &(uint64_t){0});
+    }
+    double write_ms = get_time_ms() - start;
+    size_t copies = map->segment_copies;
+    size_t segments = map->capacity / HASHMAP_COW_SEGMENT_BUCKETS;
+    ASSERT(hashmap_cow_snapshot_size(snapshot) == N, "Snapshot size mismatch");
+    
+    hashmap_cow_t *copy = hashmap_cow_create_ex(&options);
+    start = get_time_ms();
+    hashmap_cow_foreach(map, copy_cow_entry, copy);
+    double full_copy_ms = get_time_ms() - start;
+    ASSERT(hashmap_cow_size(copy) == N, "Copy size mismatch");
+    
+    printf("  snapshot of %llu entries %.3f ms; %llu writes after it %.2f ms copying %zu of %zu segments; "
+           "full copy %.2f ms\n",
+           (unsigned long long)N, snapshot_ms, (unsigned long long)WRITES, write_ms, copies, segments, full_copy_ms);
+    
+    hashmap_cow_snapshot_release(snapshot);
+    hashmap_cow_destroy(copy);
+    hashmap_cow_destroy(map);
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: hashmap_merge vs a get + put loop
+static hashmap_t *make_partial_counts(uint64_t first, uint64_t n) {
+    hashmap_options_t options = {0};
+    options.value_size = sizeof(uint64_t);
+    hashmap_t *map = hashmap_create_ex(&options);
+    for (uint64_t i = first; i < first + n; i++) {
+        hashmap_put(map, &i, sizeof(i), &(uint64_t){1});
+    }
+    return map;
+}
+
+static void *add_counts(const void *key, size_t key_size, void *dst_value, void *src_value, void *ctx) {
+    (void)key;
+    (void)key_size;
+    (void)ctx;
+    *(uint64_t *)dst_value += *(uint64_t *)src_value;
+    return dst_value;
+}
+
+bool test_perf_merge() {
+    TEST_START("Performance: Merge partial aggregates");
+    
+    // Fold 4 per-thread maps of 250,000 keys, half shared with the previous one
+    const int PARTS = 4;
+    const uint64_t N = 250000;
+    double times[2];
+    for (int merged = 0; merged < 2; merged++) {
+        hashmap_t *parts[4];
+        for (int p = 0; p < PARTS; p++) {
+            parts[p] = make_partial_counts((uint64_t)p * N / 2, N);
+        }
+        hashmap_options_t options = {0};
+        options.value_size = sizeof(uint64_t);
+        hashmap_t *total = hashmap_create_ex(&options);
+        
+        double start = get_time_ms();
+        for (int p = 0; p < PARTS; p++) {
+            if (merged) {
+                ASSERT(hashmap_merge(total, parts[p], add_counts, NULL), "Merge failed");
+                continue;
+            }
+            hashmap_iter_t iter;
+            const void *key;
+            size_t key_size;
+            void *value;
+            hashmap_iter_init(&iter, parts[p]);
+            while (hashmap_iter_next(&iter, &key, &key_size, &value)) {
+                uint64_t *current = hashmap_get(total, key, key_size);
+                uint64_t sum = *(uint64_t *)value + (current ? *current : 0);
+                hashmap_put(total, key, key_size, &sum);
+            }
+            hashmap_clear(parts[p]);
+        }
+        times[merged] = get_time_ms() - start;
+        
+        uint64_t expected_size = N / 2 * (PARTS + 1);
+        ASSERT(hashmap_size(total) == expected_size, "Merged size wrong");
+        ASSERT(*(uint64_t *)hashmap_get(total, &(uint64_t){N / 2}, sizeof(uint64_t)) == 2, "Shared count wrong");
+        for (int p = 0; p < PARTS; p++) {
+            hashmap_destroy(parts[p]);
+        }
+        hashmap_destroy(total);
+    }
+    printf("  %d x %llu keys: get + put loop %.2f ms, hashmap_merge %.2f ms (%.2fx)\n",
+           PARTS, (unsigned long long)N, times[0], times[1], times[0] / times[1]);
+    
+    TEST_PASS();
+    return true;
+}
+
+// Performance test: Worst-case put latency with inline vs background resizes
+bool test_perf_deferred_resize() {
+    TEST_START("Performance: Deferred resize latency");
+    
+    // 2,000,000 puts into one segment, so each growth rehashes the whole map.
+    // The first WARMUP puts are left out of the worst case: their small tables
+    // land on allocator state the previous run's frees left behind
+    const int N = 2000000;
+    const int WARMUP = 65536;
+    double totals[2], worst[2];
+    for (int threaded = 0; threaded < 2; threaded++) {
+        hashmap_options_t options = {0};
+        options.concurrency = 1;
+        options.resize_thread = threaded;
+        hashmap_concurrent_t *map = hashmap_concurrent_create_ex(&options);
+        worst[threaded] = 0;
+        double start = get_time_ms();
+        for (int i = 0; i < N; i++) {
+            double before = get_time_ms();
+            hashmap_concurrent_put(map, &i, sizeof(i), (void *)(intptr_t)(i + 1));
+            double took = get_time_ms() - before;
+            if (i >= WARMUP && took > worst[threaded]) {
+                worst[threaded] = took;
+            }
+        }
+        totals[threaded] = get_time_ms() - start;
+        ASSERT(hashmap_concurrent_size(map) == (size_t)N, "Size mismatch");
+        hashmap_concurrent_destroy(map);
+    }
+    printf("  %d puts: inline resize %.2f ms (worst put %.3f ms), resizer thread %.2f ms (worst put %.3f ms)\n",
+           N, totals[0], worst[0], totals[1], worst[1]);
+    
     TEST_PASS();
     return true;
 }
@@ -672,6 +4298,38 @@ int main() {
         test_key_size_mismatch,
         test_destroy_null,
         test_default_capacity,
+        test_flat_basic,
+        test_flat_growth_and_removal,
+        test_flat_long_keys_cleanup,
+        test_resize_long_keys,
+        test_capacity_rounding,
+        test_hash_selection,
+        test_inline_key_storage,
+        test_custom_allocator,
+        test_entry_pool,
+        test_reserve_and_shrink,
+        test_incremental_resize,
+        test_batch_operations,
+        test_load_and_growth_factor,
+        test_concurrent_map,
+        test_rcu_map,
+        test_sharded_map,
+        test_iteration,
+        test_parallel_operations,
+        test_inline_values,
+        test_get_or_insert,
+        test_typed_map,
+        test_mapped_snapshot,
+        test_bulk_load,
+        test_map_stats,
+        test_cache_mode,
+        test_ttl_expiry,
+        test_compact_map,
+        test_table_memory,
+        test_simd_kernels,
+        test_cow_snapshot,
+        test_set_operations,
+        test_deferred_resize,
         NULL
     };
     
@@ -686,6 +4344,29 @@ int main() {
         test_perf_mixed,
         test_perf_resize,
         test_perf_string_keys,
+        test_perf_flat_lookup,
+        test_perf_hash_long_keys,
+        test_perf_pool_churn,
+        test_perf_reserve,
+        test_perf_incremental_latency,
+        test_perf_batch_lookup,
+        test_perf_concurrent_read_mostly,
+        test_perf_rcu_reads,
+        test_perf_full_scan,
+        test_perf_parallel_build,
+        test_perf_inline_values,
+        test_perf_get_or_insert,
+        test_perf_typed_lookup,
+        test_perf_mapped_startup,
+        test_perf_bulk_load,
+        test_perf_cache,
+        test_perf_expire_sweep,
+        test_perf_compact_memory,
+        test_perf_huge_pages,
+        test_perf_key_compare,
+        test_perf_cow_snapshot,
+        test_perf_merge,
+        test_perf_deferred_resize,
         NULL
     };
     